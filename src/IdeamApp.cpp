@@ -13,6 +13,7 @@
 
 #include "IdeamNamespace.h"
 #include "SettingsWindow.h"
+#include "TPreferences.h"
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "IdeamApp"
@@ -39,6 +40,8 @@ IdeamApp::IdeamApp()
 
 IdeamApp::~IdeamApp()
 {
+	// Pending settings writes
+	TPreferences::FlushAll();
 }
 
 void
@@ -120,6 +120,11 @@ LoadSettingsVars()
 	status += file.FindInt32("enable_notifications", &Settings.enable_notifications);
 	status += file.FindInt32("wrap_console", &Settings.wrap_console);
 	status += file.FindInt32("console_banner", &Settings.console_banner);
+	// Settings older than the key would leave no scrollback at all
+	if (file.FindInt32("console_scrollback", &Settings.console_scrollback) != B_OK) {
+		Settings.console_scrollback = kSKConsoleScrollback;
+		status += B_NAME_NOT_FOUND;
+	}
 
 	return status;
 }
@@ -187,6 +192,8 @@ UpdateSettingsFile()
 		settings.SetInt32("wrap_console", kSKWrapConsole);
 	if (settings.FindInt32("console_banner", &intVal) != B_OK)
 		settings.SetInt32("console_banner", kSKConsoleBanner);
+	if (settings.FindInt32("console_scrollback", &intVal) != B_OK)
+		settings.SetInt32("console_scrollback", kSKConsoleScrollback);
 
 	// Managed to get here without errors, reset counter and app version
 	settings.SetInt64("last_used", real_time_clock());
@@ -24,6 +24,7 @@ namespace IdeamNames
 	const BString kSettingsProjectsToReopen("projects_to_reopen.settings");
 	const BString kUISettingsFileName("ui.settings");
 	BString const kProjectExtension(".idmpro");
+	BString const kProjectIndexExtension(".idmidx");
 
 	int32 CompareVersion(const BString appVersion, const BString fileVersion);
 	BString GetSignature();
@@ -53,6 +54,7 @@ namespace IdeamNames
 		int32 enable_notifications;
 		int32 wrap_console;
 		int32 console_banner;
+		int32 console_scrollback;
 
 	} SettingsVars;
 
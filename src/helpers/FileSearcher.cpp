@@ -0,0 +1,316 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "FileSearcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TextScanner.h"
+
+// Worker threads are capped, searching is mostly memory bound
+static constexpr auto kFileSearchMaxWorkers = 8;
+// Head of a file sniffed for binary content, as done on load
+static constexpr auto kFileSearchSniffSize = 8192;
+// Full target port, retried until canceled
+static constexpr auto kFileSearchSendTimeout = 50000;
+
+FileSearcher::FileSearcher(const BMessenger& target)
+	:
+	fTarget(target)
+	, fSearch(nullptr)
+	, fGeneration(0)
+	, fStartTime(0)
+	, fCancel(false)
+	, fNextFile(0)
+	, fRunning(0)
+	, fBinaries(0)
+	, fMatches(0)
+{
+}
+
+FileSearcher::~FileSearcher()
+{
+	Cancel();
+	delete fSearch;
+}
+
+/*
+ * Buffer is copied: the caller keeps editing while workers run.
+ * Must be called after Cancel() and before Start().
+ */
+void
+FileSearcher::AddBuffer(const BString& path, const char* text, size_t length)
+{
+	fBuffers[path].assign(text, length);
+}
+
+status_t
+FileSearcher::Start(const BString& pattern, bool matchCase, bool wholeWord,
+	bool regex, const std::vector<BString>& files)
+{
+	_WaitWorkers();
+
+	if (pattern.IsEmpty() || files.empty())
+		return B_BAD_VALUE;
+
+	delete fSearch;
+	fSearch = nullptr;
+	fRegex.reset();
+
+	if (regex == true) {
+		fRegex = TextRegex::Compile(pattern, matchCase, wholeWord);
+		if (fRegex->InitCheck() != B_OK)
+			return B_BAD_VALUE;
+
+		// Cheap rejection of files, unless the literal is the pattern
+		const std::string& literal = fRegex->RequiredLiteral();
+		if (fRegex->IsLiteral() == false && literal.empty() == false)
+			fSearch = new TextSearch(literal.data(), literal.size(),
+				matchCase, false);
+	} else
+		fSearch = new TextSearch(pattern.String(), pattern.Length(),
+			matchCase, wholeWord);
+
+	fFiles = files;
+	fGeneration++;
+	fStartTime = system_time();
+	fCancel = false;
+	fNextFile = 0;
+	fBinaries = 0;
+	fMatches = 0;
+
+	system_info info;
+	int32 count = 1;
+	if (get_system_info(&info) == B_OK)
+		count = std::min<int32>(info.cpu_count, kFileSearchMaxWorkers);
+	count = std::max<int32>(1, std::min<int32>(count, fFiles.size()));
+
+	for (int32 i = 0; i < count; i++) {
+		thread_id worker = spawn_thread(_WorkerEntry, "find in files",
+			B_NORMAL_PRIORITY, this);
+		if (worker >= 0)
+			fWorkers.push_back(worker);
+	}
+
+	if (fWorkers.empty())
+		return B_NO_MORE_THREADS;
+
+	// All must be counted before the first one may finish
+	fRunning = fWorkers.size();
+	for (thread_id worker : fWorkers)
+		resume_thread(worker);
+
+	return B_OK;
+}
+
+/*
+ * Workers stop at the next file, match or send, a canceled search still
+ * sends its FILE_SEARCH_DONE if there is room for it
+ */
+void
+FileSearcher::Cancel()
+{
+	fCancel = true;
+	_WaitWorkers();
+	fBuffers.clear();
+}
+
+bool
+FileSearcher::IsRunning() const
+{
+	return fRunning > 0;
+}
+
+/* static */
+status_t
+FileSearcher::_WorkerEntry(void* data)
+{
+	static_cast<FileSearcher*>(data)->_Worker();
+	return B_OK;
+}
+
+/*
+ * Files are taken from a shared atomic index so workers balance
+ * themselves whatever the file sizes
+ */
+void
+FileSearcher::_Worker()
+{
+	BMessage batch(FILE_SEARCH_RESULTS);
+	batch.AddInt32("generation", fGeneration);
+
+	int32 index;
+	const int32 filesCount = fFiles.size();
+
+	while (fCancel == false && (index = fNextFile++) < filesCount) {
+		const BString& path = fFiles[index];
+
+		auto buffer = fBuffers.find(path);
+		if (buffer != fBuffers.end()) {
+			_SearchText(index, buffer->second.data(), buffer->second.size(), batch);
+			continue;
+		}
+
+		int fd = open(path.String(), O_RDONLY);
+		if (fd < 0)
+			continue;
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || S_ISREG(st.st_mode) == false
+			|| st.st_size == 0) {
+			close(fd);
+			continue;
+		}
+
+		void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+
+		if (map == MAP_FAILED)
+			continue;
+
+		const char* text = static_cast<const char*>(map);
+
+		TextScanner scanner;
+		scanner.Scan(text, std::min<off_t>(st.st_size, kFileSearchSniffSize));
+		scanner.Finish();
+
+		if (scanner.IsBinary() == true)
+			fBinaries++;
+		else
+			_SearchText(index, text, st.st_size, batch);
+
+		munmap(map, st.st_size);
+	}
+
+	_SendBatch(batch);
+
+	// Last one out reports
+	if (--fRunning == 0) {
+		BMessage message(FILE_SEARCH_DONE);
+		message.AddInt32("generation", fGeneration);
+		message.AddInt32("files", filesCount);
+		message.AddInt32("binaries", fBinaries);
+		message.AddInt32("matches", fMatches);
+		message.AddInt64("elapsed", system_time() - fStartTime);
+		message.AddBool("canceled", fCancel);
+		_Send(message);
+	}
+}
+
+ssize_t
+FileSearcher::_Find(const char* text, size_t length, size_t start) const
+{
+	if (fRegex == nullptr)
+		return fSearch->Find(text, length, start);
+
+	TextRegex::match found;
+	if (fRegex->Search(text, length, start, found) == false)
+		return -1;
+
+	return found.start;
+}
+
+/*
+ * One result per matching line, lines counted with memchr between matches
+ */
+int32
+FileSearcher::_SearchText(int32 file, const char* text, size_t length,
+	BMessage& batch)
+{
+	if (fRegex != nullptr && fSearch != nullptr
+		&& fSearch->Find(text, length, 0) < 0)
+		return 0;
+
+	int32 count = 0;
+	int32 line = 1;
+	size_t start = 0;
+	size_t counted = 0;
+	size_t lineStart = 0;
+	ssize_t position;
+
+	while (fCancel == false
+		&& (position = _Find(text, length, start)) >= 0) {
+
+		const char* newLine;
+		while ((newLine = static_cast<const char*>(memchr(text + counted, '\n',
+				position - counted))) != nullptr) {
+			line++;
+			counted = newLine - text + 1;
+			lineStart = counted;
+		}
+		counted = position;
+
+		const char* lineEnd = static_cast<const char*>(memchr(text + position,
+			'\n', length - position));
+		size_t end = lineEnd != nullptr ? lineEnd - text : length;
+		size_t snippetEnd = std::min<size_t>(end, lineStart + kFileSearchSnippetLength);
+
+		BString snippet(text + lineStart, snippetEnd - lineStart);
+		snippet.Trim();
+
+		batch.AddInt32("file", file);
+		batch.AddInt32("line", line);
+		batch.AddString("text", snippet);
+		count++;
+
+		int32 batched = 0;
+		batch.GetInfo("line", nullptr, &batched);
+		if (batched >= kFileSearchBatchSize)
+			_SendBatch(batch);
+
+		if (end >= length)
+			break;
+		start = end + 1;
+	}
+
+	fMatches += count;
+
+	return count;
+}
+
+/*
+ * Target may be joining the workers from its own thread, which then stops
+ * draining its port
+ */
+void
+FileSearcher::_Send(BMessage& message)
+{
+	status_t status;
+
+	do {
+		status = fTarget.SendMessage(&message, (BHandler*)nullptr,
+			fCancel == true ? 0 : kFileSearchSendTimeout);
+	} while ((status == B_TIMED_OUT || status == B_WOULD_BLOCK)
+		&& fCancel == false);
+}
+
+void
+FileSearcher::_SendBatch(BMessage& batch)
+{
+	int32 batched = 0;
+	batch.GetInfo("line", nullptr, &batched);
+	if (batched == 0)
+		return;
+
+	_Send(batch);
+
+	batch.MakeEmpty();
+	batch.AddInt32("generation", fGeneration);
+}
+
+void
+FileSearcher::_WaitWorkers()
+{
+	for (thread_id worker : fWorkers) {
+		status_t result;
+		wait_for_thread(worker, &result);
+	}
+	fWorkers.clear();
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef FILE_SEARCHER_H
+#define FILE_SEARCHER_H
+
+#include <Messenger.h>
+#include <OS.h>
+#include <String.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TextRegex.h"
+#include "TextSearch.h"
+
+enum {
+	FILE_SEARCH_RESULTS				= 'FSre',
+	FILE_SEARCH_DONE				= 'FSdo'
+};
+
+// Results are sent in batches of this size at most
+constexpr auto kFileSearchBatchSize = 256;
+// Line text sent along a result is cut at this length
+constexpr auto kFileSearchSnippetLength = 160;
+
+/*
+ * Searches a list of files for a literal or a regular expression on a
+ * pool of worker threads. Files are mapped in memory, binaries are skipped
+ * and buffers added with AddBuffer() (i.e. unsaved editors) are searched
+ * instead of their file. Files lacking the literal every regular
+ * expression match must contain are skipped without running it.
+ *
+ * FILE_SEARCH_RESULTS carries "generation" and for each result
+ * "file" (index in the list), "line" (1 based) and "text".
+ * FILE_SEARCH_DONE carries "generation", "files", "binaries", "matches",
+ * "elapsed" and "canceled".
+ * Sends never block on a full target port, Cancel() joins the workers: once
+ * canceled what does not fit is dropped.
+ */
+class FileSearcher {
+public:
+								FileSearcher(const BMessenger& target);
+								~FileSearcher();
+
+			void				AddBuffer(const BString& path, const char* text,
+									size_t length);
+			status_t			Start(const BString& pattern, bool matchCase,
+									bool wholeWord, bool regex,
+									const std::vector<BString>& files);
+			void				Cancel();
+
+			bool				IsRunning() const;
+			int32				Generation() const { return fGeneration; }
+		const BString&			FileAt(int32 index) const { return fFiles[index]; }
+
+private:
+	static	status_t			_WorkerEntry(void* data);
+			void				_Worker();
+			ssize_t				_Find(const char* text, size_t length,
+									size_t start) const;
+			int32				_SearchText(int32 file, const char* text,
+									size_t length, BMessage& batch);
+			void				_Send(BMessage& message);
+			void				_SendBatch(BMessage& batch);
+			void				_WaitWorkers();
+
+			BMessenger			fTarget;
+			TextSearch*			fSearch;
+			std::shared_ptr<const TextRegex>	fRegex;
+			std::vector<BString>	fFiles;
+			std::map<BString, std::string>	fBuffers;
+			std::vector<thread_id>	fWorkers;
+
+			int32				fGeneration;
+			bigtime_t			fStartTime;
+			std::atomic<bool>	fCancel;
+			std::atomic<int32>	fNextFile;
+			std::atomic<int32>	fRunning;
+			std::atomic<int32>	fBinaries;
+			std::atomic<int32>	fMatches;
+};
+
+#endif // FILE_SEARCHER_H
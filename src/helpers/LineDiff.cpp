@@ -0,0 +1,205 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "LineDiff.h"
+
+#include <algorithm>
+#include <cstring>
+
+LineDiff::LineDiff(const char* oldText, size_t oldLength,
+	const char* newText, size_t newLength)
+	:
+	fOldText(oldText)
+	, fOldLength(oldLength)
+	, fNewText(newText)
+	, fNewLength(newLength)
+	, fFallback(false)
+{
+}
+
+void
+LineDiff::Compute(int32 maxCost)
+{
+	fHunks.clear();
+	fFallback = false;
+
+	_SplitLines(fOldText, fOldLength, fOldLines);
+	_SplitLines(fNewText, fNewLength, fNewLines);
+
+	int32 oldEnd = fOldLines.size();
+	int32 newEnd = fNewLines.size();
+	int32 start = 0;
+
+	// Trim common prefix and suffix
+	while (start < oldEnd && start < newEnd && _Equal(start, start))
+		start++;
+	while (oldEnd > start && newEnd > start && _Equal(oldEnd - 1, newEnd - 1)) {
+		oldEnd--;
+		newEnd--;
+	}
+
+	if (start == oldEnd && start == newEnd)
+		return;
+
+	if (start == oldEnd || start == newEnd) {
+		fHunks.push_back({start, oldEnd - start, start, newEnd - start});
+		return;
+	}
+
+	_Myers(start, oldEnd, newEnd, maxCost);
+}
+
+size_t
+LineDiff::OldOffset(int32 line) const
+{
+	if (line >= (int32)fOldLines.size())
+		return fOldLength;
+
+	return fOldLines[line].offset;
+}
+
+size_t
+LineDiff::NewOffset(int32 line) const
+{
+	if (line >= (int32)fNewLines.size())
+		return fNewLength;
+
+	return fNewLines[line].offset;
+}
+
+bool
+LineDiff::_Equal(int32 oldLine, int32 newLine) const
+{
+	const line& a = fOldLines[oldLine];
+	const line& b = fNewLines[newLine];
+
+	return a.hash == b.hash && a.length == b.length
+		&& memcmp(fOldText + a.offset, fNewText + b.offset, a.length) == 0;
+}
+
+/*
+ * Greedy forward Myers keeping the furthest reaching paths of every step
+ * for backtracking, so memory is O(D^2) and D is capped by maxCost.
+ */
+void
+LineDiff::_Myers(int32 start, int32 oldEnd, int32 newEnd, int32 maxCost)
+{
+	const int32 n = oldEnd - start;
+	const int32 m = newEnd - start;
+	const int32 max = std::min(n + m, maxCost);
+	const int32 offset = max + 1;
+
+	std::vector<int32> v(2 * max + 3, 0);
+	std::vector<std::vector<int32> > trace;
+	int32 cost = -1;
+
+	for (int32 d = 0; d <= max && cost < 0; d++) {
+		for (int32 k = -d; k <= d; k += 2) {
+			int32 x;
+			if (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]))
+				x = v[offset + k + 1];
+			else
+				x = v[offset + k - 1] + 1;
+			int32 y = x - k;
+
+			while (x < n && y < m && _Equal(start + x, start + y)) {
+				x++;
+				y++;
+			}
+			v[offset + k] = x;
+
+			if (x >= n && y >= m) {
+				cost = d;
+				break;
+			}
+		}
+		trace.push_back(std::vector<int32>(v.begin() + offset - d,
+			v.begin() + offset + d + 1));
+	}
+
+	// Too different, replace the whole middle
+	if (cost < 0) {
+		fFallback = true;
+		fHunks.push_back({start, n, start, m});
+		return;
+	}
+
+	// Backtrack collecting matching line pairs, last first
+	std::vector<std::pair<int32, int32> > matches;
+	int32 x = n;
+	int32 y = m;
+
+	for (int32 d = cost; d > 0; d--) {
+		const std::vector<int32>& previous = trace[d - 1];
+		// previous holds k in [-(d - 1), d - 1]
+		int32 k = x - y;
+		int32 previousK;
+		if (k == -d || (k != d && previous[k - 1 + d - 1] < previous[k + 1 + d - 1]))
+			previousK = k + 1;
+		else
+			previousK = k - 1;
+
+		int32 previousX = previous[previousK + d - 1];
+		int32 previousY = previousX - previousK;
+
+		// Snake after the edit
+		while (x > previousX && y > previousY) {
+			x--;
+			y--;
+			matches.push_back(std::make_pair(x, y));
+		}
+
+		x = previousX;
+		y = previousY;
+	}
+
+	while (x > 0 && y > 0) {
+		x--;
+		y--;
+		matches.push_back(std::make_pair(x, y));
+	}
+
+	// Gaps between matches are the hunks
+	int32 oldLine = 0;
+	int32 newLine = 0;
+	for (auto it = matches.rbegin(); it != matches.rend(); ++it) {
+		if (it->first > oldLine || it->second > newLine)
+			fHunks.push_back({start + oldLine, it->first - oldLine,
+				start + newLine, it->second - newLine});
+		oldLine = it->first + 1;
+		newLine = it->second + 1;
+	}
+	if (oldLine < n || newLine < m)
+		fHunks.push_back({start + oldLine, n - oldLine,
+			start + newLine, m - newLine});
+}
+
+/*
+ * Lines are split as scintilla does: at LF, CRLF and lone CR.
+ * Hash is FNV-1a, full comparison is still done on hash match.
+ */
+void
+LineDiff::_SplitLines(const char* text, size_t length, std::vector<line>& lines)
+{
+	lines.clear();
+
+	size_t begin = 0;
+	uint64 hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < length; i++) {
+		char c = text[i];
+		hash = (hash ^ (uint8)c) * 1099511628211ULL;
+
+		bool end = c == '\n' || (c == '\r' && (i + 1 == length || text[i + 1] != '\n'));
+		if (end == true) {
+			lines.push_back({begin, i + 1 - begin, hash});
+			begin = i + 1;
+			hash = 14695981039346656037ULL;
+		}
+	}
+
+	if (begin < length)
+		lines.push_back({begin, length - begin, hash});
+}
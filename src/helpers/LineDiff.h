@@ -0,0 +1,65 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef LINE_DIFF_H
+#define LINE_DIFF_H
+
+#include <SupportDefs.h>
+
+#include <vector>
+
+// Maximum edit cost (inserted + deleted lines) searched by Myers algorithm,
+// beyond it the differing middle is returned as a single hunk
+constexpr auto kLineDiffMaxCost = 1000;
+
+/*
+ * Line based diff (Myers O(ND)) between two texts, after trimming the
+ * common prefix and suffix. Lines keep their terminator (LF, CRLF or CR)
+ * so hunks map straight to byte ranges of both texts.
+ */
+class LineDiff {
+public:
+	struct hunk {
+		int32	oldStart;
+		int32	oldCount;
+		int32	newStart;
+		int32	newCount;
+	};
+
+							LineDiff(const char* oldText, size_t oldLength,
+								const char* newText, size_t newLength);
+
+			void			Compute(int32 maxCost = kLineDiffMaxCost);
+
+	const	std::vector<hunk>&	Hunks() const { return fHunks; }
+			bool			IsFallback() const { return fFallback; }
+
+			size_t			OldOffset(int32 line) const;
+			size_t			NewOffset(int32 line) const;
+
+private:
+	struct line {
+		size_t	offset;
+		size_t	length;
+		uint64	hash;
+	};
+
+			bool			_Equal(int32 oldLine, int32 newLine) const;
+			void			_Myers(int32 start, int32 oldEnd, int32 newEnd,
+								int32 maxCost);
+			void			_SplitLines(const char* text, size_t length,
+								std::vector<line>& lines);
+
+			const char*		fOldText;
+			size_t			fOldLength;
+			const char*		fNewText;
+			size_t			fNewLength;
+
+			std::vector<line>	fOldLines;
+			std::vector<line>	fNewLines;
+			std::vector<hunk>	fHunks;
+			bool			fFallback;
+};
+
+#endif // LINE_DIFF_H
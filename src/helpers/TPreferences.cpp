@@ -19,9 +19,127 @@
 #include <Directory.h>
 #include <String.h>
 #include <NodeInfo.h>
+#include <OS.h>
+
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
 
 #include "TPreferences.h"
 
+//
+// Process wide cache, one entry per settings file.
+// Flat bytes are what gets written.
+//
+struct cache_entry {
+	BMessage		message;
+	std::string		flat;
+	int64			generation;
+	// Not yet written
+	bool			dirty;
+	// File as last read or written, looked at then
+	bigtime_t		checked;
+	bool			exists;
+	dev_t			device;
+	ino_t			node;
+	off_t			size;
+	bigtime_t		modified;
+};
+
+static std::mutex sCacheLock;
+static std::map<BString, cache_entry> sCache;
+static int64 sGeneration = 0;
+static TPreferences::cache_stats sStats = {};
+// Writes one file at a time, in order
+static std::mutex sFlushLock;
+static thread_id sFlushThread = -1;
+static sem_id sFlushSem = -1;
+
+static bigtime_t
+modification_time(const struct stat& st)
+{
+	return (bigtime_t)st.st_mtim.tv_sec * 1000000 + st.st_mtim.tv_nsec / 1000;
+}
+
+// Entry matches the file on disk
+static bool
+entry_current(cache_entry& entry, const char* path)
+{
+	struct stat st;
+	entry.checked = system_time();
+	if (stat(path, &st) != 0)
+		return entry.exists == false;
+
+	return entry.exists == true && entry.device == st.st_dev
+		&& entry.node == st.st_ino && entry.size == st.st_size
+		&& entry.modified == modification_time(st);
+}
+
+static void
+entry_stamp(cache_entry& entry, const char* path)
+{
+	struct stat st;
+	entry.checked = system_time();
+	entry.exists = stat(path, &st) == 0;
+	if (entry.exists == true) {
+		entry.device = st.st_dev;
+		entry.node = st.st_ino;
+		entry.size = st.st_size;
+		entry.modified = modification_time(st);
+	}
+}
+
+static std::string
+flatten(const BMessage& message)
+{
+	std::string flat(message.FlattenedSize(), '\0');
+	if (message.Flatten(&flat[0], flat.size()) != B_OK)
+		flat.clear();
+	return flat;
+}
+
+//
+// Cached entry of path, read again if missing or out of date. The file is
+// not looked at if it was less than recheck ago.
+// sCacheLock must be held.
+//
+static cache_entry&
+cache_lookup(const BString& path, uint32 command, status_t& status,
+	bigtime_t recheck = 0)
+{
+	auto it = sCache.find(path);
+	if (it != sCache.end() && (it->second.dirty == true
+			|| system_time() - it->second.checked < recheck
+			|| entry_current(it->second, path))) {
+		sStats.hits++;
+		// Empty if never read nor written
+		status = it->second.flat.empty() == false ? B_OK : B_ENTRY_NOT_FOUND;
+		return it->second;
+	}
+
+	sStats.misses++;
+
+	cache_entry& entry = sCache[path];
+	entry.message = BMessage(command);
+	entry.dirty = false;
+	entry_stamp(entry, path);
+
+	BFile file;
+	status = file.SetTo(path, B_READ_ONLY);
+	if (status == B_OK)
+		status = entry.message.Unflatten(&file);
+	if (status != B_OK)
+		entry.message = BMessage(command);
+
+	entry.flat = status == B_OK ? flatten(entry.message) : std::string();
+	entry.generation = ++sGeneration;
+
+	return entry;
+}
+
 //
 // TPreferences::TPreferences
 //
@@ -31,32 +149,28 @@ TPreferences::TPreferences(const BString filename, const BString directory,
 							uint32 command)
 	: 
  	BMessage(command)
+	, fDiscard(false)
 {
-	BFile file;
-
-	fStatus = find_directory(B_USER_SETTINGS_DIRECTORY, &fPath);
+	fStatus = _SettingsPath(filename, directory, fPath);
 	if (fStatus != B_OK) {
+		fPath.Unset();
 		return;
 	}
 
-	BDirectory appFolder;
-	fPath.Append(directory);
-	
-	fStatus = appFolder.CreateDirectory(fPath.Path(), NULL);
-
-	fPath.Append(filename);
-
-	fStatus = file.SetTo(fPath.Path(), B_READ_ONLY);
+	std::lock_guard<std::mutex> guard(sCacheLock);
+	cache_entry& entry = cache_lookup(fPath.Path(), command, fStatus);
 	if (fStatus == B_OK) {
-		fStatus = Unflatten(&file);
-	}
-
+		BMessage::operator=(entry.message);
+		fFlat = entry.flat;
+	} else
+		fFlat = flatten(*this);
 }
 
 //
 // TPreferences::~TPreferences
 //
-// Write the preferences to disk.
+// Put the preferences back in the cache and have them written, if this
+// instance changed them: an unchanged one may be older than the cache.
 //
 TPreferences::~TPreferences() {
 
@@ -69,11 +183,230 @@ TPreferences::~TPreferences() {
 	if (what == 'XXXX')
 		PrintToStream();
 
+	if (fPath.Path() == NULL || fDiscard == true)
+		return;
+
+	const std::string flat = flatten(*this);
+
+	std::unique_lock<std::mutex> guard(sCacheLock);
+
+	if (flat == fFlat) {
+		sStats.clean++;
+		return;
+	}
+
+	sStats.dirty++;
+
+	cache_entry& entry = sCache[fPath.Path()];
+	entry.message = *this;
+	entry.flat = flat;
+	entry.generation = ++sGeneration;
+	if (entry.dirty == true)
+		return;
+	entry.dirty = true;
+
+	if (sFlushThread < 0) {
+		sFlushSem = create_sem(0, "preferences flush");
+		sFlushThread = spawn_thread(_FlushThread, "preferences flush",
+			B_LOW_PRIORITY, NULL);
+		if (sFlushSem < 0 || sFlushThread < 0
+			|| resume_thread(sFlushThread) != B_OK) {
+			// Written right away then
+			sFlushThread = -1;
+		}
+	}
+
+	if (sFlushThread >= 0)
+		release_sem_etc(sFlushSem, 1, B_DO_NOT_RESCHEDULE);
+	else {
+		guard.unlock();
+		_FlushEntry(fPath.Path());
+	}
+}
+
+//
+// TPreferences::Generation
+//
+// Number changing with the cached contents, -1 if not available.
+// Asked on every project settings read, so the file is only looked at
+// once per PREFERENCES_RECHECK_DELAY.
+//
+int64
+TPreferences::Generation(const BString& filename, const BString& directory)
+{
+	BPath path;
+	if (_SettingsPath(filename, directory, path) != B_OK)
+		return -1;
+
+	std::lock_guard<std::mutex> guard(sCacheLock);
+	status_t status;
+	cache_entry& entry = cache_lookup(path.Path(), 0, status,
+		PREFERENCES_RECHECK_DELAY);
+
+	return entry.generation;
+}
+
+//
+// TPreferences::Evict
+//
+// Forget a file, pending changes too (i.e. before removing it).
+//
+void
+TPreferences::Evict(const BString& filename, const BString& directory)
+{
+	BPath path;
+	if (_SettingsPath(filename, directory, path) != B_OK)
+		return;
+
+	std::lock_guard<std::mutex> flushGuard(sFlushLock);
+	std::lock_guard<std::mutex> guard(sCacheLock);
+	sCache.erase(path.Path());
+}
+
+//
+// TPreferences::FlushAll
+//
+// Write all changed files now, as on quitting.
+//
+void
+TPreferences::FlushAll()
+{
+	std::vector<BString> paths;
+	{
+		std::lock_guard<std::mutex> guard(sCacheLock);
+		for (auto& it : sCache)
+			if (it.second.dirty == true)
+				paths.push_back(it.first);
+	}
+
+	for (const BString& path : paths)
+		_FlushEntry(path);
+}
+
+//
+// TPreferences::GetStats
+//
+// Cache counters since start.
+//
+void
+TPreferences::GetStats(cache_stats& stats)
+{
+	std::lock_guard<std::mutex> guard(sCacheLock);
+	stats = sStats;
+}
+
+//
+// TPreferences::_FlushEntry
+//
+// Write to a temporary file then rename it over the old one: readers see
+// either version, never a mix. Changes made meanwhile keep it dirty.
+//
+status_t
+TPreferences::_FlushEntry(const BString& path)
+{
+	std::lock_guard<std::mutex> flushGuard(sFlushLock);
+
+	std::string flat;
+	int64 generation;
+	{
+		std::lock_guard<std::mutex> guard(sCacheLock);
+		auto it = sCache.find(path);
+		if (it == sCache.end() || it->second.dirty == false)
+			return B_OK;
+		flat = it->second.flat;
+		generation = it->second.generation;
+	}
+
+	BString temporary(path);
+	temporary << ".tmp";
+
+	status_t status;
 	BFile file;
-	
-	if (file.SetTo(fPath.Path(), B_WRITE_ONLY | B_CREATE_FILE) == B_OK) {
-		Flatten(&file);
+	if ((status = file.SetTo(temporary, B_WRITE_ONLY | B_CREATE_FILE
+			| B_ERASE_FILE)) == B_OK) {
+		ssize_t written = file.Write(flat.data(), flat.size());
+		if (written < 0)
+			status = written;
+		else if ((size_t)written != flat.size())
+			status = B_IO_ERROR;
+		else
+			status = file.Sync();
+		file.Unset();
+
+		if (status == B_OK && rename(temporary, path) != 0)
+			status = B_ERROR;
+		if (status != B_OK)
+			remove(temporary);
+	}
+
+	std::lock_guard<std::mutex> guard(sCacheLock);
+	if (status != B_OK) {
+		sStats.errors++;
+		// Not retried, it would likely fail again
+		auto it = sCache.find(path);
+		if (it != sCache.end() && it->second.generation == generation)
+			it->second.dirty = false;
+		return status;
+	}
+
+	sStats.flushes++;
+
+	auto it = sCache.find(path);
+	if (it != sCache.end() && it->second.generation == generation) {
+		it->second.dirty = false;
+		entry_stamp(it->second, path);
 	}
+
+	return B_OK;
+}
+
+//
+// TPreferences::_FlushThread
+//
+// Waits for changes, then gives others PREFERENCES_FLUSH_DELAY to come
+// and writes them all.
+//
+status_t
+TPreferences::_FlushThread(void* data)
+{
+	while (acquire_sem(sFlushSem) == B_OK) {
+		snooze(PREFERENCES_FLUSH_DELAY);
+		FlushAll();
+
+		// Changed while writing, their wake up was skipped
+		bool dirty = false;
+		{
+			std::lock_guard<std::mutex> guard(sCacheLock);
+			for (auto& it : sCache)
+				dirty |= it.second.dirty;
+		}
+		if (dirty == true)
+			release_sem_etc(sFlushSem, 1, B_DO_NOT_RESCHEDULE);
+	}
+
+	return B_OK;
+}
+
+//
+// TPreferences::_SettingsPath
+//
+// File under the user settings directory, directory created if missing.
+//
+status_t
+TPreferences::_SettingsPath(const BString& filename, const BString& directory,
+	BPath& path)
+{
+	status_t status = find_directory(B_USER_SETTINGS_DIRECTORY, &path);
+	if (status != B_OK) {
+		return status;
+	}
+
+	BDirectory appFolder;
+	path.Append(directory);
+
+	appFolder.CreateDirectory(path.Path(), NULL);
+
+	return path.Append(filename);
 }
 
 status_t TPreferences::SetBool(const char *name, bool b) {
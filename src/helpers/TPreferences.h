@@ -18,15 +18,45 @@
 #include <File.h>
 #include <FindDirectory.h>
 
+#include <string>
 
+// Writes are deferred by this much, so bursts make one write
+#define PREFERENCES_FLUSH_DELAY 500000
+// Generation() looks at the file on disk at most this often
+#define PREFERENCES_RECHECK_DELAY 1000000
 
+//
+// Files are cached process wide: an instance starts from a copy of the
+// cached message (read again if the file changed on disk) and on
+// destruction puts back its contents, if it changed them. Changed files are
+// written by a background thread after PREFERENCES_FLUSH_DELAY, to a
+// temporary file renamed over the old one. FlushAll() writes them now.
+//
 class TPreferences : public BMessage {
 public:
+	struct cache_stats {
+		int64		hits;
+		int64		misses;
+		int64		clean;		// instances done without changes
+		int64		dirty;
+		int64		flushes;	// files written
+		int64		errors;
+	};
+
 					TPreferences(const BString filename, const BString directory,
 						uint32 command);
 					~TPreferences();
 
 	status_t		InitCheck(void);
+	// Changes of this instance are not kept
+	void			Discard() { fDiscard = true; }
+
+	// Changes with the file contents, cached or written. Changes by others
+	// are seen after up to PREFERENCES_RECHECK_DELAY
+	static int64	Generation(const BString& filename, const BString& directory);
+	static void		Evict(const BString& filename, const BString& directory);
+	static void		FlushAll();
+	static void		GetStats(cache_stats& stats);
 	
 	status_t		SetBool(const char *name, bool b);
 	status_t		SetInt8(const char *name, int8 i);
@@ -43,9 +73,16 @@ public:
 	status_t		SetFlat(const char *name, const BFlattenable *obj);
 	
 private:
-	
+	static status_t	_FlushEntry(const BString& path);
+	static status_t	_FlushThread(void* data);
+	static status_t	_SettingsPath(const BString& filename,
+						const BString& directory, BPath& path);
+
 	BPath			fPath;
 	status_t		fStatus;
+	bool			fDiscard;
+	// Contents when made, tell whether this instance changed them
+	std::string		fFlat;
 };
 
 inline status_t TPreferences::InitCheck(void) {
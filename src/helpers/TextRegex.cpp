@@ -0,0 +1,1104 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextRegex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <list>
+#include <mutex>
+
+// Nesting and counted repetition limits, keep parsing and programs small
+static constexpr auto kTextRegexMaxDepth = 256;
+static constexpr auto kTextRegexMaxRepeat = 1000;
+// First window searched by SearchBackward()
+static constexpr auto kTextRegexBackwardWindow = 4096;
+
+enum {
+	kNodeEmpty = 0,
+	kNodeByte,
+	kNodeClass,
+	kNodeAny,
+	kNodeAssert,
+	kNodeGroup,
+	kNodeConcat,
+	kNodeAlternate,
+	kNodeRepeat
+};
+
+enum {
+	kOpByte = 0,
+	kOpClass,
+	kOpAny,
+	kOpSplit,
+	kOpJump,
+	kOpSave,
+	kOpAssert,
+	kOpMatch
+};
+
+enum {
+	kAssertLineStart = 0,
+	kAssertLineEnd,
+	kAssertWordBoundary,
+	kAssertNotWordBoundary,
+	kAssertWordStart,
+	kAssertWordEnd,
+	// Whole word option, as TextSearch: match edge not inside a word
+	kAssertNotInWord
+};
+
+struct TextRegex::vm_state {
+	std::vector<int32>		threads[2];
+	std::vector<ssize_t>	groups[2];
+	std::vector<uint32>		marks;
+	uint32					generation[2];
+	uint32					counter;
+	// Pending pcs, or group slots to restore (slot >= 0)
+	struct entry {
+		int32				pc;
+		int32				slot;
+		ssize_t				value;
+	};
+	std::vector<entry>		stack;
+	std::vector<ssize_t>	seed;
+};
+
+static inline bool
+is_word_char(uint8 c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+		|| (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+static inline uint8
+fold(uint8 c)
+{
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static int
+hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+TextRegex::TextRegex(const char* pattern, size_t length,
+	bool matchCase, bool wholeWord)
+	:
+	fPattern(pattern, length)
+	, fParse(0)
+	, fMatchCase(matchCase)
+	, fWholeWord(wholeWord)
+	, fStatus(B_OK)
+	, fGroups(0)
+	, fFirstAll(false)
+{
+	int32 root = _ParseAlternation(0);
+
+	if (fStatus == B_OK && fParse < fPattern.size())
+		_SetError("unmatched )");
+
+	if (fStatus != B_OK)
+		return;
+
+	// Plain literal: leave it to TextSearch
+	bool literal = fGroups == 0;
+	std::string bytes;
+	const node& top = fNodes[root];
+	if (top.type == kNodeByte)
+		bytes += (char)top.value;
+	else if (top.type == kNodeConcat) {
+		for (int32 child : top.children) {
+			if (fNodes[child].type != kNodeByte) {
+				literal = false;
+				break;
+			}
+			bytes += (char)fNodes[child].value;
+		}
+	} else
+		literal = false;
+
+	if (literal == true && bytes.empty() == false) {
+		fLiteral.reset(new TextSearch(bytes.data(), bytes.size(),
+			fMatchCase, fWholeWord));
+		fRequired = bytes;
+		if (fMatchCase == false)
+			std::transform(fRequired.begin(), fRequired.end(),
+				fRequired.begin(), fold);
+		return;
+	}
+
+	std::string run;
+	_Literals(root, run, fRequired);
+
+	if (fWholeWord == true)
+		fProgram.push_back({kOpAssert, kAssertNotInWord, 0});
+	fProgram.push_back({kOpSave, 0, 0});
+	_Emit(root);
+	fProgram.push_back({kOpSave, 1, 0});
+	if (fWholeWord == true)
+		fProgram.push_back({kOpAssert, kAssertNotInWord, 0});
+	fProgram.push_back({kOpMatch, 0, 0});
+
+	if (fStatus != B_OK)
+		return;
+
+	// Nodes are not needed past compilation
+	fNodes.clear();
+	fNodes.shrink_to_fit();
+
+	_FirstBytes();
+}
+
+/*
+ * Recently used patterns are kept compiled: find next, mark all and
+ * replace on the same pattern compile once.
+ */
+/* static */
+std::shared_ptr<const TextRegex>
+TextRegex::Compile(const BString& pattern, bool matchCase, bool wholeWord)
+{
+	static std::mutex sLock;
+	static std::list<std::shared_ptr<const TextRegex>> sCache;
+
+	std::lock_guard<std::mutex> lock(sLock);
+
+	for (auto it = sCache.begin(); it != sCache.end(); it++) {
+		const TextRegex* regex = it->get();
+		if (regex->fMatchCase == matchCase && regex->fWholeWord == wholeWord
+			&& regex->fPattern.size() == (size_t)pattern.Length()
+			&& regex->fPattern.compare(0, std::string::npos,
+				pattern.String(), pattern.Length()) == 0) {
+			sCache.splice(sCache.begin(), sCache, it);
+			return sCache.front();
+		}
+	}
+
+	sCache.emplace_front(new TextRegex(pattern.String(), pattern.Length(),
+		matchCase, wholeWord));
+	if (sCache.size() > kTextRegexCacheSize)
+		sCache.pop_back();
+
+	return sCache.front();
+}
+
+/*
+ * Leftmost match starting at or after start and before "before". Text
+ * before start is still looked at by ^ and word assertions.
+ */
+bool
+TextRegex::Search(const char* text, size_t length, size_t start,
+	match& result, size_t before /* = SIZE_MAX */) const
+{
+	vm_state state;
+	return _Search(state, text, length, start, before, result);
+}
+
+/*
+ * Match starting exactly at position
+ */
+bool
+TextRegex::MatchAt(const char* text, size_t length, size_t position,
+	match& result) const
+{
+	vm_state state;
+	return _Search(state, text, length, position, position + 1, result);
+}
+
+/*
+ * Last match starting before position. Windows before position are
+ * searched forward, doubling in size until one holds a match, so the
+ * cost follows the distance to that match rather than the text size.
+ */
+bool
+TextRegex::SearchBackward(const char* text, size_t length, size_t position,
+	match& result) const
+{
+	vm_state state;
+	match found;
+	size_t before = std::min(position, length + 1);
+	size_t window = kTextRegexBackwardWindow;
+
+	while (before > 0) {
+		size_t from = before > window ? before - window : 0;
+		size_t start = from;
+		bool hit = false;
+
+		while (start < before
+			&& _Search(state, text, length, start, before, found) == true) {
+			result = found;
+			hit = true;
+			start = found.end > found.start ? found.end : found.end + 1;
+		}
+
+		if (hit == true)
+			return true;
+
+		before = from;
+		window *= 2;
+	}
+
+	return false;
+}
+
+/*
+ * Non overlapping matches, an empty match moves the next search one byte on
+ */
+size_t
+TextRegex::FindAll(const char* text, size_t length,
+	std::vector<match>& matches) const
+{
+	vm_state state;
+	match found;
+	size_t start = 0;
+	size_t count = 0;
+
+	while (start <= length
+		&& _Search(state, text, length, start, SIZE_MAX, found) == true) {
+		matches.push_back(found);
+		count++;
+		start = found.end > found.start ? found.end : found.end + 1;
+	}
+
+	return count;
+}
+
+/*
+ * \0 to \9 are replaced by the group text, \n \t and \\ are unescaped
+ */
+void
+TextRegex::Expand(const char* replacement, size_t length, const char* text,
+	const match& found, std::string& expanded) const
+{
+	for (size_t i = 0; i < length; i++) {
+		char c = replacement[i];
+		if (c != '\\' || i + 1 == length) {
+			expanded += c;
+			continue;
+		}
+
+		c = replacement[++i];
+		if (c >= '0' && c <= '9') {
+			size_t group = c - '0';
+			if (group * 2 + 1 < found.groups.size()
+				&& found.groups[group * 2] >= 0
+				&& found.groups[group * 2 + 1] >= 0)
+				expanded.append(text + found.groups[group * 2],
+					found.groups[group * 2 + 1] - found.groups[group * 2]);
+		} else if (c == 'n')
+			expanded += '\n';
+		else if (c == 't')
+			expanded += '\t';
+		else if (c == '\\')
+			expanded += '\\';
+		else {
+			expanded += '\\';
+			expanded += c;
+		}
+	}
+}
+
+int32
+TextRegex::_ParseAlternation(int32 depth)
+{
+	if (depth > kTextRegexMaxDepth) {
+		_SetError("nested too deep");
+		return -1;
+	}
+
+	int32 first = _ParseConcatenation(depth);
+	if (fStatus != B_OK || fParse >= fPattern.size() || fPattern[fParse] != '|')
+		return first;
+
+	int32 alternate = _NewNode(kNodeAlternate);
+	fNodes[alternate].children.push_back(first);
+
+	while (fStatus == B_OK && fParse < fPattern.size()
+		&& fPattern[fParse] == '|') {
+		fParse++;
+		int32 child = _ParseConcatenation(depth);
+		fNodes[alternate].children.push_back(child);
+	}
+
+	return alternate;
+}
+
+int32
+TextRegex::_ParseConcatenation(int32 depth)
+{
+	int32 concat = _NewNode(kNodeConcat);
+
+	while (fStatus == B_OK && fParse < fPattern.size()
+		&& fPattern[fParse] != '|' && fPattern[fParse] != ')') {
+		int32 child = _ParseRepeat(depth);
+		if (fStatus != B_OK)
+			break;
+		fNodes[concat].children.push_back(child);
+	}
+
+	if (fNodes[concat].children.size() == 1)
+		return fNodes[concat].children[0];
+
+	return concat;
+}
+
+int32
+TextRegex::_ParseRepeat(int32 depth)
+{
+	int32 atom = _ParseAtom(depth);
+
+	while (fStatus == B_OK && fParse < fPattern.size()) {
+		char c = fPattern[fParse];
+		int32 min, max;
+
+		if (c == '*') {
+			min = 0;
+			max = -1;
+			fParse++;
+		} else if (c == '+') {
+			min = 1;
+			max = -1;
+			fParse++;
+		} else if (c == '?') {
+			min = 0;
+			max = 1;
+			fParse++;
+		} else if (c == '{') {
+			// {n}, {n,} or {n,m}, anything else is a literal brace.
+			// Counts stop growing past the maximum, digits are all read.
+			size_t i = fParse + 1;
+			size_t digits = i;
+			min = 0;
+			for (; i < fPattern.size() && isdigit(fPattern[i]); i++) {
+				if (min <= kTextRegexMaxRepeat)
+					min = min * 10 + fPattern[i] - '0';
+			}
+			if (i == digits)
+				break;
+			max = min;
+			if (i < fPattern.size() && fPattern[i] == ',') {
+				i++;
+				max = -1;
+				if (i < fPattern.size() && isdigit(fPattern[i])) {
+					max = 0;
+					for (; i < fPattern.size() && isdigit(fPattern[i]); i++) {
+						if (max <= kTextRegexMaxRepeat)
+							max = max * 10 + fPattern[i] - '0';
+					}
+				}
+			}
+			if (i >= fPattern.size() || fPattern[i] != '}')
+				break;
+			if (min > kTextRegexMaxRepeat || max > kTextRegexMaxRepeat) {
+				_SetError("repeat count too large");
+				return -1;
+			}
+			if (max >= 0 && max < min) {
+				_SetError("bad repeat range");
+				return -1;
+			}
+			fParse = i + 1;
+		} else
+			break;
+
+		int32 repeat = _NewNode(kNodeRepeat);
+		fNodes[repeat].min = min;
+		fNodes[repeat].max = max;
+		fNodes[repeat].greedy = true;
+		fNodes[repeat].children.push_back(atom);
+		if (fParse < fPattern.size() && fPattern[fParse] == '?') {
+			fNodes[repeat].greedy = false;
+			fParse++;
+		}
+		atom = repeat;
+	}
+
+	return atom;
+}
+
+int32
+TextRegex::_ParseAtom(int32 depth)
+{
+	char c = fPattern[fParse++];
+
+	switch (c) {
+		case '(': {
+			int32 group = -1;
+			if (fPattern.compare(fParse, 2, "?:") == 0)
+				fParse += 2;
+			else
+				group = ++fGroups;
+
+			int32 child = _ParseAlternation(depth + 1);
+			if (fStatus != B_OK)
+				return -1;
+			if (fParse >= fPattern.size() || fPattern[fParse] != ')') {
+				_SetError("missing )");
+				return -1;
+			}
+			fParse++;
+
+			int32 atom = _NewNode(kNodeGroup);
+			fNodes[atom].value = group;
+			fNodes[atom].children.push_back(child);
+			return atom;
+		}
+		case '[': {
+			std::vector<bool> set(256, false);
+			if (_ParseClass(set) == false)
+				return -1;
+			int32 atom = _NewNode(kNodeClass);
+			fNodes[atom].value = _NewClass(set);
+			return atom;
+		}
+		case '.':
+			return _NewNode(kNodeAny);
+		case '^': {
+			int32 atom = _NewNode(kNodeAssert);
+			fNodes[atom].value = kAssertLineStart;
+			return atom;
+		}
+		case '$': {
+			int32 atom = _NewNode(kNodeAssert);
+			fNodes[atom].value = kAssertLineEnd;
+			return atom;
+		}
+		case '*':
+		case '+':
+		case '?':
+			_SetError("nothing to repeat");
+			return -1;
+		case '\\': {
+			uint8 byte;
+			int32 klass;
+			int32 assertion;
+			if (_ParseEscape(byte, klass, assertion, false) == false)
+				return -1;
+			if (klass >= 0) {
+				int32 atom = _NewNode(kNodeClass);
+				fNodes[atom].value = klass;
+				return atom;
+			}
+			if (assertion >= 0) {
+				int32 atom = _NewNode(kNodeAssert);
+				fNodes[atom].value = assertion;
+				return atom;
+			}
+			int32 atom = _NewNode(kNodeByte);
+			fNodes[atom].value = byte;
+			return atom;
+		}
+		default: {
+			int32 atom = _NewNode(kNodeByte);
+			fNodes[atom].value = (uint8)c;
+			return atom;
+		}
+	}
+}
+
+bool
+TextRegex::_ParseClass(std::vector<bool>& set)
+{
+	bool negate = false;
+	if (fParse < fPattern.size() && fPattern[fParse] == '^') {
+		negate = true;
+		fParse++;
+	}
+
+	bool first = true;
+	while (true) {
+		if (fParse >= fPattern.size())
+			return _SetError("missing ]");
+
+		char c = fPattern[fParse++];
+		if (c == ']' && first == false)
+			break;
+		first = false;
+
+		uint8 low = c;
+		if (c == '\\') {
+			int32 klass;
+			int32 assertion;
+			if (_ParseEscape(low, klass, assertion, true) == false)
+				return false;
+			if (klass >= 0) {
+				for (int i = 0; i < 256; i++)
+					if (fClasses[klass * 256 + i] == true)
+						set[i] = true;
+				continue;
+			}
+		}
+
+		uint8 high = low;
+		if (fParse + 1 < fPattern.size() && fPattern[fParse] == '-'
+			&& fPattern[fParse + 1] != ']') {
+			fParse++;
+			high = fPattern[fParse++];
+			if (high == '\\') {
+				int32 klass;
+				int32 assertion;
+				if (_ParseEscape(high, klass, assertion, true) == false)
+					return false;
+				if (klass >= 0)
+					return _SetError("bad class range");
+			}
+			if (high < low)
+				return _SetError("bad class range");
+		}
+
+		for (int i = low; i <= high; i++)
+			set[i] = true;
+	}
+
+	if (fMatchCase == false) {
+		for (int i = 'a'; i <= 'z'; i++) {
+			if (set[i] == true || set[i - 'a' + 'A'] == true)
+				set[i] = set[i - 'a' + 'A'] = true;
+		}
+	}
+
+	if (negate == true)
+		set.flip();
+
+	return true;
+}
+
+/*
+ * Escape after the backslash, gives either a byte, a class or (outside
+ * classes) an assertion. Unknown escapes are the character itself.
+ */
+bool
+TextRegex::_ParseEscape(uint8& c, int32& klass, int32& assertion, bool inClass)
+{
+	klass = -1;
+	assertion = -1;
+
+	if (fParse >= fPattern.size())
+		return _SetError("trailing \\");
+
+	char e = fPattern[fParse++];
+	std::vector<bool> set(256, false);
+
+	switch (e) {
+		case 'd':
+		case 'D':
+			for (int i = '0'; i <= '9'; i++)
+				set[i] = true;
+			break;
+		case 'w':
+		case 'W':
+			for (int i = 0; i < 256; i++)
+				set[i] = is_word_char(i);
+			break;
+		case 's':
+		case 'S':
+			set[' '] = set['\t'] = set['\n'] = set['\r'] = true;
+			set['\f'] = set['\v'] = true;
+			break;
+		case 'b':
+			if (inClass == true) {
+				c = '\b';
+				return true;
+			}
+			assertion = kAssertWordBoundary;
+			return true;
+		case 'B':
+			assertion = kAssertNotWordBoundary;
+			return inClass == false ? true : _SetError("bad escape in class");
+		case '<':
+			assertion = kAssertWordStart;
+			return inClass == false ? true : _SetError("bad escape in class");
+		case '>':
+			assertion = kAssertWordEnd;
+			return inClass == false ? true : _SetError("bad escape in class");
+		case 't':
+			c = '\t';
+			return true;
+		case 'n':
+			c = '\n';
+			return true;
+		case 'r':
+			c = '\r';
+			return true;
+		case 'f':
+			c = '\f';
+			return true;
+		case 'v':
+			c = '\v';
+			return true;
+		case 'x': {
+			int high = fParse < fPattern.size() ? hex_value(fPattern[fParse]) : -1;
+			int low = fParse + 1 < fPattern.size() ? hex_value(fPattern[fParse + 1]) : -1;
+			if (high < 0 || low < 0)
+				return _SetError("bad \\x escape");
+			fParse += 2;
+			c = high * 16 + low;
+			return true;
+		}
+		default:
+			c = e;
+			return true;
+	}
+
+	if (isupper(e))
+		set.flip();
+	klass = _NewClass(set);
+
+	return true;
+}
+
+int32
+TextRegex::_NewNode(int32 type)
+{
+	node created;
+	created.type = type;
+	created.value = 0;
+	created.min = 1;
+	created.max = 1;
+	created.greedy = true;
+	fNodes.push_back(created);
+
+	return fNodes.size() - 1;
+}
+
+int32
+TextRegex::_NewClass(const std::vector<bool>& set)
+{
+	const size_t klass = fClasses.size() / 256;
+	fClasses.insert(fClasses.end(), set.begin(), set.end());
+
+	return klass;
+}
+
+bool
+TextRegex::_SetError(const char* error)
+{
+	if (fStatus == B_OK) {
+		fStatus = B_BAD_VALUE;
+		fError = error;
+	}
+
+	return false;
+}
+
+/*
+ * Thompson construction, alternatives and repeats become splits whose
+ * first branch is preferred
+ */
+void
+TextRegex::_Emit(int32 index)
+{
+	if (fStatus != B_OK)
+		return;
+
+	if (fProgram.size() > kTextRegexMaxProgramSize) {
+		_SetError("pattern too large");
+		return;
+	}
+
+	const node& current = fNodes[index];
+
+	switch (current.type) {
+		case kNodeEmpty:
+			break;
+		case kNodeByte:
+			fProgram.push_back({kOpByte,
+				fMatchCase ? current.value : fold(current.value), 0});
+			break;
+		case kNodeClass:
+			fProgram.push_back({kOpClass, current.value, 0});
+			break;
+		case kNodeAny:
+			fProgram.push_back({kOpAny, 0, 0});
+			break;
+		case kNodeAssert:
+			fProgram.push_back({kOpAssert, current.value, 0});
+			break;
+		case kNodeGroup:
+			if (current.value >= 0)
+				fProgram.push_back({kOpSave, current.value * 2, 0});
+			_Emit(current.children[0]);
+			if (current.value >= 0)
+				fProgram.push_back({kOpSave, current.value * 2 + 1, 0});
+			break;
+		case kNodeConcat:
+			for (int32 child : current.children)
+				_Emit(child);
+			break;
+		case kNodeAlternate: {
+			std::vector<int32> jumps;
+			for (size_t i = 0; i < current.children.size(); i++) {
+				int32 split = -1;
+				if (i + 1 < current.children.size()) {
+					split = fProgram.size();
+					fProgram.push_back({kOpSplit, split + 1, 0});
+				}
+				_Emit(current.children[i]);
+				if (split >= 0) {
+					jumps.push_back(fProgram.size());
+					fProgram.push_back({kOpJump, 0, 0});
+					fProgram[split].y = fProgram.size();
+				}
+			}
+			for (int32 jump : jumps)
+				fProgram[jump].x = fProgram.size();
+			break;
+		}
+		case kNodeRepeat: {
+			const int32 child = current.children[0];
+			const int32 min = current.min;
+			const int32 max = current.max;
+			const bool greedy = current.greedy;
+
+			for (int32 i = 0; i < min && fStatus == B_OK; i++)
+				_Emit(child);
+
+			if (max < 0) {
+				int32 loop = fProgram.size();
+				fProgram.push_back({kOpSplit, 0, 0});
+				_Emit(child);
+				fProgram.push_back({kOpJump, loop, 0});
+				int32 body = loop + 1;
+				int32 out = fProgram.size();
+				fProgram[loop].x = greedy ? body : out;
+				fProgram[loop].y = greedy ? out : body;
+				break;
+			}
+
+			std::vector<int32> splits;
+			for (int32 i = min; i < max && fStatus == B_OK; i++) {
+				splits.push_back(fProgram.size());
+				fProgram.push_back({kOpSplit, 0, 0});
+				_Emit(child);
+			}
+			int32 out = fProgram.size();
+			for (int32 split : splits) {
+				int32 body = split + 1;
+				fProgram[split].x = greedy ? body : out;
+				fProgram[split].y = greedy ? out : body;
+			}
+			break;
+		}
+	}
+}
+
+/*
+ * Longest run of bytes every match must contain, split at anything that
+ * may match more than one string
+ */
+void
+TextRegex::_Literals(int32 index, std::string& run, std::string& best) const
+{
+	const node& current = fNodes[index];
+
+	switch (current.type) {
+		case kNodeByte:
+			run += fMatchCase ? (char)current.value : (char)fold(current.value);
+			if (run.size() > best.size())
+				best = run;
+			break;
+		case kNodeEmpty:
+		case kNodeAssert:
+			break;
+		case kNodeGroup:
+			_Literals(current.children[0], run, best);
+			break;
+		case kNodeConcat:
+			for (int32 child : current.children)
+				_Literals(child, run, best);
+			break;
+		case kNodeRepeat:
+			run.clear();
+			if (current.min > 0) {
+				std::string inner;
+				_Literals(current.children[0], inner, best);
+			}
+			break;
+		default:
+			run.clear();
+			break;
+	}
+}
+
+/*
+ * Bytes a match can start with. Assertions are taken as passing, so the
+ * set may be larger than needed, never smaller.
+ */
+void
+TextRegex::_FirstBytes()
+{
+	std::fill(fFirst, fFirst + 256, false);
+
+	std::vector<bool> visited(fProgram.size(), false);
+	std::vector<int32> pending(1, 0);
+
+	while (pending.empty() == false && fFirstAll == false) {
+		int32 pc = pending.back();
+		pending.pop_back();
+		if (visited[pc] == true)
+			continue;
+		visited[pc] = true;
+
+		const inst& op = fProgram[pc];
+		switch (op.op) {
+			case kOpByte:
+				for (int c = 0; c < 256; c++)
+					if ((fMatchCase ? c : fold(c)) == op.x)
+						fFirst[c] = true;
+				break;
+			case kOpClass:
+				for (int c = 0; c < 256; c++)
+					if (fClasses[op.x * 256 + c] == true)
+						fFirst[c] = true;
+				break;
+			case kOpAny:
+				for (int c = 0; c < 256; c++)
+					if (c != '\n' && c != '\r')
+						fFirst[c] = true;
+				break;
+			case kOpSplit:
+				pending.push_back(op.y);
+				pending.push_back(op.x);
+				break;
+			case kOpJump:
+				pending.push_back(op.x);
+				break;
+			case kOpSave:
+			case kOpAssert:
+				pending.push_back(pc + 1);
+				break;
+			case kOpMatch:
+				fFirstAll = true;
+				break;
+		}
+	}
+}
+
+bool
+TextRegex::_Search(vm_state& state, const char* text, size_t length,
+	size_t start, size_t before, match& result) const
+{
+	if (fStatus != B_OK || start > length || start >= before)
+		return false;
+
+	if (fLiteral != nullptr) {
+		ssize_t position = fLiteral->Find(text, length, start);
+		if (position < 0 || (size_t)position >= before)
+			return false;
+		result.start = position;
+		result.end = position + fLiteral->PatternLength();
+		result.groups.assign({(ssize_t)result.start, (ssize_t)result.end});
+		return true;
+	}
+
+	return _Run(state, text, length, start, before, result);
+}
+
+/*
+ * Pike VM: threads are kept in priority order and advance in lockstep,
+ * one per program counter at most, so a step costs at most the program
+ * size. A thread reaching Match drops all lower priority ones; the search
+ * goes on only while higher priority ones may give a longer (greedy) or
+ * earlier preferred match. Matches start before "before".
+ */
+bool
+TextRegex::_Run(vm_state& state, const char* text, size_t length, size_t start,
+	size_t before, match& result) const
+{
+	const size_t size = fProgram.size();
+	const int32 slots = (fGroups + 1) * 2;
+
+	if (state.marks.size() != size || state.counter > UINT32_MAX - 4) {
+		state.marks.assign(size, 0);
+		state.counter = 0;
+		for (int i = 0; i < 2; i++) {
+			state.threads[i].reserve(size);
+			state.groups[i].resize(size * slots);
+		}
+		state.seed.resize(slots);
+	}
+
+	int32 current = 0;
+	state.threads[current].clear();
+	state.generation[current] = ++state.counter;
+
+	const uint8* bytes = reinterpret_cast<const uint8*>(text);
+	bool matched = false;
+	size_t position = start;
+
+	while (true) {
+		if (matched == false && position < before) {
+			// Nothing running: skip to a possible first byte, marks of
+			// a previous position do not hold here
+			if (state.threads[current].empty() == true) {
+				state.generation[current] = ++state.counter;
+				while (fFirstAll == false && position < length
+					&& fFirst[bytes[position]] == false)
+					position++;
+				if ((fFirstAll == false && position >= length)
+					|| position >= before)
+					break;
+			}
+			std::fill(state.seed.begin(), state.seed.end(), -1);
+			_AddThread(state, current, 0, position, text, length,
+				state.seed.data());
+		}
+
+		if (state.threads[current].empty() == true) {
+			// Seed failed an assertion, try the next position
+			if (matched == true || position >= length || position >= before)
+				break;
+			position++;
+			continue;
+		}
+
+		const int32 next = 1 - current;
+		state.threads[next].clear();
+		state.generation[next] = ++state.counter;
+
+		const int32 c = position < length ? bytes[position] : -1;
+
+		for (size_t i = 0; i < state.threads[current].size(); i++) {
+			const int32 pc = state.threads[current][i];
+			const inst& op = fProgram[pc];
+			ssize_t* groups = state.groups[current].data() + i * slots;
+
+			bool step = false;
+			switch (op.op) {
+				case kOpByte:
+					step = c >= 0 && (fMatchCase ? c : fold(c)) == op.x;
+					break;
+				case kOpClass:
+					step = c >= 0 && fClasses[op.x * 256 + c] != 0;
+					break;
+				case kOpAny:
+					step = c >= 0 && c != '\n' && c != '\r';
+					break;
+				case kOpMatch:
+					result.start = groups[0];
+					result.end = groups[1];
+					result.groups.assign(groups, groups + slots);
+					matched = true;
+					break;
+			}
+
+			if (op.op == kOpMatch)
+				break;
+			if (step == true)
+				_AddThread(state, next, pc + 1, position + 1, text, length, groups);
+		}
+
+		current = next;
+		if (position >= length)
+			break;
+		position++;
+	}
+
+	return matched;
+}
+
+/*
+ * Follows jumps, splits, saves and assertions from pc and queues the
+ * byte consuming instructions reached, in priority order. Iterative: the
+ * program may be large and workers have small stacks.
+ */
+void
+TextRegex::_AddThread(vm_state& state, int32 list, int32 pc, size_t position,
+	const char* text, size_t length, ssize_t* groups) const
+{
+	const uint32 generation = state.generation[list];
+	const int32 slots = (fGroups + 1) * 2;
+
+	state.stack.clear();
+	state.stack.push_back({pc, -1, 0});
+
+	while (state.stack.empty() == false) {
+		vm_state::entry entry = state.stack.back();
+		state.stack.pop_back();
+
+		if (entry.slot >= 0) {
+			groups[entry.slot] = entry.value;
+			continue;
+		}
+
+		pc = entry.pc;
+		while (true) {
+			if (state.marks[pc] == generation)
+				break;
+			state.marks[pc] = generation;
+
+			const inst& op = fProgram[pc];
+			if (op.op == kOpJump) {
+				pc = op.x;
+				continue;
+			}
+			if (op.op == kOpSplit) {
+				state.stack.push_back({op.y, -1, 0});
+				pc = op.x;
+				continue;
+			}
+			if (op.op == kOpSave) {
+				if (op.x < slots) {
+					state.stack.push_back({0, op.x, groups[op.x]});
+					groups[op.x] = position;
+				}
+				pc++;
+				continue;
+			}
+			if (op.op == kOpAssert) {
+				if (_Assert(op.x, text, length, position) == false)
+					break;
+				pc++;
+				continue;
+			}
+
+			size_t index = state.threads[list].size();
+			state.threads[list].push_back(pc);
+			std::copy(groups, groups + slots,
+				state.groups[list].data() + index * slots);
+			break;
+		}
+	}
+}
+
+bool
+TextRegex::_Assert(int32 assertion, const char* text, size_t length,
+	size_t position) const
+{
+	const uint8* bytes = reinterpret_cast<const uint8*>(text);
+	const bool before = position > 0 && is_word_char(bytes[position - 1]);
+	const bool after = position < length && is_word_char(bytes[position]);
+
+	switch (assertion) {
+		case kAssertLineStart:
+			// After \n, or a \r not followed by \n (CR only files)
+			return position == 0 || bytes[position - 1] == '\n'
+				|| (bytes[position - 1] == '\r'
+					&& (position == length || bytes[position] != '\n'));
+		case kAssertLineEnd:
+			return position == length || bytes[position] == '\n'
+				|| bytes[position] == '\r';
+		case kAssertWordBoundary:
+			return before != after;
+		case kAssertNotWordBoundary:
+			return before == after;
+		case kAssertWordStart:
+			return before == false && after == true;
+		case kAssertWordEnd:
+			return before == true && after == false;
+		case kAssertNotInWord:
+			return before == false || after == false;
+	}
+
+	return false;
+}
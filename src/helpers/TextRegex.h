@@ -0,0 +1,140 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_REGEX_H
+#define TEXT_REGEX_H
+
+#include <String.h>
+#include <SupportDefs.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TextSearch.h"
+
+// Compiled programs above this size are refused (i.e. huge {n,m})
+constexpr auto kTextRegexMaxProgramSize = 32768;
+// Compiled patterns kept by Compile()
+constexpr auto kTextRegexCacheSize = 16;
+
+/*
+ * Regular expression search over a plain buffer, compiled to a small
+ * program and run by a Pike VM: all alternatives advance together one
+ * byte at a time, so time is linear in text length whatever the pattern,
+ * there is no backtracking.
+ *
+ * Syntax: literals, '.', [...] classes (ranges, negation, \d \w \s),
+ * \d \D \w \W \s \S \t \n \r \xHH, ^ $ (line), \b \B \< \> (word),
+ * (...) groups, (?:...), '|', * + ? {n} {n,} {n,m} and their lazy '?'
+ * forms. Leftmost first semantics, as Perl. '.' does not match line ends.
+ * Case folding is ASCII only, whole word as TextSearch.
+ *
+ * Patterns that turn out to be plain literals are run by TextSearch.
+ * Search() is const and may be called by several threads at once.
+ */
+class TextRegex {
+public:
+	struct match {
+		size_t				start;
+		size_t				end;
+		// Start and end of each group, \0 included, -1 if not taking part
+		std::vector<ssize_t>	groups;
+	};
+
+								TextRegex(const char* pattern, size_t length,
+									bool matchCase, bool wholeWord);
+
+	static	std::shared_ptr<const TextRegex>	Compile(const BString& pattern,
+									bool matchCase, bool wholeWord);
+
+			status_t			InitCheck() const { return fStatus; }
+			const BString&		ErrorString() const { return fError; }
+
+			bool				Search(const char* text, size_t length,
+									size_t start, match& result,
+									size_t before = SIZE_MAX) const;
+			bool				SearchBackward(const char* text, size_t length,
+									size_t position, match& result) const;
+			bool				MatchAt(const char* text, size_t length,
+									size_t position, match& result) const;
+			size_t				FindAll(const char* text, size_t length,
+									std::vector<match>& matches) const;
+
+			void				Expand(const char* replacement, size_t length,
+									const char* text, const match& found,
+									std::string& expanded) const;
+
+			// Every match contains this (folded if not matchCase)
+			const std::string&	RequiredLiteral() const { return fRequired; }
+			int32				CountGroups() const { return fGroups; }
+			bool				IsLiteral() const { return fLiteral != nullptr; }
+
+private:
+	struct inst {
+		int32					op;
+		int32					x;
+		int32					y;
+	};
+	struct node {
+		int32					type;
+		// Byte, class index, assertion or group (-1 not capturing)
+		int32					value;
+		int32					min;
+		// -1 unbounded
+		int32					max;
+		bool					greedy;
+		std::vector<int32>		children;
+	};
+	struct vm_state;
+
+			int32				_ParseAlternation(int32 depth);
+			int32				_ParseConcatenation(int32 depth);
+			int32				_ParseRepeat(int32 depth);
+			int32				_ParseAtom(int32 depth);
+			bool				_ParseClass(std::vector<bool>& set);
+			bool				_ParseEscape(uint8& c, int32& klass,
+									int32& assertion, bool inClass);
+			int32				_NewNode(int32 type);
+			int32				_NewClass(const std::vector<bool>& set);
+			bool				_SetError(const char* error);
+
+			void				_Emit(int32 node);
+			void				_Literals(int32 node, std::string& run,
+									std::string& best) const;
+			void				_FirstBytes();
+
+			bool				_Search(vm_state& state, const char* text,
+									size_t length, size_t start, size_t before,
+									match& result) const;
+			bool				_Run(vm_state& state, const char* text,
+									size_t length, size_t start, size_t before,
+									match& result) const;
+			void				_AddThread(vm_state& state, int32 list,
+									int32 pc, size_t position, const char* text,
+									size_t length, ssize_t* groups) const;
+			bool				_Assert(int32 assertion, const char* text,
+									size_t length, size_t position) const;
+
+			std::string			fPattern;
+			size_t				fParse;
+			bool				fMatchCase;
+			bool				fWholeWord;
+			status_t			fStatus;
+			BString				fError;
+			int32				fGroups;
+
+			std::vector<node>	fNodes;
+			std::vector<inst>	fProgram;
+			// 256 entries per class
+			std::vector<uint8>	fClasses;
+			bool				fFirst[256];
+			bool				fFirstAll;
+
+			std::string			fRequired;
+			std::unique_ptr<TextSearch>	fLiteral;
+};
+
+#endif // TEXT_REGEX_H
@@ -0,0 +1,281 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextScanner.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+TextScanner::TextScanner()
+{
+	Reset();
+}
+
+void
+TextScanner::Reset()
+{
+	fPosition = 0;
+	fLineStart = 0;
+	fCRPosition = -1;
+	fCRPending = false;
+
+	fLFCount = 0;
+	fCRLFCount = 0;
+	fCRCount = 0;
+	fNulCount = 0;
+	fLongestLine = 0;
+
+	fBOMLength = 0;
+	fBOMEncoding = ENCODING_ASCII;
+
+	fHighBytes = false;
+	fUTF8Valid = true;
+	fUTF8Needed = 0;
+	fUTF8Lower = 0x80;
+	fUTF8Upper = 0xBF;
+}
+
+/*
+ * Chunks may be of any size and split anywhere, state is carried over.
+ * With SSE2 16 bytes blocks are classified at once and only line endings,
+ * NULs and non ASCII blocks get further work.
+ */
+void
+TextScanner::Scan(const char* data, size_t length)
+{
+	const uint8* bytes = reinterpret_cast<const uint8*>(data);
+	size_t offset = 0;
+
+	if (fPosition == 0 && length > 0)
+		_CheckBOM(bytes, length);
+
+#if defined(__SSE2__)
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; offset + 16 <= length; offset += 16) {
+		__m128i block = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(bytes + offset));
+
+		uint32 eolMask = _mm_movemask_epi8(_mm_or_si128(
+			_mm_cmpeq_epi8(block, lf), _mm_cmpeq_epi8(block, cr)));
+		uint32 nulMask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero));
+		uint32 highMask = _mm_movemask_epi8(block);
+
+		if (highMask != 0 || fUTF8Needed > 0) {
+			if (highMask != 0)
+				fHighBytes = true;
+			_ValidateUTF8(bytes + offset, 16);
+		}
+
+		if (nulMask != 0)
+			fNulCount += __builtin_popcount(nulMask);
+
+		off_t base = fPosition + offset;
+		while (eolMask != 0) {
+			int bit = __builtin_ctz(eolMask);
+			_EndOfLine(bytes[offset + bit], base + bit);
+			eolMask &= eolMask - 1;
+		}
+	}
+#endif
+
+	if (offset < length) {
+		fPosition += offset;
+		_ScanScalar(bytes + offset, length - offset);
+		fPosition += length - offset;
+	} else
+		fPosition += length;
+}
+
+/*
+ * Resolve pending states at end of data
+ */
+void
+TextScanner::Finish()
+{
+	if (fCRPending == true) {
+		fCRCount++;
+		fCRPending = false;
+	}
+
+	// Truncated multibyte sequence
+	if (fUTF8Needed > 0)
+		fUTF8Valid = false;
+
+	if (fPosition - fLineStart > fLongestLine)
+		fLongestLine = fPosition - fLineStart;
+}
+
+bool
+TextScanner::IsBinary() const
+{
+	// UTF-16 text is full of NULs
+	if (fBOMEncoding == ENCODING_UTF16_LE || fBOMEncoding == ENCODING_UTF16_BE)
+		return false;
+
+	return fNulCount > 0;
+}
+
+bool
+TextScanner::IsMixedEndOfLine() const
+{
+	return (fLFCount > 0) + (fCRLFCount > 0) + (fCRCount > 0) > 1;
+}
+
+TextScanner::eol_mode
+TextScanner::EndOfLine() const
+{
+	if (fLFCount == 0 && fCRLFCount == 0 && fCRCount == 0)
+		return EOL_NONE;
+
+	if (fCRLFCount > fLFCount && fCRLFCount >= fCRCount)
+		return EOL_CRLF;
+	if (fCRCount > fLFCount && fCRCount > fCRLFCount)
+		return EOL_CR;
+
+	return EOL_LF;
+}
+
+TextScanner::encoding
+TextScanner::Encoding() const
+{
+	if (fBOMEncoding == ENCODING_UTF16_LE || fBOMEncoding == ENCODING_UTF16_BE)
+		return fBOMEncoding;
+
+	if (fUTF8Valid == false)
+		return ENCODING_LATIN1;
+
+	if (fHighBytes == true || fBOMEncoding == ENCODING_UTF8)
+		return ENCODING_UTF8;
+
+	return ENCODING_ASCII;
+}
+
+const char*
+TextScanner::EncodingString() const
+{
+	switch (Encoding()) {
+		case ENCODING_ASCII:
+			return "ASCII";
+		case ENCODING_UTF8:
+			return "UTF-8";
+		case ENCODING_UTF16_LE:
+			return "UTF-16LE";
+		case ENCODING_UTF16_BE:
+			return "UTF-16BE";
+		case ENCODING_LATIN1:
+			return "ISO-8859-1";
+	}
+
+	return "";
+}
+
+void
+TextScanner::_CheckBOM(const uint8* data, size_t length)
+{
+	if (length >= 3 && data[0] == 0xEF && data[1] == 0xBB && data[2] == 0xBF) {
+		fBOMLength = 3;
+		fBOMEncoding = ENCODING_UTF8;
+	} else if (length >= 2 && data[0] == 0xFF && data[1] == 0xFE) {
+		fBOMLength = 2;
+		fBOMEncoding = ENCODING_UTF16_LE;
+	} else if (length >= 2 && data[0] == 0xFE && data[1] == 0xFF) {
+		fBOMLength = 2;
+		fBOMEncoding = ENCODING_UTF16_BE;
+	}
+}
+
+/*
+ * A CR is classified when the next line ending or the end of data is met
+ */
+void
+TextScanner::_EndOfLine(uint8 character, off_t position)
+{
+	if (character == '\n') {
+		if (fCRPending == true && fCRPosition == position - 1)
+			fCRLFCount++;
+		else {
+			if (fCRPending == true)
+				fCRCount++;
+			fLFCount++;
+		}
+		fCRPending = false;
+	} else {
+		if (fCRPending == true)
+			fCRCount++;
+		fCRPending = true;
+		fCRPosition = position;
+	}
+
+	if (position - fLineStart > fLongestLine)
+		fLongestLine = position - fLineStart;
+	fLineStart = position + 1;
+}
+
+void
+TextScanner::_ScanScalar(const uint8* data, size_t length)
+{
+	bool high = false;
+
+	for (size_t i = 0; i < length; i++) {
+		uint8 c = data[i];
+		if (c == '\n' || c == '\r')
+			_EndOfLine(c, fPosition + i);
+		else if (c == 0)
+			fNulCount++;
+		else if (c & 0x80)
+			high = true;
+	}
+
+	if (high == true)
+		fHighBytes = true;
+	if (high == true || fUTF8Needed > 0)
+		_ValidateUTF8(data, length);
+}
+
+/*
+ * RFC 3629 validation: rejects overlongs, surrogates and code points
+ * above U+10FFFF. Gives up at the first error.
+ */
+void
+TextScanner::_ValidateUTF8(const uint8* data, size_t length)
+{
+	for (size_t i = 0; i < length && fUTF8Valid == true; i++) {
+		uint8 c = data[i];
+
+		if (fUTF8Needed > 0) {
+			if (c < fUTF8Lower || c > fUTF8Upper) {
+				fUTF8Valid = false;
+				break;
+			}
+			fUTF8Needed--;
+			fUTF8Lower = 0x80;
+			fUTF8Upper = 0xBF;
+			continue;
+		}
+
+		if (c < 0x80)
+			continue;
+		else if (c >= 0xC2 && c <= 0xDF)
+			fUTF8Needed = 1;
+		else if (c >= 0xE0 && c <= 0xEF) {
+			fUTF8Needed = 2;
+			if (c == 0xE0)
+				fUTF8Lower = 0xA0;
+			else if (c == 0xED)
+				fUTF8Upper = 0x9F;
+		} else if (c >= 0xF0 && c <= 0xF4) {
+			fUTF8Needed = 3;
+			if (c == 0xF0)
+				fUTF8Lower = 0x90;
+			else if (c == 0xF4)
+				fUTF8Upper = 0x8F;
+		} else
+			fUTF8Valid = false;
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_SCANNER_H
+#define TEXT_SCANNER_H
+
+#include <SupportDefs.h>
+
+/*
+ * One pass text sniffer, fed chunk by chunk while a file is loaded.
+ * Counts line endings, validates UTF-8, detects byte order marks,
+ * NUL bytes and the longest line. Uses SSE2 where available.
+ */
+class TextScanner {
+public:
+	enum encoding {
+		ENCODING_ASCII = 0,
+		ENCODING_UTF8,
+		ENCODING_UTF16_LE,
+		ENCODING_UTF16_BE,
+		ENCODING_LATIN1
+	};
+
+	enum eol_mode {
+		EOL_NONE = 0,
+		EOL_LF,
+		EOL_CRLF,
+		EOL_CR
+	};
+
+							TextScanner();
+
+			void			Reset();
+			void			Scan(const char* data, size_t length);
+			void			Finish();
+
+			int64			LFCount() const { return fLFCount; }
+			int64			CRLFCount() const { return fCRLFCount; }
+			int64			CRCount() const { return fCRCount; }
+			int64			NulCount() const { return fNulCount; }
+			int64			LongestLine() const { return fLongestLine; }
+			off_t			Size() const { return fPosition; }
+
+			bool			HasBOM() const { return fBOMLength > 0; }
+			bool			IsBinary() const;
+			bool			IsMixedEndOfLine() const;
+			eol_mode		EndOfLine() const;
+			encoding		Encoding() const;
+			const char*		EncodingString() const;
+
+private:
+			void			_CheckBOM(const uint8* data, size_t length);
+			void			_EndOfLine(uint8 character, off_t position);
+			void			_ScanScalar(const uint8* data, size_t length);
+			void			_ValidateUTF8(const uint8* data, size_t length);
+
+			off_t			fPosition;
+			off_t			fLineStart;
+			off_t			fCRPosition;
+			bool			fCRPending;
+
+			int64			fLFCount;
+			int64			fCRLFCount;
+			int64			fCRCount;
+			int64			fNulCount;
+			int64			fLongestLine;
+
+			int32			fBOMLength;
+			encoding		fBOMEncoding;
+
+			// UTF-8 validation state carried between chunks
+			bool			fHighBytes;
+			bool			fUTF8Valid;
+			int32			fUTF8Needed;
+			uint8			fUTF8Lower;
+			uint8			fUTF8Upper;
+};
+
+#endif // TEXT_SCANNER_H
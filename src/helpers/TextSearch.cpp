@@ -0,0 +1,184 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TextSearch.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline bool
+is_word_char(uint8 c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+		|| (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+TextSearch::TextSearch(const char* pattern, size_t length,
+	bool matchCase, bool wholeWord)
+	:
+	fPattern(pattern, length)
+	, fMatchCase(matchCase)
+	, fWholeWord(wholeWord)
+{
+	for (int c = 0; c < 256; c++) {
+		fFold[c] = c;
+		if (matchCase == false && c >= 'A' && c <= 'Z')
+			fFold[c] = c - 'A' + 'a';
+	}
+
+	for (size_t i = 0; i < fPattern.size(); i++)
+		fPattern[i] = fFold[(uint8)fPattern[i]];
+
+	// Bad character shifts, on folded bytes
+	const size_t m = fPattern.size();
+	for (int c = 0; c < 256; c++)
+		fShift[c] = m;
+	for (size_t i = 0; i + 1 < m; i++)
+		fShift[(uint8)fPattern[i]] = m - 1 - i;
+}
+
+/*
+ * Returns the first match at or after start, -1 if none
+ */
+ssize_t
+TextSearch::Find(const char* text, size_t length, size_t start) const
+{
+	const size_t m = fPattern.size();
+
+	if (m == 0 || length < m)
+		return -1;
+
+	const uint8* bytes = reinterpret_cast<const uint8*>(text);
+	const uint8 last = fPattern[m - 1];
+
+	// Single byte, case sensitive: memchr is hard to beat
+	if (m == 1 && fMatchCase == true) {
+		while (start < length) {
+			const void* found = memchr(text + start, last, length - start);
+			if (found == nullptr)
+				return -1;
+			size_t position = static_cast<const char*>(found) - text;
+			if (fWholeWord == false || _IsWholeWord(text, length, position))
+				return position;
+			start = position + 1;
+		}
+		return -1;
+	}
+
+	size_t position = start;
+
+#if defined(__SSE2__)
+	// Filter 16 candidates at once on first and last pattern byte
+	// (both cases when folding), then verify
+	const uint8 first = fPattern[0];
+	const __m128i first1 = _mm_set1_epi8(first);
+	const __m128i first2 = _mm_set1_epi8(_Other(first));
+	const __m128i last1 = _mm_set1_epi8(last);
+	const __m128i last2 = _mm_set1_epi8(_Other(last));
+
+	for (; position + m - 1 + 16 <= length; position += 16) {
+		__m128i blockFirst = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(bytes + position));
+		__m128i blockLast = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(bytes + position + m - 1));
+
+		uint32 mask = _mm_movemask_epi8(_mm_and_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(blockFirst, first1),
+				_mm_cmpeq_epi8(blockFirst, first2)),
+			_mm_or_si128(_mm_cmpeq_epi8(blockLast, last1),
+				_mm_cmpeq_epi8(blockLast, last2))));
+
+		while (mask != 0) {
+			size_t candidate = position + __builtin_ctz(mask);
+			if (_Matches(text, candidate) && (fWholeWord == false
+					|| _IsWholeWord(text, length, candidate)))
+				return candidate;
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	while (position + m <= length) {
+		uint8 c = fFold[bytes[position + m - 1]];
+		if (c == last && _Matches(text, position)
+			&& (fWholeWord == false || _IsWholeWord(text, length, position)))
+			return position;
+		position += fShift[c];
+	}
+
+	return -1;
+}
+
+/*
+ * Non overlapping matches in one pass, returns their count
+ */
+size_t
+TextSearch::FindAll(const char* text, size_t length,
+	std::vector<size_t>& positions) const
+{
+	size_t count = 0;
+	size_t start = 0;
+	ssize_t position;
+
+	if (fPattern.empty())
+		return 0;
+
+	while ((position = Find(text, length, start)) >= 0) {
+		positions.push_back(position);
+		count++;
+		start = position + fPattern.size();
+	}
+
+	return count;
+}
+
+/*
+ * The other case of a folded byte, or the byte itself
+ */
+uint8
+TextSearch::_Other(uint8 c) const
+{
+	if (fMatchCase == false && c >= 'a' && c <= 'z')
+		return c - 'a' + 'A';
+
+	return c;
+}
+
+bool
+TextSearch::_Matches(const char* text, size_t position) const
+{
+	const uint8* bytes = reinterpret_cast<const uint8*>(text + position);
+
+	if (fMatchCase == true)
+		return memcmp(bytes, fPattern.data(), fPattern.size()) == 0;
+
+	for (size_t i = 0; i < fPattern.size(); i++) {
+		if (fFold[bytes[i]] != (uint8)fPattern[i])
+			return false;
+	}
+	return true;
+}
+
+/*
+ * Both match ends must sit on a word boundary, as scintilla does
+ */
+bool
+TextSearch::_IsWholeWord(const char* text, size_t length, size_t position) const
+{
+	const uint8* bytes = reinterpret_cast<const uint8*>(text);
+	const size_t end = position + fPattern.size();
+
+	if (position > 0 && is_word_char(bytes[position - 1])
+		&& is_word_char(bytes[position]))
+		return false;
+	if (end < length && is_word_char(bytes[end])
+		&& is_word_char(bytes[end - 1]))
+		return false;
+
+	return true;
+}
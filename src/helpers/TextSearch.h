@@ -0,0 +1,44 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TEXT_SEARCH_H
+#define TEXT_SEARCH_H
+
+#include <SupportDefs.h>
+
+#include <string>
+#include <vector>
+
+/*
+ * Literal substring search over a plain buffer: SSE2 first/last byte
+ * filtering when available, Boyer-Moore-Horspool otherwise.
+ * Case folding is ASCII only, whole word follows scintilla default
+ * word characters (alphanumerics, '_' and non ASCII bytes).
+ */
+class TextSearch {
+public:
+								TextSearch(const char* pattern, size_t length,
+									bool matchCase, bool wholeWord);
+
+			ssize_t				Find(const char* text, size_t length,
+									size_t start = 0) const;
+			size_t				FindAll(const char* text, size_t length,
+									std::vector<size_t>& positions) const;
+
+			size_t				PatternLength() const { return fPattern.size(); }
+
+private:
+			bool				_Matches(const char* text, size_t position) const;
+			uint8				_Other(uint8 c) const;
+			bool				_IsWholeWord(const char* text, size_t length,
+									size_t position) const;
+
+			std::string			fPattern;
+			size_t				fShift[256];
+			uint8				fFold[256];
+			bool				fMatchCase;
+			bool				fWholeWord;
+};
+
+#endif // TEXT_SEARCH_H
@@ -0,0 +1,166 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "XXHash.h"
+
+#include <ByteOrder.h>
+
+#include <cstring>
+
+static const uint64 kPrime1 = 11400714785074694791ULL;
+static const uint64 kPrime2 = 14029467366897019727ULL;
+static const uint64 kPrime3 = 1609587929392839161ULL;
+static const uint64 kPrime4 = 9650029242287828579ULL;
+static const uint64 kPrime5 = 2870177450012600261ULL;
+
+static inline uint64
+rotl(uint64 value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+// Little endian reads, unaligned safe
+static inline uint64
+read64(const uint8* p)
+{
+	uint64 value;
+	memcpy(&value, p, sizeof(value));
+	return B_LENDIAN_TO_HOST_INT64(value);
+}
+
+static inline uint32
+read32(const uint8* p)
+{
+	uint32 value;
+	memcpy(&value, p, sizeof(value));
+	return B_LENDIAN_TO_HOST_INT32(value);
+}
+
+static inline uint64
+xxh_round(uint64 accumulator, uint64 input)
+{
+	accumulator += input * kPrime2;
+	accumulator = rotl(accumulator, 31);
+	return accumulator * kPrime1;
+}
+
+static inline uint64
+merge_round(uint64 accumulator, uint64 value)
+{
+	accumulator ^= xxh_round(0, value);
+	return accumulator * kPrime1 + kPrime4;
+}
+
+XXHash64::XXHash64(uint64 seed)
+{
+	Reset(seed);
+}
+
+void
+XXHash64::Reset(uint64 seed)
+{
+	fSeed = seed;
+	fTotalLength = 0;
+	fV1 = seed + kPrime1 + kPrime2;
+	fV2 = seed + kPrime2;
+	fV3 = seed;
+	fV4 = seed - kPrime1;
+	fBufferSize = 0;
+}
+
+void
+XXHash64::Update(const void* data, size_t length)
+{
+	const uint8* p = static_cast<const uint8*>(data);
+	const uint8* end = p + length;
+
+	fTotalLength += length;
+
+	// Not enough for a stripe yet
+	if (fBufferSize + length < 32) {
+		memcpy(fBuffer + fBufferSize, p, length);
+		fBufferSize += length;
+		return;
+	}
+
+	if (fBufferSize > 0) {
+		size_t fill = 32 - fBufferSize;
+		memcpy(fBuffer + fBufferSize, p, fill);
+		fV1 = xxh_round(fV1, read64(fBuffer));
+		fV2 = xxh_round(fV2, read64(fBuffer + 8));
+		fV3 = xxh_round(fV3, read64(fBuffer + 16));
+		fV4 = xxh_round(fV4, read64(fBuffer + 24));
+		p += fill;
+		fBufferSize = 0;
+	}
+
+	while (p + 32 <= end) {
+		fV1 = xxh_round(fV1, read64(p));
+		fV2 = xxh_round(fV2, read64(p + 8));
+		fV3 = xxh_round(fV3, read64(p + 16));
+		fV4 = xxh_round(fV4, read64(p + 24));
+		p += 32;
+	}
+
+	if (p < end) {
+		memcpy(fBuffer, p, end - p);
+		fBufferSize = end - p;
+	}
+}
+
+uint64
+XXHash64::Digest() const
+{
+	uint64 hash;
+
+	if (fTotalLength >= 32) {
+		hash = rotl(fV1, 1) + rotl(fV2, 7) + rotl(fV3, 12) + rotl(fV4, 18);
+		hash = merge_round(hash, fV1);
+		hash = merge_round(hash, fV2);
+		hash = merge_round(hash, fV3);
+		hash = merge_round(hash, fV4);
+	} else
+		hash = fSeed + kPrime5;
+
+	hash += fTotalLength;
+
+	const uint8* p = fBuffer;
+	const uint8* end = fBuffer + fBufferSize;
+
+	while (p + 8 <= end) {
+		hash ^= xxh_round(0, read64(p));
+		hash = rotl(hash, 27) * kPrime1 + kPrime4;
+		p += 8;
+	}
+
+	if (p + 4 <= end) {
+		hash ^= (uint64)read32(p) * kPrime1;
+		hash = rotl(hash, 23) * kPrime2 + kPrime3;
+		p += 4;
+	}
+
+	while (p < end) {
+		hash ^= (*p) * kPrime5;
+		hash = rotl(hash, 11) * kPrime1;
+		p++;
+	}
+
+	hash ^= hash >> 33;
+	hash *= kPrime2;
+	hash ^= hash >> 29;
+	hash *= kPrime3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+/* static */
+uint64
+XXHash64::Hash(const void* data, size_t length, uint64 seed)
+{
+	XXHash64 hasher(seed);
+	hasher.Update(data, length);
+	return hasher.Digest();
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef XX_HASH_H
+#define XX_HASH_H
+
+#include <SupportDefs.h>
+
+/*
+ * Streaming XXH64 (xxHash by Yann Collet, BSD 2-clause algorithm),
+ * used to tell whether file contents really changed.
+ */
+class XXHash64 {
+public:
+							XXHash64(uint64 seed = 0);
+
+			void			Reset(uint64 seed = 0);
+			void			Update(const void* data, size_t length);
+			uint64			Digest() const;
+
+	static	uint64			Hash(const void* data, size_t length,
+								uint64 seed = 0);
+
+private:
+			uint64			fTotalLength;
+			uint64			fSeed;
+			uint64			fV1;
+			uint64			fV2;
+			uint64			fV3;
+			uint64			fV4;
+			uint8			fBuffer[32];
+			uint32			fBufferSize;
+};
+
+#endif // XX_HASH_H
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ConsoleIORing.h"
+
+#include <OS.h>
+
+#include <algorithm>
+#include <cstring>
+
+static constexpr auto kConsoleRingHeaderSize = sizeof(uint32);
+// Ring full: the consumer drains every frame
+static constexpr auto kConsoleRingWait = 2000;
+
+ConsoleIORing::ConsoleIORing(size_t capacity)
+	:
+	fBuffer(nullptr)
+	, fCapacity(64)
+	, fHead(0)
+	, fTail(0)
+	, fClosed(false)
+	, fAbandoned(false)
+	, fStalls(0)
+{
+	while (fCapacity < capacity)
+		fCapacity <<= 1;
+	fMask = fCapacity - 1;
+	fBuffer = new char[fCapacity];
+}
+
+ConsoleIORing::~ConsoleIORing()
+{
+	delete[] fBuffer;
+}
+
+/*
+ * Text longer than half the ring goes in more records
+ */
+bool
+ConsoleIORing::Write(int32 fd, const char* text, size_t length)
+{
+	const size_t most = fCapacity / 2 - kConsoleRingHeaderSize;
+
+	while (length > 0) {
+		const size_t part = std::min(length, most);
+		const size_t size = kConsoleRingHeaderSize + part;
+		const size_t head = fHead.load(std::memory_order_relaxed);
+
+		bool stalled = false;
+		while (fCapacity - (head - fTail.load(std::memory_order_acquire)) < size) {
+			if (fAbandoned.load(std::memory_order_relaxed) == true)
+				return false;
+			if (stalled == false) {
+				fStalls++;
+				stalled = true;
+			}
+			snooze(kConsoleRingWait);
+		}
+
+		const uint32 header = (uint32)(part << 1) | (fd == 2 ? 1 : 0);
+		_CopyIn(head, &header, kConsoleRingHeaderSize);
+		_CopyIn(head + kConsoleRingHeaderSize, text, part);
+		fHead.store(head + size, std::memory_order_release);
+
+		text += part;
+		length -= part;
+	}
+
+	return true;
+}
+
+void
+ConsoleIORing::Close()
+{
+	fClosed.store(true, std::memory_order_release);
+}
+
+size_t
+ConsoleIORing::Read(const consumer& reader)
+{
+	const size_t head = fHead.load(std::memory_order_acquire);
+	size_t tail = fTail.load(std::memory_order_relaxed);
+	size_t read = 0;
+
+	while (tail != head) {
+		uint32 header;
+		_CopyOut(tail, &header, kConsoleRingHeaderSize);
+
+		const int32 fd = (header & 1) != 0 ? 2 : 1;
+		const size_t length = header >> 1;
+		const size_t position = (tail + kConsoleRingHeaderSize) & fMask;
+		const size_t first = std::min(length, fCapacity - position);
+
+		reader(fd, fBuffer + position, first);
+		if (first < length)
+			reader(fd, fBuffer, length - first);
+
+		tail += kConsoleRingHeaderSize + length;
+		read += length;
+	}
+
+	fTail.store(tail, std::memory_order_release);
+
+	return read;
+}
+
+void
+ConsoleIORing::Abandon()
+{
+	fAbandoned.store(true, std::memory_order_relaxed);
+}
+
+bool
+ConsoleIORing::IsDone() const
+{
+	// Closed first: all written before is seen
+	return fClosed.load(std::memory_order_acquire) == true
+		&& fHead.load(std::memory_order_acquire)
+			== fTail.load(std::memory_order_relaxed);
+}
+
+void
+ConsoleIORing::_CopyIn(size_t position, const void* data, size_t length)
+{
+	position &= fMask;
+	const size_t first = std::min(length, fCapacity - position);
+
+	memcpy(fBuffer + position, data, first);
+	memcpy(fBuffer, static_cast<const char*>(data) + first, length - first);
+}
+
+void
+ConsoleIORing::_CopyOut(size_t position, void* data, size_t length) const
+{
+	position &= fMask;
+	const size_t first = std::min(length, fCapacity - position);
+
+	memcpy(data, fBuffer + position, first);
+	memcpy(static_cast<char*>(data) + first, fBuffer, length - first);
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef CONSOLE_IO_RING_H
+#define CONSOLE_IO_RING_H
+
+#include <SupportDefs.h>
+
+#include <atomic>
+#include <functional>
+
+/*
+ * Single producer, single consumer byte ring carrying console output from
+ * ConsoleIOThread to ConsoleIOView without messages or locks.
+ *
+ * Records are a 4 bytes header (length and stream) and the text. A full
+ * ring makes the producer wait, so the command is held back by its pipe
+ * rather than output being lost. The consumer drains it on its own pace.
+ */
+class ConsoleIORing {
+public:
+	typedef std::function<void(int32 fd, const char* text, size_t length)>
+		consumer;
+
+								// Capacity is rounded up to a power of two
+								ConsoleIORing(size_t capacity);
+								~ConsoleIORing();
+
+			// Producer side. False if the consumer is gone
+			bool				Write(int32 fd, const char* text, size_t length);
+			void				Close();
+
+			// Consumer side, a record may come in two parts where the
+			// ring wraps. Returns bytes of text read
+			size_t				Read(const consumer& reader);
+			void				Abandon();
+			// Closed and all read
+			bool				IsDone() const;
+
+			// Times the producer found the ring full
+			uint32				Stalls() const { return fStalls.load(); }
+
+private:
+			void				_CopyIn(size_t position, const void* data,
+									size_t length);
+			void				_CopyOut(size_t position, void* data,
+									size_t length) const;
+
+			char*				fBuffer;
+			size_t				fCapacity;
+			size_t				fMask;
+			// Monotonic positions, written by one side each
+			std::atomic<size_t>	fHead;
+			std::atomic<size_t>	fTail;
+			std::atomic<bool>	fClosed;
+			std::atomic<bool>	fAbandoned;
+			std::atomic<uint32>	fStalls;
+};
+
+#endif // CONSOLE_IO_RING_H
@@ -16,6 +16,7 @@
 #include <errno.h>
 #include <image.h>
 #include <iostream>
+#include <poll.h>
 #include <signal.h>
 #include <termios.h>
 #include <unistd.h>
@@ -25,6 +26,12 @@
 
 extern char **environ;
 
+// Lines not ended in this time go out as they are (prompts)
+static constexpr auto kConsolePartialLineTimeout = 50;
+// Longer lines are split
+static constexpr auto kConsoleMaxLineLength = 65536;
+static constexpr auto kConsoleRingSize = 1024 * 1024;
+
 ConsoleIOThread::ConsoleIOThread(BMessage* cmd_message,
 					const BMessenger& windowTarget, const BMessenger& consoleTarget)
 	:
@@ -35,14 +42,20 @@ ConsoleIOThread::ConsoleIOThread(BMessage* cmd_message,
 	, fStdIn(-1)
 	, fStdOut(-1)
 	, fStdErr(-1)
-	, fConsoleOutput(nullptr)
-	, fConsoleError(nullptr)
 {
 	SetDataStore(new BMessage(*cmd_message));
+
+	// Relative paths are from where the command runs
+	if (cmd_message->GetBool("diagnostics", false) == true)
+		fDiagnostics.reset(new DiagnosticsParser(fWindowTarget,
+			cmd_message->GetString("directory", "")));
 }
 
 ConsoleIOThread::~ConsoleIOThread()
 {
+	// Killed before shutdown
+	if (fRing != nullptr)
+		fRing->Close();
 }
 
 status_t
@@ -85,8 +98,17 @@ ConsoleIOThread::ThreadStartup()
 	flags |= O_NONBLOCK;
 	fcntl(fStdErr, F_SETFL, flags);
 
-	fConsoleOutput = fdopen(fStdOut, "r");
-	fConsoleError = fdopen(fStdErr, "r");
+	// Output goes through the ring from now on, the view owns a reference
+	fRing = std::make_shared<ConsoleIORing>(kConsoleRingSize);
+	auto reference = new std::shared_ptr<ConsoleIORing>(fRing);
+	BMessage ring_message(CONSOLEIOTHREAD_RING);
+	ring_message.AddPointer("ring", reference);
+	if (fConsoleTarget.SendMessage(&ring_message) != B_OK) {
+		// Nobody would drain it, output is only parsed then
+		delete reference;
+		fRing->Close();
+		fRing.reset();
+	}
 
 	// Enable Stop button in view
 	BMessage button_message(CONSOLEIOTHREAD_ENABLE_STOP_BUTTON);
@@ -102,40 +124,49 @@ ConsoleIOThread::ThreadStartup()
 	return B_OK;
 }
 
+/*
+ * Blocks until a stream has data or is closed, each read takes all there
+ * is and hands the lines ended to the ring as one record
+ */
 status_t
 ConsoleIOThread::ExecuteUnit(void)
 {
-	// read output and error from command
-	// send it to window
-	BMessage out_message(CONSOLEIOTHREAD_STDOUT);
-	BString output_string("");
-
-	output_string = fgets(fConsoleOutputBuffer , LINE_MAX,
-		fConsoleOutput);
-
-	if (output_string != "") {
-		out_message.AddString("stdout", output_string);
-		
-		fConsoleTarget.SendMessage(&out_message);
+	struct pollfd fds[2];
+	nfds_t count = 0;
+
+	for (int fd : { fStdOut, fStdErr }) {
+		if (fd < 0)
+			continue;
+		fds[count].fd = fd;
+		fds[count].events = POLLIN;
+		fds[count].revents = 0;
+		count++;
 	}
 
-	BMessage err_message(CONSOLEIOTHREAD_STDERR);
-	BString error_string("");
+	// Both closed, command is over
+	if (count == 0)
+		return EOF;
 
-	error_string = fgets(fConsoleOutputBuffer, LINE_MAX,
-		fConsoleError);
+	const bool partial = fOutputPending.IsEmpty() == false
+		|| fErrorPending.IsEmpty() == false;
+	const int ready = poll(fds, count, partial ? kConsolePartialLineTimeout : -1);
 
-	if (error_string != "") {
-		err_message.AddString("stderr", error_string);
-		fConsoleTarget.SendMessage(&err_message);
+	if (ready < 0)
+		return errno == EINTR ? B_OK : errno;
 
+	if (ready == 0) {
+		_FlushPartialLines();
+		return B_OK;
 	}
 
-	if (feof(fConsoleOutput) && feof(fConsoleError))
-		return EOF;
-
-	// streams are non blocking, sleep every 1ms
-	snooze(1000);
+	for (nfds_t index = 0; index < count; index++) {
+		if (fds[index].revents == 0)
+			continue;
+		if (fds[index].fd == fStdOut)
+			_ReadStream(fStdOut, fOutputPending, 1);
+		else
+			_ReadStream(fStdErr, fErrorPending, 2);
+	}
 
 	return B_OK;
 }
@@ -150,8 +181,10 @@ status_t
 ConsoleIOThread::ThreadShutdown(void)
 {
 	close(fStdIn);
-	close(fStdOut);
-	close(fStdErr);
+	if (fStdOut >= 0)
+		close(fStdOut);
+	if (fStdErr >= 0)
+		close(fStdErr);
 
 	// Disable Stop button in view
 	BMessage button_message(CONSOLEIOTHREAD_ENABLE_STOP_BUTTON);
@@ -161,6 +194,12 @@ ConsoleIOThread::ThreadShutdown(void)
 	if (IdeamNames::Settings.console_banner == true)
 		_BannerMessage("ended   --");
 
+	if (fRing != nullptr)
+		fRing->Close();
+
+	if (fDiagnostics != nullptr)
+		fDiagnostics->Finish();
+
 	return B_OK;
 }
 
@@ -315,8 +354,84 @@ ConsoleIOThread::_BannerMessage(BString status)
 			<< status
 			<< "--------------------------------\n";
 
+	// In order with the output
+	if (fRing != nullptr) {
+		_Output(1, banner.String(), banner.Length());
+		return;
+	}
+
 	BMessage banner_message(CONSOLEIOTHREAD_PRINT_BANNER);
 	banner_message.AddString("banner", banner);
 	fConsoleTarget.SendMessage(&banner_message);
 }
 
+void
+ConsoleIOThread::_FlushPartialLines()
+{
+	if (fOutputPending.IsEmpty() == false) {
+		_Output(1, fOutputPending.String(), fOutputPending.Length());
+		fOutputPending.Truncate(0);
+	}
+
+	if (fErrorPending.IsEmpty() == false) {
+		_Output(2, fErrorPending.String(), fErrorPending.Length());
+		fErrorPending.Truncate(0);
+	}
+}
+
+void
+ConsoleIOThread::_Output(int32 stream, const char* text, size_t length)
+{
+	// View gone, command still drained
+	if (fRing != nullptr)
+		fRing->Write(stream, text, length);
+
+	if (fDiagnostics != nullptr)
+		fDiagnostics->Feed(stream, text, length);
+}
+
+/*
+ * Stream is closed on end of file or error, what is left of it goes out
+ */
+void
+ConsoleIOThread::_ReadStream(int& fd, BString& pending, int32 stream)
+{
+	const ssize_t bytes = read(fd, fReadBuffer, sizeof(fReadBuffer));
+
+	if (bytes < 0 && (errno == EAGAIN || errno == EINTR))
+		return;
+
+	if (bytes <= 0) {
+		close(fd);
+		fd = -1;
+		if (pending.IsEmpty() == false) {
+			_Output(stream, pending.String(), pending.Length());
+			pending.Truncate(0);
+		}
+		return;
+	}
+
+	const char* start = fReadBuffer;
+	const char* end = fReadBuffer + bytes;
+	const char* last = end;
+
+	while (last > start && last[-1] != '\n')
+		last--;
+
+	// Lines ended, with what was pending before them
+	if (last > start) {
+		if (pending.IsEmpty() == false) {
+			pending.Append(start, last - start);
+			_Output(stream, pending.String(), pending.Length());
+			pending.Truncate(0);
+		} else
+			_Output(stream, start, last - start);
+		start = last;
+	}
+
+	pending.Append(start, end - start);
+	if (pending.Length() >= kConsoleMaxLineLength) {
+		_Output(stream, pending.String(), pending.Length());
+		pending.Truncate(0);
+	}
+}
@@ -12,7 +12,10 @@
  * ConsoleIOThread is the worker class for console I/O (build log, terminal
  * program input/output, etc.).
  * It gets the command (via message) from main window, executes it in pipes
- * and sends the streams to the visual class, ConsoleIOView (via messages).
+ * and writes the streams to a ConsoleIORing the visual class, ConsoleIOView,
+ * drains (the ring itself is handed over via message).
+ * Build output may also go through a DiagnosticsParser, which sends what
+ * it finds to main window.
  * Some logic is also sent, like enabling and disabling Stop button, and start,
  * end, error banners.
  * When the thread is over, or in case of error, a message is sent to the main
@@ -30,7 +33,10 @@
 #include <Messenger.h>
 #include <String.h>
 
+#include "ConsoleIORing.h"
+#include "DiagnosticsParser.h"
 #include "GenericThread.h"
+#include <memory>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -41,6 +47,7 @@ enum {
 	CONSOLEIOTHREAD_EXIT				= 'Cexi',
 	CONSOLEIOTHREAD_CMD_TYPE			= 'Ccty',
 	CONSOLEIOTHREAD_PRINT_BANNER		= 'Cpba',
+	CONSOLEIOTHREAD_RING				= 'Crin',
 	CONSOLEIOTHREAD_STOP				= 'Csto',
 	CONSOLEIOTHREAD_STDOUT				= 'Csou',
 	CONSOLEIOTHREAD_STDERR				= 'Cser'
@@ -75,6 +82,11 @@ private:
 									const char** envp = (const char**)environ);
 
 			void				_BannerMessage(BString status);
+			void				_FlushPartialLines();
+			void				_Output(int32 stream, const char* text,
+									size_t length);
+			void				_ReadStream(int& fd, BString& pending,
+									int32 stream);
 
 			BMessenger			fWindowTarget;
 			BMessenger			fConsoleTarget;
@@ -83,9 +95,13 @@ private:
 			int					fStdIn;
 			int					fStdOut;
 			int					fStdErr;
-			FILE*				fConsoleOutput;
-			FILE*				fConsoleError;
-			char				fConsoleOutputBuffer[LINE_MAX];
+			// Lines not ended yet, stdout and stderr
+			BString				fOutputPending;
+			BString				fErrorPending;
+			char				fReadBuffer[65536];
+			std::shared_ptr<ConsoleIORing>	fRing;
+			// Only if asked with "diagnostics", paths from "directory"
+			std::unique_ptr<DiagnosticsParser>	fDiagnostics;
 			BString 			fCmdType;
 };
 
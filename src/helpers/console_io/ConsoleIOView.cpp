@@ -16,12 +16,13 @@
 #include <Catalog.h>
 #include <CheckBox.h>
 #include <LayoutBuilder.h>
+#include <MessageRunner.h>
 #include <ScrollView.h>
 #include <String.h>
-#include <TextView.h>
 
-#include <AutoDeleter.h>
+#include <cstring>
 
+#include "ConsoleLogView.h"
 #include "IdeamNamespace.h"
 
 #undef B_TRANSLATION_CONTEXT
@@ -29,28 +30,22 @@
 
 enum {
 	MSG_CLEAR_OUTPUT	= 'clou',
-	MSG_POST_OUTPUT		= 'poou',
+	MSG_DRAIN_OUTPUT	= 'drou',
 	MSG_STOP_PROCESS	= 'stpr'
 };
 
-struct ConsoleIOView::OutputInfo {
-	int32 	fd;
-	BString	text;
-
-	OutputInfo(int32 fd, const BString& text)
-		:
-		fd(fd),
-		text(text)
-	{
-	}
-};
+// About 60 frames a second
+static constexpr auto kConsoleDrainInterval = 16667;
 
 ConsoleIOView::ConsoleIOView(const BString& name, const BMessenger& target)
 	:
 	BGroupView(B_VERTICAL, 0.0f)
 	, fWindowTarget(target)
-	, fConsoleIOText(nullptr)
-	, fPendingOutput(nullptr)
+	, fConsoleLog(nullptr)
+	, fDrainRunner(nullptr)
+	, fLastDrain(0)
+	, fFirstOutput(0)
+	, fStats()
 {
 	SetName(name);
 
@@ -63,7 +58,11 @@ ConsoleIOView::ConsoleIOView(const BString& name, const BMessenger& target)
 
 ConsoleIOView::~ConsoleIOView()
 {
-	delete fPendingOutput;
+	delete fDrainRunner;
+
+	// Commands still running must not wait for room
+	for (auto& ring : fRings)
+		ring->Abandon();
 }
 
 /*static*/ ConsoleIOView*
@@ -97,6 +96,21 @@ ConsoleIOView::MessageReceived(BMessage* message)
 			fCmdType = type;
 			break;
 		}
+		case CONSOLEIOTHREAD_RING: {
+			std::shared_ptr<ConsoleIORing>* reference;
+			if (message->FindPointer("ring", (void**)&reference) != B_OK)
+				break;
+
+			fRings.push_back(*reference);
+			delete reference;
+
+			if (fDrainRunner == nullptr) {
+				BMessage drain(MSG_DRAIN_OUTPUT);
+				fDrainRunner = new BMessageRunner(BMessenger(this), &drain,
+					kConsoleDrainInterval);
+			}
+			break;
+		}
 		case CONSOLEIOTHREAD_PRINT_BANNER: {
 			BString banner;
 			if (message->FindString("banner",  &banner) == B_OK)
@@ -104,37 +118,37 @@ ConsoleIOView::MessageReceived(BMessage* message)
 			break;
 		}
 		case CONSOLEIOTHREAD_STDERR: {
+			// A line each
 			BString string;
-			if (message->FindString("stderr",  &string) == B_OK)
+			for (int32 index = 0;
+					message->FindString("stderr", index, &string) == B_OK; index++)
 				ConsoleOutputReceived(2, string);
 			break;
 		}
 		case CONSOLEIOTHREAD_STDOUT: {
 			BString string;
-			if (message->FindString("stdout",  &string) == B_OK)
+			for (int32 index = 0;
+					message->FindString("stdout", index, &string) == B_OK; index++)
 				ConsoleOutputReceived(1, string);
 			break;
 		}
 		case MSG_CLEAR_OUTPUT:
 		{
-			fConsoleIOText->SetText("");
-			fPendingOutput->MakeEmpty();
+			fConsoleLog->SetScrollback(IdeamNames::Settings.console_scrollback);
+			fConsoleLog->Clear();
+			fStats = output_stats();
+			fFirstOutput = 0;
 
 			// Used to reload settings too
 			fWrapEnabled->SetValue(IdeamNames::Settings.wrap_console);
-			fConsoleIOText->SetWordWrap(fWrapEnabled->Value());
+			fConsoleLog->SetWrap(fWrapEnabled->Value() == B_CONTROL_ON);
 			fBannerEnabled->SetValue(IdeamNames::Settings.console_banner);
 
 			break;
 		}
-		case MSG_POST_OUTPUT:
+		case MSG_DRAIN_OUTPUT:
 		{
-			OutputInfo* info = fPendingOutput->RemoveItemAt(0);
-			if (info == nullptr)
-				break;
-
-			ObjectDeleter<OutputInfo> infoDeleter(info);
-			_HandleConsoleOutput(info);
+			_DrainOutput();
 			break;
 		}
 		case MSG_STOP_PROCESS:
@@ -162,7 +176,7 @@ ConsoleIOView::AttachedToWindow()
 	fBannerEnabled->SetEnabled(false);
 
 	fWrapEnabled->SetValue(IdeamNames::Settings.wrap_console);
-	fConsoleIOText->SetWordWrap(fWrapEnabled->Value());
+	fConsoleLog->SetWrap(fWrapEnabled->Value() == B_CONTROL_ON);
 	fBannerEnabled->SetValue(IdeamNames::Settings.console_banner);
 
 	fClearButton->SetTarget(this);
@@ -176,6 +190,9 @@ ConsoleIOView::Clear()
 	BMessenger(this).SendMessage(MSG_CLEAR_OUTPUT);
 }
 
+/*
+ * Typed input echo and banners, not through a ring
+ */
 void
 ConsoleIOView::ConsoleOutputReceived(int32 fd, const BString& output)
 {
@@ -184,16 +201,8 @@ ConsoleIOView::ConsoleOutputReceived(int32 fd, const BString& output)
 	else if (fd == 2 && fStderrEnabled->Value() != B_CONTROL_ON)
 		return;
 
-	OutputInfo* info = new(std::nothrow) OutputInfo(fd, output);
-	if (info == nullptr)
-		return;
-
-	ObjectDeleter<OutputInfo> infoDeleter(info);
-	if (fPendingOutput->AddItem(info)) {
-		infoDeleter.Detach();
-	}
-
-	BMessenger(this).SendMessage(MSG_POST_OUTPUT);
+	fConsoleLog->Append(fd, output.String(), output.Length());
+	fConsoleLog->Update();
 }
 
 void
@@ -203,16 +212,82 @@ ConsoleIOView::EnableStopButton(bool doIt)
 }
 
 void
-ConsoleIOView::_Init()
+ConsoleIOView::GetStats(output_stats& stats) const
+{
+	stats = fStats;
+}
+
+/*
+ * All rings are appended to the log, shown once. Rings done are dropped,
+ * with the last one drain stops.
+ */
+void
+ConsoleIOView::_DrainOutput()
 {
-	fPendingOutput = new OutputInfoList(1, true);
+	const bigtime_t now = system_time();
+	if (fLastDrain > 0 && now - fLastDrain >= 2 * kConsoleDrainInterval)
+		fStats.droppedFrames += (now - fLastDrain) / kConsoleDrainInterval - 1;
+	fLastDrain = now;
+	fStats.frames++;
+
+	const bool stdoutEnabled = fStdoutEnabled->Value() == B_CONTROL_ON;
+	const bool stderrEnabled = fStderrEnabled->Value() == B_CONTROL_ON;
+	size_t bytes = 0;
+
+	auto reader = [&](int32 fd, const char* text, size_t length) {
+		if ((fd == 1 && stdoutEnabled == false)
+			|| (fd == 2 && stderrEnabled == false))
+			return;
+		fConsoleLog->Append(fd, text, length);
+		bytes += length;
+		const char* end = text + length;
+		for (const char* line = text; (line = static_cast<const char*>(
+				memchr(line, '\n', end - line))) != nullptr; line++)
+			fStats.lines++;
+	};
+
+	for (auto ring = fRings.begin(); ring != fRings.end();) {
+		(*ring)->Read(reader);
+		if ((*ring)->IsDone() == true) {
+			fStats.stalls += (*ring)->Stalls();
+			ring = fRings.erase(ring);
+		} else
+			ring++;
+	}
+
+	if (bytes > 0) {
+		if (fFirstOutput == 0)
+			fFirstOutput = now;
+		fStats.elapsed = now - fFirstOutput;
+		fStats.bytes += bytes;
+
+		fConsoleLog->Update();
+	}
 
-	fConsoleIOText = new BTextView("console_io");
-	fConsoleIOText->SetStylable(true);
-	fConsoleIOText->SetDoesUndo(false);
-	fConsoleIOText->MakeEditable(false);
+	if (fRings.empty() == true) {
+		delete fDrainRunner;
+		fDrainRunner = nullptr;
+		fLastDrain = 0;
+
+		BMessage stats(CONSOLEIOVIEW_OUTPUT_STATS);
+		stats.AddString("name", Name());
+		stats.AddInt64("lines", fStats.lines);
+		stats.AddInt64("bytes", fStats.bytes);
+		stats.AddInt64("elapsed", fStats.elapsed);
+		stats.AddInt32("frames", fStats.frames);
+		stats.AddInt32("dropped", fStats.droppedFrames);
+		stats.AddInt32("stalls", fStats.stalls);
+		fWindowTarget.SendMessage(&stats);
+	}
+}
+
+void
+ConsoleIOView::_Init()
+{
+	fConsoleLog = new ConsoleLogView("console_io",
+		IdeamNames::Settings.console_scrollback);
 
-	BScrollView* consoleScrollView  = new BScrollView("console_scroll", fConsoleIOText, 0,
+	BScrollView* consoleScrollView  = new BScrollView("console_scroll", fConsoleLog, 0,
 			true, true);
 
 	fStdoutEnabled = new BCheckBox(B_TRANSLATE("stdout"));
@@ -237,43 +312,3 @@ ConsoleIOView::_Init()
 	.End();
 
 }
-
-void
-ConsoleIOView::_HandleConsoleOutput(OutputInfo* info)
-{
-	if (info->fd == 1 && fStdoutEnabled->Value() != B_CONTROL_ON)
-		return;
-	else if (info->fd == 2 && fStderrEnabled->Value() != B_CONTROL_ON)
-		return;
-
-	text_run_array run;
-	run.count = 1;
-	run.runs[0].font = be_fixed_font;
-	run.runs[0].offset = 0;
-	// stderr goes orange
-	if (info->fd == 2) {
-		run.runs[0].color.red = 236;
-		run.runs[0].color.green = 126;
-		run.runs[0].color.blue = 14;
-	} else {
-		run.runs[0].color.red = 0;
-		run.runs[0].color.green = 0;
-		run.runs[0].color.blue = 0;
-	}
-	run.runs[0].color.alpha = 255;
-
-	bool autoScroll = false;
-	BScrollBar* scroller = fConsoleIOText->ScrollBar(B_VERTICAL);
-	float min, max;
-	scroller->GetRange(&min, &max);
-	if (min == max || scroller->Value() == max)
-		autoScroll = true;
-
-	fConsoleIOText->Insert(fConsoleIOText->TextLength(), info->text,
-		info->text.Length(), &run);
-	if (autoScroll) {
-		scroller->GetRange(&min, &max);
-		fConsoleIOText->ScrollTo(0.0, max);
-	}
-}
-
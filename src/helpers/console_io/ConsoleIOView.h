@@ -10,17 +10,41 @@
 #define CONSOLE_IO_VIEW_H_
 
 #include <GroupView.h>
-#include <ObjectList.h>
+
+#include <memory>
+#include <vector>
 
 #include "ConsoleIOThread.h"
 
 class BButton;
 class BCheckBox;
-class BTextView;
+class BMessageRunner;
+class ConsoleLogView;
+
+enum {
+	CONSOLEIOVIEW_OUTPUT_STATS			= 'Cvos'
+};
 
 
+/*
+ * Output of a command is taken from its ConsoleIORing at most once a frame
+ * and appended to a ConsoleLogView, redrawn once. When the command is over its statistics are
+ * sent to the target.
+ */
 class ConsoleIOView : public BGroupView {
 public:
+	struct output_stats {
+		uint64					lines;
+		uint64					bytes;
+		// From the first output to the last
+		bigtime_t				elapsed;
+		uint32					frames;
+		// Frames the window was too busy to drain
+		uint32					droppedFrames;
+		// Times the command waited for a full ring
+		uint32					stalls;
+	};
+
 								ConsoleIOView(const BString& name, const BMessenger& target);
 								~ConsoleIOView();
 
@@ -34,14 +58,12 @@ public:
 			void				ConsoleOutputReceived(
 									int32 fd, const BString& output);
 			void				EnableStopButton(bool doIt);
+			// Since last clear
+			void				GetStats(output_stats& stats) const;
 
 private:
-			struct OutputInfo;
-			typedef BObjectList<OutputInfo> OutputInfoList;
-
-private:
+			void				_DrainOutput();
 			void				_Init();
-			void				_HandleConsoleOutput(OutputInfo* info);
 
 private:
 			BMessenger			fWindowTarget;
@@ -50,11 +72,15 @@ private:
 			BCheckBox*			fStderrEnabled;
 			BCheckBox*			fWrapEnabled;
 			BCheckBox*			fBannerEnabled;
-			BTextView*			fConsoleIOText;
+			ConsoleLogView*		fConsoleLog;
 			BButton*			fClearButton;
 			BButton*			fStopButton;
 			BString				fCmdType;
-			OutputInfoList*		fPendingOutput;
+			std::vector<std::shared_ptr<ConsoleIORing>>	fRings;
+			BMessageRunner*		fDrainRunner;
+			bigtime_t			fLastDrain;
+			bigtime_t			fFirstOutput;
+			output_stats		fStats;
 };
 
 
@@ -0,0 +1,322 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ConsoleLogBuffer.h"
+
+#include <FindDirectory.h>
+#include <Path.h>
+#include <String.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdlib.h>
+#include <unistd.h>
+
+static constexpr auto kConsoleLogChunkSize = 64 * 1024;
+// Spilled lines read back at once
+static constexpr auto kConsoleLogPageLines = 256;
+// Spill text dropped when over, or its index (16 bytes a line)
+static constexpr auto kConsoleLogMaxSpill = 256 * 1024 * 1024ULL;
+static constexpr auto kConsoleLogMaxSpillIndex = 64 * 1024 * 1024ULL;
+// Longer lines are split, '\r' progress output would never end its own
+static constexpr auto kConsoleLogMaxLine = 64 * 1024;
+
+// Created and unlinked, gone with the descriptor
+static int
+open_temporary(const char* name)
+{
+	BPath path;
+	if (find_directory(B_SYSTEM_TEMP_DIRECTORY, &path) != B_OK)
+		return -1;
+
+	BString pattern(path.Path());
+	pattern << "/" << name << "-XXXXXX";
+
+	char* buffer = pattern.LockBuffer(0);
+	const int fd = mkstemp(buffer);
+	if (fd >= 0)
+		unlink(buffer);
+	pattern.UnlockBuffer();
+
+	return fd;
+}
+
+ConsoleLogBuffer::ConsoleLogBuffer(int32 scrollback)
+	:
+	fScrollback(std::max(scrollback, (int32)1))
+	, fFirstLine(0)
+	, fMemoryFirst(0)
+	, fOpen(false)
+	, fLongest(0)
+	, fSpillText(-1)
+	, fSpillIndex(-1)
+	, fSpillBase(0)
+	, fSpillBytes(0)
+	, fPageFirst(-1)
+{
+}
+
+ConsoleLogBuffer::~ConsoleLogBuffer()
+{
+	if (fSpillText >= 0)
+		close(fSpillText);
+	if (fSpillIndex >= 0)
+		close(fSpillIndex);
+}
+
+void
+ConsoleLogBuffer::Append(int32 stream, const char* text, size_t length)
+{
+	const char* end = text + length;
+
+	while (text < end) {
+		const char* newline = static_cast<const char*>(
+			memchr(text, '\n', end - text));
+		const char* stop = newline != nullptr ? newline : end;
+
+		const size_t room = kConsoleLogMaxLine
+			- (fOpen == true ? fLines.back().length : 0);
+		if ((size_t)(stop - text) > room) {
+			_AddText(stream, text, room, false);
+			text += room;
+			continue;
+		}
+
+		_AddText(stream, text, stop - text, newline == nullptr);
+		text = stop + (newline != nullptr ? 1 : 0);
+	}
+
+	_Trim();
+}
+
+/*
+ * Memory is bounded by the scrollback, the spill file is just truncated
+ */
+void
+ConsoleLogBuffer::Clear()
+{
+	fLines.clear();
+	fChunks.clear();
+	fMemoryFirst = 0;
+	fOpen = false;
+	fLongest = 0;
+
+	_DropSpill(0);
+}
+
+void
+ConsoleLogBuffer::SetScrollback(int32 lines)
+{
+	fScrollback = std::max(lines, (int32)1);
+
+	_Trim();
+}
+
+bool
+ConsoleLogBuffer::Line(int64 index, const char*& text, size_t& length,
+	int32& stream)
+{
+	if (index < fFirstLine || index >= CountLines())
+		return false;
+
+	if (index >= fMemoryFirst) {
+		const line& found = fLines[index - fMemoryFirst];
+		text = found.text;
+		length = found.length;
+		stream = found.stream;
+		return true;
+	}
+
+	if (_LoadPage(index) == false)
+		return false;
+
+	const spilled_line& found = fPageIndex[index - fPageFirst];
+	text = fPageText.data() + (found.offset - fPageIndex.front().offset);
+	length = found.length;
+	stream = found.stream;
+	return true;
+}
+
+/*
+ * Line still open is the last text of the newest chunk: it grows in
+ * place or moves to a new chunk whole
+ */
+void
+ConsoleLogBuffer::_AddText(int32 stream, const char* text, size_t length,
+	bool open)
+{
+	const int64 index = CountLines() - 1;
+
+	if (fOpen == true) {
+		line& last = fLines.back();
+		chunk* current = fChunks.back().get();
+
+		if (current->size - current->used >= length) {
+			memcpy(current->data.get() + current->used, text, length);
+			current->used += length;
+		} else {
+			char* moved = _Reserve(last.length + length);
+			memcpy(moved, last.text, last.length);
+			memcpy(moved + last.length, text, length);
+			last.text = moved;
+
+			if (current->lastLine == index)
+				current->lastLine = index - 1;
+			fChunks.back()->lastLine = index;
+		}
+		last.length += length;
+	} else {
+		char* place = _Reserve(length);
+		memcpy(place, text, length);
+		fLines.push_back({ place, (uint32)length, stream });
+		fChunks.back()->lastLine = index + 1;
+	}
+
+	fOpen = open;
+	fLongest = std::max(fLongest, (size_t)fLines.back().length);
+}
+
+void
+ConsoleLogBuffer::_DropSpill(int64 base)
+{
+	if (fSpillText >= 0)
+		ftruncate(fSpillText, 0);
+	if (fSpillIndex >= 0)
+		ftruncate(fSpillIndex, 0);
+
+	fSpillBytes = 0;
+	fSpillBase = base;
+	fFirstLine = base;
+	fPageFirst = -1;
+}
+
+bool
+ConsoleLogBuffer::_LoadPage(int64 index)
+{
+	if (fPageFirst >= 0 && index >= fPageFirst
+		&& index < fPageFirst + (int64)fPageIndex.size())
+		return true;
+
+	fPageFirst = -1;
+
+	const int64 first = std::max(fFirstLine, fSpillBase
+		+ (index - fSpillBase) / kConsoleLogPageLines * kConsoleLogPageLines);
+	const int64 last = std::min(first + kConsoleLogPageLines, fMemoryFirst);
+
+	fPageIndex.resize(last - first);
+	const ssize_t indexSize = fPageIndex.size() * sizeof(spilled_line);
+	if (pread(fSpillIndex, fPageIndex.data(), indexSize,
+			(first - fSpillBase) * sizeof(spilled_line)) != indexSize)
+		return false;
+
+	const uint64 offset = fPageIndex.front().offset;
+	const ssize_t textSize = fPageIndex.back().offset
+		+ fPageIndex.back().length - offset;
+	fPageText.resize(textSize);
+	if (pread(fSpillText, fPageText.data(), textSize, offset) != textSize)
+		return false;
+
+	fPageFirst = first;
+	return true;
+}
+
+status_t
+ConsoleLogBuffer::_OpenSpill()
+{
+	if (fSpillText >= 0 && fSpillIndex >= 0)
+		return B_OK;
+
+	if (fSpillText < 0)
+		fSpillText = open_temporary("ideam-console-text");
+	if (fSpillIndex < 0)
+		fSpillIndex = open_temporary("ideam-console-index");
+
+	return fSpillText >= 0 && fSpillIndex >= 0 ? B_OK : B_ERROR;
+}
+
+char*
+ConsoleLogBuffer::_Reserve(size_t length)
+{
+	chunk* current = fChunks.empty() ? nullptr : fChunks.back().get();
+
+	if (current == nullptr || current->size - current->used < length) {
+		std::unique_ptr<chunk> created(new chunk);
+		created->size = std::max((size_t)kConsoleLogChunkSize, length * 2);
+		created->data.reset(new char[created->size]);
+		created->used = 0;
+		created->lastLine = -1;
+		fChunks.push_back(std::move(created));
+		current = fChunks.back().get();
+	}
+
+	char* place = current->data.get() + current->used;
+	current->used += length;
+	return place;
+}
+
+/*
+ * Oldest lines go, written to the spill file in one go, then the chunks
+ * left without lines. On failure they are just lost.
+ */
+void
+ConsoleLogBuffer::_Spill(int64 count)
+{
+	const int64 batchFirst = fMemoryFirst;
+	std::vector<spilled_line> index;
+	std::vector<char> text;
+
+	for (; count > 0; count--) {
+		const line& gone = fLines.front();
+		index.push_back({ text.size(), gone.length, gone.stream });
+		text.insert(text.end(), gone.text, gone.text + gone.length);
+		fLines.pop_front();
+		fMemoryFirst++;
+	}
+
+	// Newest chunk holds the last line, always in memory
+	while (fChunks.size() > 1 && fChunks.front()->lastLine < fMemoryFirst)
+		fChunks.pop_front();
+
+	if (index.empty() == true)
+		return;
+
+	if (_OpenSpill() != B_OK) {
+		_DropSpill(fMemoryFirst);
+		return;
+	}
+
+	if (fSpillBytes + text.size() > kConsoleLogMaxSpill
+		|| (fMemoryFirst - fSpillBase) * sizeof(spilled_line)
+			> kConsoleLogMaxSpillIndex)
+		_DropSpill(batchFirst);
+
+	for (spilled_line& spilled : index)
+		spilled.offset += fSpillBytes;
+
+	const ssize_t indexSize = index.size() * sizeof(spilled_line);
+	if (pwrite(fSpillText, text.data(), text.size(), fSpillBytes)
+			!= (ssize_t)text.size()
+		|| pwrite(fSpillIndex, index.data(), indexSize,
+			(batchFirst - fSpillBase) * sizeof(spilled_line)) != indexSize) {
+		_DropSpill(fMemoryFirst);
+		return;
+	}
+
+	fSpillBytes += text.size();
+}
+
+/*
+ * By lines, whatever bytes they take. A quarter of the scrollback goes at
+ * once, so short lines are not spilled one at a time.
+ */
+void
+ConsoleLogBuffer::_Trim()
+{
+	if ((int64)fLines.size() <= fScrollback)
+		return;
+
+	const int64 kept = std::max((int64)1, (int64)fScrollback - fScrollback / 4);
+	_Spill(fLines.size() - kept);
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef CONSOLE_LOG_BUFFER_H
+#define CONSOLE_LOG_BUFFER_H
+
+#include <SupportDefs.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+/*
+ * Lines of a console log, appended to fixed size chunks. The newest
+ * scrollback lines are kept in memory, older ones spill to a temporary
+ * file (text and a fixed size index) and are paged back when asked for.
+ * The spill file is bounded too: when full, what it holds is dropped.
+ *
+ * Line numbers grow from the last Clear(), lines before FirstLine() are
+ * gone. The last line is open while not ended by a newline, lines over
+ * 64 KiB are split.
+ */
+class ConsoleLogBuffer {
+public:
+								ConsoleLogBuffer(int32 scrollback);
+								~ConsoleLogBuffer();
+
+			void				Append(int32 stream, const char* text,
+									size_t length);
+			void				Clear();
+			void				SetScrollback(int32 lines);
+
+			int64				FirstLine() const { return fFirstLine; }
+			// One past the last line
+			int64				CountLines() const
+									{ return fMemoryFirst + fLines.size(); }
+			// Bytes, since last clear
+			size_t				LongestLine() const { return fLongest; }
+
+			// Text comes without its newline, valid until next call or append
+			bool				Line(int64 index, const char*& text,
+									size_t& length, int32& stream);
+
+private:
+	struct chunk {
+		std::unique_ptr<char[]>	data;
+		size_t					size;
+		size_t					used;
+		// Last line begun here, -1 if none
+		int64					lastLine;
+	};
+	struct line {
+		const char*				text;
+		uint32					length;
+		int32					stream;
+	};
+	struct spilled_line {
+		uint64					offset;
+		uint32					length;
+		int32					stream;
+	};
+
+			void				_AddText(int32 stream, const char* text,
+									size_t length, bool open);
+			void				_DropSpill(int64 base);
+			bool				_LoadPage(int64 index);
+			status_t			_OpenSpill();
+			char*				_Reserve(size_t length);
+			void				_Spill(int64 count);
+			void				_Trim();
+
+			int32				fScrollback;
+			std::deque<std::unique_ptr<chunk>>	fChunks;
+			std::deque<line>	fLines;
+			int64				fFirstLine;
+			// First line in memory, before are in the spill file
+			int64				fMemoryFirst;
+			bool				fOpen;
+			size_t				fLongest;
+
+			int					fSpillText;
+			int					fSpillIndex;
+			// Line at the start of the index file
+			int64				fSpillBase;
+			uint64				fSpillBytes;
+
+			int64				fPageFirst;
+			std::vector<spilled_line>	fPageIndex;
+			std::vector<char>	fPageText;
+};
+
+#endif // CONSOLE_LOG_BUFFER_H
@@ -0,0 +1,507 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ConsoleLogView.h"
+
+#include <Clipboard.h>
+#include <ScrollBar.h>
+#include <Window.h>
+
+#include <algorithm>
+
+static constexpr auto kConsoleLogTabWidth = 8;
+
+// stderr goes orange
+static const rgb_color kConsoleLogErrorColor = { 236, 126, 14, 255 };
+
+/*
+ * Tabs to spaces, an UTF-8 character a column, other control characters
+ * dropped
+ */
+static void
+expand_text(const char* text, size_t length, BString& display)
+{
+	display.Truncate(0);
+	int32 column = 0;
+
+	for (size_t index = 0; index < length; index++) {
+		const unsigned char byte = text[index];
+		if (byte == '\t') {
+			const int32 spaces = kConsoleLogTabWidth - column % kConsoleLogTabWidth;
+			display.Append(' ', spaces);
+			column += spaces;
+		} else if (byte >= 0x20) {
+			display.Append(static_cast<char>(byte), 1);
+			if ((byte & 0xC0) != 0x80)
+				column++;
+		}
+	}
+}
+
+// Byte offset in the original text of a column of its expanded one
+static size_t
+source_offset(const char* text, size_t length, int32 column)
+{
+	int32 current = 0;
+
+	for (size_t index = 0; index < length; index++) {
+		const unsigned char byte = text[index];
+		if ((byte & 0xC0) == 0x80)
+			continue;
+		if (current >= column)
+			return index;
+		if (byte == '\t')
+			current += kConsoleLogTabWidth - current % kConsoleLogTabWidth;
+		else if (byte >= 0x20)
+			current++;
+	}
+
+	return length;
+}
+
+// Byte offset of a column in expanded text
+static int32
+display_offset(const BString& display, int32 column)
+{
+	const char* text = display.String();
+	int32 index = 0;
+
+	for (; text[index] != '\0'; index++) {
+		if ((text[index] & 0xC0) == 0x80)
+			continue;
+		if (column-- == 0)
+			break;
+	}
+
+	return index;
+}
+
+ConsoleLogView::ConsoleLogView(const char* name, int32 scrollback)
+	:
+	BView(name, B_WILL_DRAW | B_FRAME_EVENTS | B_NAVIGABLE)
+	, fBuffer(scrollback)
+	, fLineHeight(1.0f)
+	, fAscent(0.0f)
+	, fCharWidth(1.0f)
+	, fTopLine(0)
+	, fLeft(0.0f)
+	, fWrap(false)
+	, fFollow(true)
+	, fAnchor{ 0, 0 }
+	, fSelectionStart{ 0, 0 }
+	, fSelectionEnd{ 0, 0 }
+	, fSelecting(false)
+{
+}
+
+void
+ConsoleLogView::AttachedToWindow()
+{
+	BView::AttachedToWindow();
+
+	SetViewUIColor(B_DOCUMENT_BACKGROUND_COLOR);
+	SetLowUIColor(B_DOCUMENT_BACKGROUND_COLOR);
+	SetFont(be_fixed_font);
+
+	font_height height;
+	GetFontHeight(&height);
+	fAscent = ceilf(height.ascent);
+	fLineHeight = ceilf(height.ascent + height.descent + height.leading);
+	fCharWidth = StringWidth("M");
+
+	_UpdateScrollBars();
+}
+
+void
+ConsoleLogView::Draw(BRect updateRect)
+{
+	const BRect bounds(Bounds());
+	const int32 columns = _Columns();
+	const int64 count = fBuffer.CountLines();
+	const bool selection = fSelectionStart < fSelectionEnd;
+	const rgb_color textColor = ui_color(B_DOCUMENT_TEXT_COLOR);
+	const rgb_color selectionColor = tint_color(ViewColor(), B_DARKEN_2_TINT);
+
+	BString display;
+	int32 stream;
+	float y = bounds.top;
+
+	for (int64 line = fTopLine; line < count && y <= bounds.bottom; line++) {
+		_ExpandLine(line, display, stream);
+		const int32 length = display.CountChars();
+		const int32 rows = fWrap == true
+			? std::max((int32)1, (length + columns - 1) / columns) : 1;
+
+		if (y + rows * fLineHeight < updateRect.top) {
+			y += rows * fLineHeight;
+			continue;
+		}
+
+		for (int32 row = 0; row < rows && y <= bounds.bottom;
+				row++, y += fLineHeight) {
+			int32 first, last;
+			float x;
+			if (fWrap == true) {
+				first = row * columns;
+				last = std::min(length, first + columns);
+				x = bounds.left;
+			} else {
+				first = std::min(length, (int32)(fLeft / fCharWidth));
+				last = std::min(length, first + columns + 1);
+				x = bounds.left + first * fCharWidth - fLeft;
+			}
+
+			if (selection == true && line >= fSelectionStart.line
+				&& line <= fSelectionEnd.line) {
+				// Line end selected too, up to the next
+				const int32 from = std::max(first, line == fSelectionStart.line
+					? fSelectionStart.column : 0);
+				const int32 to = std::min(row == rows - 1 ? last + 1 : last,
+					line == fSelectionEnd.line ? fSelectionEnd.column : length + 1);
+				if (from < to) {
+					SetHighColor(selectionColor);
+					FillRect(BRect(x + (from - first) * fCharWidth, y,
+						x + (to - first) * fCharWidth - 1, y + fLineHeight - 1));
+				}
+			}
+
+			if (first < last) {
+				const int32 offset = display_offset(display, first);
+				SetHighColor(stream == 2 ? kConsoleLogErrorColor : textColor);
+				DrawString(display.String() + offset,
+					display_offset(display, last) - offset,
+					BPoint(x, y + fAscent));
+			}
+		}
+	}
+}
+
+void
+ConsoleLogView::FrameResized(float width, float height)
+{
+	BView::FrameResized(width, height);
+	Update();
+}
+
+void
+ConsoleLogView::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case B_COPY:
+			_Copy();
+			break;
+		case B_SELECT_ALL:
+			fSelectionStart = { fBuffer.FirstLine(), 0 };
+			fSelectionEnd = { fBuffer.CountLines(), 0 };
+			Invalidate();
+			break;
+		default:
+			BView::MessageReceived(message);
+			break;
+	}
+}
+
+void
+ConsoleLogView::MouseDown(BPoint where)
+{
+	MakeFocus(true);
+
+	int32 clicks = 1;
+	if (Window()->CurrentMessage() != nullptr)
+		Window()->CurrentMessage()->FindInt32("clicks", &clicks);
+
+	const position at = _PositionAt(where);
+
+	if ((modifiers() & B_SHIFT_KEY) == 0)
+		fAnchor = at;
+
+	if (clicks >= 2) {
+		// Whole line
+		fAnchor = { at.line, 0 };
+		fSelectionStart = fAnchor;
+		fSelectionEnd = { at.line + 1, 0 };
+	} else {
+		fSelectionStart = std::min(fAnchor, at);
+		fSelectionEnd = std::max(fAnchor, at);
+	}
+
+	fSelecting = true;
+	SetMouseEventMask(B_POINTER_EVENTS,
+		B_LOCK_WINDOW_FOCUS | B_NO_POINTER_HISTORY);
+	Invalidate();
+}
+
+void
+ConsoleLogView::MouseMoved(BPoint where, uint32 transit,
+	const BMessage* dragMessage)
+{
+	if (fSelecting == false) {
+		BView::MouseMoved(where, transit, dragMessage);
+		return;
+	}
+
+	// Out of sight: a line at a time
+	if (where.y < Bounds().top && fTopLine > fBuffer.FirstLine())
+		_ScrollToLine(fTopLine - 1);
+	else if (where.y > Bounds().bottom && fTopLine < _EndTopLine())
+		_ScrollToLine(fTopLine + 1);
+
+	const position at = _PositionAt(where);
+	fSelectionStart = std::min(fAnchor, at);
+	fSelectionEnd = std::max(fAnchor, at);
+	Invalidate();
+}
+
+void
+ConsoleLogView::MouseUp(BPoint where)
+{
+	fSelecting = false;
+}
+
+/*
+ * The origin follows the scroll bars, so one scrolled keeps the other's
+ * value and a bar back at 0 still differs from it. Lines are drawn from
+ * the top one wherever the origin is.
+ */
+void
+ConsoleLogView::ScrollTo(BPoint where)
+{
+	BView::ScrollTo(where);
+	where = Bounds().LeftTop();
+
+	const int64 first = fBuffer.FirstLine();
+	const int64 last = std::max(first, fBuffer.CountLines() - 1);
+
+	fTopLine = std::min(last, first + (int64)(where.y / fLineHeight + 0.5f));
+	fLeft = fWrap == true ? 0.0f : std::max(0.0f, where.x);
+	fFollow = fTopLine >= _EndTopLine();
+
+	Invalidate();
+}
+
+void
+ConsoleLogView::Append(int32 stream, const char* text, size_t length)
+{
+	fBuffer.Append(stream, text, length);
+}
+
+void
+ConsoleLogView::Clear()
+{
+	fBuffer.Clear();
+	fTopLine = 0;
+	fLeft = 0.0f;
+	fFollow = true;
+	fSelectionStart = fSelectionEnd = fAnchor = { 0, 0 };
+
+	Update();
+}
+
+void
+ConsoleLogView::Update()
+{
+	// Lines dropped from the spill file
+	fTopLine = std::max(fTopLine, fBuffer.FirstLine());
+
+	// Bar value again from the first line, which may have moved
+	const bool follow = fFollow;
+	_UpdateScrollBars();
+	_ScrollToLine(follow == true ? _EndTopLine() : fTopLine);
+
+	Invalidate();
+}
+
+void
+ConsoleLogView::SetScrollback(int32 lines)
+{
+	fBuffer.SetScrollback(lines);
+}
+
+void
+ConsoleLogView::SetWrap(bool wrap)
+{
+	if (fWrap == wrap)
+		return;
+
+	fWrap = wrap;
+	fLeft = 0.0f;
+	Update();
+}
+
+int32
+ConsoleLogView::_Columns() const
+{
+	return std::max((int32)1, (int32)(Bounds().Width() / fCharWidth));
+}
+
+void
+ConsoleLogView::_Copy()
+{
+	if ((fSelectionStart < fSelectionEnd) == false)
+		return;
+
+	BString copied;
+	const int64 last = std::min(fSelectionEnd.line, fBuffer.CountLines() - 1);
+
+	for (int64 line = std::max(fSelectionStart.line, fBuffer.FirstLine());
+			line <= last; line++) {
+		const char* text;
+		size_t length;
+		int32 stream;
+		if (fBuffer.Line(line, text, length, stream) == false)
+			continue;
+
+		const size_t from = line == fSelectionStart.line
+			? source_offset(text, length, fSelectionStart.column) : 0;
+		const size_t to = line == fSelectionEnd.line
+			? source_offset(text, length, fSelectionEnd.column) : length;
+		copied.Append(text + from, to - from);
+		if (line != fSelectionEnd.line)
+			copied << '\n';
+	}
+
+	if (be_clipboard->Lock() == false)
+		return;
+
+	be_clipboard->Clear();
+	BMessage* clip = be_clipboard->Data();
+	if (clip != nullptr) {
+		clip->AddData("text/plain", B_MIME_TYPE, copied.String(),
+			copied.Length());
+		be_clipboard->Commit();
+	}
+	be_clipboard->Unlock();
+}
+
+/*
+ * Top line with the last one at the bottom
+ */
+int64
+ConsoleLogView::_EndTopLine()
+{
+	const int64 first = fBuffer.FirstLine();
+	const int64 count = fBuffer.CountLines();
+	const int32 rows = _Rows();
+
+	if (fWrap == false)
+		return std::max(first, count - rows);
+
+	const int32 columns = _Columns();
+	BString display;
+	int32 stream;
+	int64 line = count;
+	int32 used = 0;
+
+	while (line > first) {
+		_ExpandLine(line - 1, display, stream);
+		const int32 lineRows = std::max((int32)1,
+			(display.CountChars() + columns - 1) / columns);
+		if (used + lineRows > rows && used > 0)
+			break;
+		used += lineRows;
+		line--;
+	}
+
+	return std::min(line, std::max(first, count - 1));
+}
+
+void
+ConsoleLogView::_ExpandLine(int64 index, BString& display, int32& stream)
+{
+	const char* text;
+	size_t length;
+
+	if (fBuffer.Line(index, text, length, stream) == false) {
+		display.Truncate(0);
+		stream = 1;
+		return;
+	}
+
+	expand_text(text, length, display);
+}
+
+ConsoleLogView::position
+ConsoleLogView::_PositionAt(BPoint where)
+{
+	const int64 count = fBuffer.CountLines();
+	const int32 columns = _Columns();
+
+	if (count == 0)
+		return { 0, 0 };
+	if (where.y < Bounds().top)
+		return { fTopLine, 0 };
+
+	BString display;
+	int32 stream;
+	float y = Bounds().top;
+
+	for (int64 line = fTopLine; line < count; line++) {
+		_ExpandLine(line, display, stream);
+		const int32 length = display.CountChars();
+		const int32 rows = fWrap == true
+			? std::max((int32)1, (length + columns - 1) / columns) : 1;
+
+		if (where.y < y + rows * fLineHeight || line == count - 1) {
+			const int32 row = std::min(rows - 1,
+				std::max((int32)0, (int32)((where.y - y) / fLineHeight)));
+			const float x = std::max(0.0f, where.x - Bounds().left);
+			const int32 column = fWrap == true
+				? row * columns + (int32)(x / fCharWidth + 0.5f)
+				: (int32)((x + fLeft) / fCharWidth + 0.5f);
+			return { line, std::min(column, length) };
+		}
+
+		y += rows * fLineHeight;
+	}
+
+	return { count - 1, 0 };
+}
+
+int32
+ConsoleLogView::_Rows() const
+{
+	return std::max((int32)1, (int32)(Bounds().Height() / fLineHeight));
+}
+
+void
+ConsoleLogView::_ScrollToLine(int64 line)
+{
+	const float value = (line - fBuffer.FirstLine()) * fLineHeight;
+	BScrollBar* scroller = ScrollBar(B_VERTICAL);
+
+	if (scroller != nullptr)
+		scroller->SetValue(value);
+	// Also when the value stays, with another first line
+	ScrollTo(BPoint(Bounds().left, value));
+}
+
+void
+ConsoleLogView::_UpdateScrollBars()
+{
+	const int64 lines = fBuffer.CountLines() - fBuffer.FirstLine();
+	const int32 rows = _Rows();
+
+	BScrollBar* scroller = ScrollBar(B_VERTICAL);
+	if (scroller != nullptr) {
+		// Wrapped rows are not counted, last line may be the top one
+		const int64 most = fWrap == true
+			? std::max((int64)0, lines - 1)
+			: std::max((int64)0, lines - rows);
+		scroller->SetRange(0.0f, most * fLineHeight);
+		scroller->SetProportion(lines > 0
+			? std::min(1.0f, (float)rows / lines) : 1.0f);
+		scroller->SetSteps(fLineHeight, std::max(1, rows - 1) * fLineHeight);
+	}
+
+	scroller = ScrollBar(B_HORIZONTAL);
+	if (scroller != nullptr) {
+		const float width = Bounds().Width();
+		const float extent = fWrap == true
+			? 0.0f : fBuffer.LongestLine() * fCharWidth;
+		scroller->SetRange(0.0f, std::max(0.0f, extent - width));
+		scroller->SetProportion(extent > width ? width / extent : 1.0f);
+		scroller->SetSteps(fCharWidth, width / 2);
+	}
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef CONSOLE_LOG_VIEW_H
+#define CONSOLE_LOG_VIEW_H
+
+#include <View.h>
+
+#include "ConsoleLogBuffer.h"
+
+/*
+ * Console log drawing only the lines in sight, out of a ConsoleLogBuffer.
+ * Scrolling is by whole lines and done here: the first line shown follows
+ * the vertical scroll bar and is drawn at the top whatever the origin.
+ * Fixed font, tabs expanded, long lines wrapped or scrolled sideways.
+ *
+ * Text may be selected with the mouse and copied (B_COPY, B_SELECT_ALL).
+ */
+class ConsoleLogView : public BView {
+public:
+								ConsoleLogView(const char* name,
+									int32 scrollback);
+
+	virtual	void				AttachedToWindow();
+	virtual	void				Draw(BRect updateRect);
+	virtual	void				FrameResized(float width, float height);
+	virtual	void				MessageReceived(BMessage* message);
+	virtual	void				MouseDown(BPoint where);
+	virtual	void				MouseMoved(BPoint where, uint32 transit,
+									const BMessage* dragMessage);
+	virtual	void				MouseUp(BPoint where);
+	virtual	void				ScrollTo(BPoint where);
+
+			// Shown on next Update()
+			void				Append(int32 stream, const char* text,
+									size_t length);
+			void				Clear();
+			// Scroll bars and drawing after appends, follows the end if
+			// it was in sight
+			void				Update();
+
+			void				SetScrollback(int32 lines);
+			void				SetWrap(bool wrap);
+
+private:
+	struct position {
+		int64					line;
+		int32					column;
+
+		bool operator<(const position& other) const
+		{
+			return line < other.line
+				|| (line == other.line && column < other.column);
+		}
+	};
+
+			int32				_Columns() const;
+			void				_Copy();
+			int64				_EndTopLine();
+			void				_ExpandLine(int64 index, BString& display,
+									int32& stream);
+			position			_PositionAt(BPoint where);
+			int32				_Rows() const;
+			void				_ScrollToLine(int64 line);
+			void				_UpdateScrollBars();
+
+			ConsoleLogBuffer	fBuffer;
+			float				fLineHeight;
+			float				fAscent;
+			float				fCharWidth;
+			int64				fTopLine;
+			float				fLeft;
+			bool				fWrap;
+			bool				fFollow;
+
+			position			fAnchor;
+			position			fSelectionStart;
+			position			fSelectionEnd;
+			bool				fSelecting;
+};
+
+#endif // CONSOLE_LOG_VIEW_H
@@ -0,0 +1,347 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "DiagnosticsParser.h"
+
+#include <OS.h>
+
+#include <cstring>
+
+static constexpr auto kDiagnosticsBatchSize = 256;
+static constexpr auto kDiagnosticsBatchInterval = 100000;
+// Diagnostics sent at most, the rest only counted
+static constexpr auto kDiagnosticsMaxSent = 10000;
+// Longer lines are not diagnostics
+static constexpr auto kDiagnosticsMaxLine = 65536;
+
+static bool
+starts_with(const char* text, const char* end, const char* prefix)
+{
+	const size_t length = strlen(prefix);
+	return (size_t)(end - text) >= length && memcmp(text, prefix, length) == 0;
+}
+
+// Number at text, which is moved past it. -1 if none
+static int32
+parse_number(const char*& text, const char* end)
+{
+	int32 number = -1;
+
+	for (int32 digits = 0; text < end && *text >= '0' && *text <= '9'
+			&& digits < 9; text++, digits++)
+		number = (number < 0 ? 0 : number * 10) + (*text - '0');
+
+	return number;
+}
+
+DiagnosticsParser::DiagnosticsParser(const BMessenger& target,
+	const BString& directory)
+	:
+	fTarget(target)
+	, fDirectory(directory)
+	, fRustPending(false)
+	, fRustSeverity(kDiagnosticError)
+	, fBatch(DIAGNOSTICSPARSER_FOUND)
+	, fBatchCount(0)
+	, fSent(0)
+	, fLastFlush(system_time())
+	, fErrors(0)
+	, fWarnings(0)
+{
+}
+
+/*
+ * Whole lines are parsed where they are, only a line split across calls is
+ * copied. Streams are kept apart, a partial stdout line may be flushed
+ * before a stderr one.
+ */
+void
+DiagnosticsParser::Feed(int32 stream, const char* text, size_t length)
+{
+	const char* end = text + length;
+	pending_line& pending = fPending[stream == 2 ? 1 : 0];
+
+	while (text < end) {
+		const char* newline = static_cast<const char*>(
+			memchr(text, '\n', end - text));
+
+		if (newline == nullptr) {
+			if (pending.skip == true)
+				break;
+			if (pending.text.Length() + (end - text) <= kDiagnosticsMaxLine)
+				pending.text.Append(text, end - text);
+			else {
+				// Dropped up to its newline
+				pending.text.Truncate(0);
+				pending.skip = true;
+			}
+			break;
+		}
+
+		if (pending.skip == true)
+			pending.skip = false;
+		else if (pending.text.IsEmpty() == false) {
+			pending.text.Append(text, newline - text);
+			_ParseLine(pending.text.String(), pending.text.Length());
+			pending.text.Truncate(0);
+		} else
+			_ParseLine(text, newline - text);
+
+		text = newline + 1;
+	}
+
+	if (fBatchCount > 0 && system_time() - fLastFlush >= kDiagnosticsBatchInterval)
+		_Flush(false);
+}
+
+void
+DiagnosticsParser::Finish()
+{
+	for (pending_line& pending : fPending) {
+		if (pending.skip == false && pending.text.IsEmpty() == false)
+			_ParseLine(pending.text.String(), pending.text.Length());
+		pending.text.Truncate(0);
+		pending.skip = false;
+	}
+
+	_Flush(true);
+}
+
+void
+DiagnosticsParser::_Add(int32 severity, const char* path, size_t pathLength,
+	int32 line, int32 column, const char* text, size_t textLength)
+{
+	if (severity == kDiagnosticError)
+		fErrors++;
+	else if (severity == kDiagnosticWarning)
+		fWarnings++;
+
+	if (fSent + fBatchCount >= kDiagnosticsMaxSent)
+		return;
+
+	BString file;
+	if (pathLength > 0) {
+		if (path[0] != '/')
+			file << fDirectory << "/";
+		file.Append(path, pathLength);
+	}
+
+	fBatch.AddInt32("severity", severity);
+	fBatch.AddString("path", file);
+	fBatch.AddInt32("line", line);
+	fBatch.AddInt32("column", column);
+	fBatch.AddString("text", BString(text, textLength));
+
+	if (++fBatchCount >= kDiagnosticsBatchSize)
+		_Flush(false);
+}
+
+void
+DiagnosticsParser::_Flush(bool done)
+{
+	if (fBatchCount == 0 && done == false)
+		return;
+
+	fBatch.AddInt32("errors", fErrors);
+	fBatch.AddInt32("warnings", fWarnings);
+	if (done == true)
+		fBatch.AddBool("done", true);
+
+	fTarget.SendMessage(&fBatch);
+
+	fBatch.MakeEmpty();
+	fSent += fBatchCount;
+	fBatchCount = 0;
+	fLastFlush = system_time();
+}
+
+/*
+ * path:line[:column]: [fatal ]error|warning: text
+ * Colons are tried in turn, paths may have some
+ */
+bool
+DiagnosticsParser::_ParseCompiler(const char* line, const char* end)
+{
+	for (const char* colon = static_cast<const char*>(
+			memchr(line, ':', end - line)); colon != nullptr;
+			colon = static_cast<const char*>(
+				memchr(colon + 1, ':', end - colon - 1))) {
+		const char* text = colon + 1;
+		const int32 number = parse_number(text, end);
+		if (number < 0 || colon == line || text >= end || *text != ':')
+			continue;
+
+		int32 column = 0;
+		const char* afterColumn = text + 1;
+		const int32 parsed = parse_number(afterColumn, end);
+		if (parsed >= 0 && afterColumn < end && *afterColumn == ':') {
+			column = parsed;
+			text = afterColumn;
+		}
+		text++;
+
+		int32 severity;
+		if (starts_with(text, end, " error: ")) {
+			severity = kDiagnosticError;
+			text += 8;
+		} else if (starts_with(text, end, " fatal error: ")) {
+			severity = kDiagnosticError;
+			text += 14;
+		} else if (starts_with(text, end, " warning: ")) {
+			severity = kDiagnosticWarning;
+			text += 10;
+		} else
+			continue;
+
+		_Add(severity, line, colon - line, number, column, text, end - text);
+		return true;
+	}
+
+	return false;
+}
+
+bool
+DiagnosticsParser::_ParseJam(const char* line, const char* end)
+{
+	if (starts_with(line, end, "...failed ")) {
+		const char* text = line + 10;
+		// "...failed updating N target(s)...", the actions were listed
+		if (starts_with(text, end, "updating "))
+			return true;
+		if (end - text > 4 && starts_with(end - 4, end, " ..."))
+			end -= 4;
+		_Add(kDiagnosticFailed, nullptr, 0, 0, 0, text, end - text);
+		return true;
+	}
+
+	if (starts_with(line, end, "don't know how to make ")) {
+		_Add(kDiagnosticError, nullptr, 0, 0, 0, line, end - line);
+		return true;
+	}
+
+	// Jamfile parse errors, path: line N: text
+	const char* colon = static_cast<const char*>(memchr(line, ':', end - line));
+	if (colon == nullptr || colon == line
+		|| starts_with(colon, end, ": line ") == false)
+		return false;
+
+	const char* text = colon + 7;
+	const int32 number = parse_number(text, end);
+	if (number < 0 || starts_with(text, end, ": ") == false)
+		return false;
+
+	_Add(kDiagnosticError, line, colon - line, number, 0, text + 2,
+		end - text - 2);
+	return true;
+}
+
+/*
+ * Cheap checks on the first byte first, most lines are no diagnostic
+ */
+void
+DiagnosticsParser::_ParseLine(const char* line, size_t length)
+{
+	const char* end = line + length;
+	if (end > line && end[-1] == '\r')
+		end--;
+
+	if (fRustPending == true) {
+		fRustPending = false;
+		if (_ParseRustLocation(line, end) == true)
+			return;
+	}
+
+	if (line == end)
+		return;
+
+	switch (line[0]) {
+		case 'e':
+		case 'w':
+			if (_ParseRustHeader(line, end) == true)
+				return;
+			break;
+		case '.':
+		case 'd':
+			if (_ParseJam(line, end) == true)
+				return;
+			break;
+		default:
+			break;
+	}
+
+	if (memchr(line, ':', end - line) == nullptr)
+		return;
+
+	if (_ParseCompiler(line, end) == false)
+		_ParseJam(line, end);
+}
+
+/*
+ * error[E0425]: text, or warning: text. A diagnostic only if the next line
+ * is its location.
+ */
+bool
+DiagnosticsParser::_ParseRustHeader(const char* line, const char* end)
+{
+	const char* text;
+
+	if (starts_with(line, end, "error")) {
+		fRustSeverity = kDiagnosticError;
+		text = line + 5;
+	} else if (starts_with(line, end, "warning")) {
+		fRustSeverity = kDiagnosticWarning;
+		text = line + 7;
+	} else
+		return false;
+
+	if (text < end && *text == '[') {
+		text = static_cast<const char*>(memchr(text, ']', end - text));
+		if (text == nullptr)
+			return false;
+		text++;
+	}
+
+	if (starts_with(text, end, ": ") == false)
+		return false;
+
+	fRustText.SetTo(text + 2, end - text - 2);
+	fRustPending = true;
+	return true;
+}
+
+/*
+ *   --> src/main.rs:2:5
+ */
+bool
+DiagnosticsParser::_ParseRustLocation(const char* line, const char* end)
+{
+	while (line < end && *line == ' ')
+		line++;
+
+	if (starts_with(line, end, "--> ") == false)
+		return false;
+	line += 4;
+
+	// From the end, path may have colons
+	const char* columnColon = end;
+	while (columnColon > line && columnColon[-1] != ':')
+		columnColon--;
+	const char* lineColon = columnColon - 1;
+	while (lineColon > line && lineColon[-1] != ':')
+		lineColon--;
+	if (lineColon <= line + 1)
+		return false;
+
+	const char* text = lineColon;
+	const int32 number = parse_number(text, end);
+	text = columnColon;
+	const int32 column = parse_number(text, end);
+	if (number < 0 || column < 0)
+		return false;
+
+	_Add(fRustSeverity, line, lineColon - 1 - line, number, column,
+		fRustText.String(), fRustText.Length());
+	return true;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef DIAGNOSTICS_PARSER_H
+#define DIAGNOSTICS_PARSER_H
+
+#include <Message.h>
+#include <Messenger.h>
+#include <String.h>
+
+enum {
+	DIAGNOSTICSPARSER_FOUND				= 'Cdfo'
+};
+
+enum {
+	kDiagnosticError = 0,
+	kDiagnosticWarning,
+	// jam action that failed, counted as neither
+	kDiagnosticFailed
+};
+
+/*
+ * Streaming parser of build output, fed on the console thread as it reads.
+ * Recognized are gcc/clang "file:line[:column]: error|warning: text",
+ * rustc/cargo "error[E...]: text" headers with their "--> file:line:column"
+ * line and jam "don't know how to make" and "file: line N: text" ones.
+ * jam "...failed" actions are listed apart, their causes were counted.
+ *
+ * Diagnostics go to the target in batches: repeated "severity", "path"
+ * (absolute, empty if none), "line", "column" and "text", totals so far in
+ * "errors" and "warnings". The last batch has "done" set.
+ */
+class DiagnosticsParser {
+public:
+								DiagnosticsParser(const BMessenger& target,
+									const BString& directory);
+
+			// stream is 1 for stdout, 2 for stderr
+			void				Feed(int32 stream, const char* text,
+									size_t length);
+			// Rest of the output and last batch
+			void				Finish();
+
+			int32				CountErrors() const { return fErrors; }
+			int32				CountWarnings() const { return fWarnings; }
+
+private:
+	struct pending_line {
+		BString					text;
+		// Went over kDiagnosticsMaxLine, rest dropped
+		bool					skip = false;
+	};
+
+			void				_Add(int32 severity, const char* path,
+									size_t pathLength, int32 line, int32 column,
+									const char* text, size_t textLength);
+			void				_Flush(bool done);
+			bool				_ParseCompiler(const char* line,
+									const char* end);
+			bool				_ParseJam(const char* line, const char* end);
+			void				_ParseLine(const char* line, size_t length);
+			bool				_ParseRustHeader(const char* line,
+									const char* end);
+			bool				_ParseRustLocation(const char* line,
+									const char* end);
+
+			BMessenger			fTarget;
+			BString				fDirectory;
+			// Lines split across calls, stdout and stderr
+			pending_line		fPending[2];
+
+			// rustc header waiting for its location line
+			bool				fRustPending;
+			int32				fRustSeverity;
+			BString				fRustText;
+
+			BMessage			fBatch;
+			int32				fBatchCount;
+			int32				fSent;
+			bigtime_t			fLastFlush;
+			int32				fErrors;
+			int32				fWarnings;
+};
+
+#endif // DIAGNOSTICS_PARSER_H
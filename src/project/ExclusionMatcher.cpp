@@ -0,0 +1,562 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ExclusionMatcher.h"
+
+#include <File.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "TextRegex.h"
+
+enum {
+	kGlobByte = 0,
+	// One byte but '/'
+	kGlobAny,
+	kGlobClass,
+	// Loops on bytes but '/'
+	kGlobStar,
+	// Loops on any byte
+	kGlobAll,
+	// "**/" as a pair: any bytes ending with a '/', or none. At the start
+	// or after a '/' the token past the pair may follow, else not.
+	kGlobDirs,
+	kGlobDirsName,
+	kGlobAccept
+};
+
+static const char* kDefaultExtensions[] = { "o", "d" };
+static const char* kDefaultDirectories[] = { "app" };
+static const char* kDefaultPrefixes[] = { "objects." };
+
+// Ignore files above this size are not read
+static constexpr auto kIgnoreFileMaxSize = 1024 * 1024;
+
+static bool
+is_plain(const std::string& pattern)
+{
+	return pattern.find_first_of("*?[\\") == std::string::npos;
+}
+
+static status_t
+read_file(const BString& path, std::string& text)
+{
+	BFile file(path.String(), B_READ_ONLY);
+	off_t size;
+	status_t status;
+
+	if ((status = file.InitCheck()) != B_OK
+		|| (status = file.GetSize(&size)) != B_OK)
+		return status;
+	if (size > kIgnoreFileMaxSize)
+		return B_NO_MEMORY;
+
+	text.resize(size);
+	ssize_t bytes = file.Read(&text[0], size);
+	if (bytes < 0)
+		return bytes;
+	text.resize(bytes);
+
+	return B_OK;
+}
+
+static std::vector<std::string>
+split_lines(const std::string& text)
+{
+	std::vector<std::string> lines;
+	size_t start = 0;
+
+	while (start < text.size()) {
+		size_t end = text.find('\n', start);
+		if (end == std::string::npos)
+			end = text.size();
+		std::string line(text, start, end - start);
+		if (line.empty() == false && line.back() == '\r')
+			line.pop_back();
+		lines.push_back(line);
+		start = end + 1;
+	}
+
+	return lines;
+}
+
+ExclusionMatcher::ExclusionMatcher()
+	:
+	fRulesCount(0)
+	, fPrefixes(256)
+{
+}
+
+ExclusionMatcher::~ExclusionMatcher()
+{
+}
+
+/*
+ * May be called again, rules are built from scratch
+ */
+status_t
+ExclusionMatcher::Load(const BString& root, const BMessage& settings,
+	const BString& projectType)
+{
+	fRoot = root;
+	if (fRoot.EndsWith("/") == false)
+		fRoot << "/";
+
+	fParseless.clear();
+	fExtensions.clear();
+	fIgnoredExtensions.clear();
+	fNames.clear();
+	fDirectories.clear();
+	fPrefixes.assign(256, std::vector<std::string>());
+	fRules.clear();
+	fNameRules = automaton();
+	fPathRules = automaton();
+	fRegex.reset();
+
+	std::vector<std::string> prefixes;
+
+	for (const char* extension : kDefaultExtensions)
+		fExtensions.insert(extension);
+	for (const char* directory : kDefaultDirectories)
+		fDirectories.insert(directory);
+	for (const char* prefix : kDefaultPrefixes)
+		prefixes.push_back(prefix);
+	if (projectType == "cargo")
+		fDirectories.insert("target");
+
+	BString item;
+	for (int32 i = 0; settings.FindString("parseless_item", i, &item) == B_OK; i++)
+		fParseless.insert(item.String());
+	for (int32 i = 0; settings.FindString("parseless_dirs", i, &item) == B_OK; i++)
+		if (item.IsEmpty() == false)
+			fDirectories.insert(item.String());
+	for (int32 i = 0; settings.FindString("parseless_extensions", i, &item) == B_OK; i++) {
+		// "*.ext", ".ext" and "ext" alike
+		while (item.StartsWith("*") || item.StartsWith("."))
+			item.Remove(0, 1);
+		if (item.IsEmpty() == false)
+			fExtensions.insert(item.String());
+	}
+	for (int32 i = 0; settings.FindString("parseless_dirs_startchars", i, &item) == B_OK; i++)
+		if (item.IsEmpty() == false)
+			prefixes.push_back(item.String());
+
+	for (const std::string& prefix : prefixes)
+		fPrefixes[(uint8)prefix[0]].push_back(prefix);
+
+	std::vector<ignore_rule> rules;
+	std::vector<std::string> expressions;
+	_ReadGitIgnore(BString(fRoot) << ".gitignore", rules);
+	_ReadHgIgnore(BString(fRoot) << ".hgignore", rules, expressions);
+	_AddRules(rules);
+
+	// One search for all
+	if (expressions.empty() == false) {
+		std::string regex;
+		for (const std::string& expression : expressions) {
+			if (regex.empty() == false)
+				regex += "|";
+			regex += "(?:" + expression + ")";
+		}
+		fRegex.reset(new TextRegex(regex.data(), regex.size(), true, false));
+		if (fRegex->InitCheck() != B_OK) {
+			fRegex.reset();
+			expressions.clear();
+		}
+	}
+
+	fRulesCount = fExtensions.size() + fIgnoredExtensions.size() + fNames.size() + fDirectories.size()
+		+ prefixes.size() + fRules.size() + expressions.size();
+
+	return B_OK;
+}
+
+int32
+ExclusionMatcher::Match(const BString& path, const char* name,
+	bool directory) const
+{
+	const char* dot = strrchr(name, '.');
+
+	if (directory == true) {
+		if (fDirectories.find(name) != fDirectories.end())
+			return MATCH_EXCLUDED;
+		for (const std::string& prefix : fPrefixes[(uint8)name[0]])
+			if (strncmp(name, prefix.data(), prefix.size()) == 0)
+				return MATCH_EXCLUDED;
+	} else {
+		if (fParseless.empty() == false
+			&& fParseless.find(path.String()) != fParseless.end())
+			return MATCH_PARSELESS;
+		if (dot != nullptr && fExtensions.find(dot + 1) != fExtensions.end())
+			return MATCH_EXCLUDED;
+	}
+
+	if (fNames.find(name) != fNames.end()
+		|| (dot != nullptr && fIgnoredExtensions.empty() == false
+			&& fIgnoredExtensions.find(dot + 1) != fIgnoredExtensions.end()))
+		return MATCH_EXCLUDED;
+
+	const char* relative = path.String();
+	size_t length = path.Length();
+	if (length > (size_t)fRoot.Length()
+		&& strncmp(relative, fRoot.String(), fRoot.Length()) == 0) {
+		relative += fRoot.Length();
+		length -= fRoot.Length();
+	}
+
+	const int32 rule = std::max(_Run(fNameRules, name, strlen(name), directory),
+		_Run(fPathRules, relative, length, directory));
+	if (rule >= 0 && fRules[rule].negated == false)
+		return MATCH_EXCLUDED;
+
+	if (fRegex != nullptr) {
+		// So that "^build/" holds for the directory too
+		std::string subject(relative, length);
+		if (directory == true)
+			subject += '/';
+		TextRegex::match found;
+		if (fRegex->Search(subject.data(), subject.size(), 0, found) == true)
+			return MATCH_EXCLUDED;
+	}
+
+	return MATCH_INCLUDED;
+}
+
+/*
+ * Only rules after the last negated one may go to the hash sets
+ */
+void
+ExclusionMatcher::_AddRules(std::vector<ignore_rule>& rules)
+{
+	int32 lastNegated = -1;
+	for (size_t i = 0; i < rules.size(); i++)
+		if (rules[i].negated == true)
+			lastNegated = i;
+
+	for (int32 i = 0; i < (int32)rules.size(); i++) {
+		const ignore_rule& rule = rules[i];
+		const std::string& pattern = rule.pattern;
+
+		if (i > lastNegated && rule.anchored == false) {
+			if (is_plain(pattern) == true) {
+				if (rule.directoryOnly == true)
+					fDirectories.insert(pattern);
+				else
+					fNames.insert(pattern);
+				continue;
+			}
+			// "*.ext"
+			if (rule.directoryOnly == false && pattern.size() > 2
+				&& pattern.compare(0, 2, "*.") == 0
+				&& pattern.find('.', 2) == std::string::npos
+				&& is_plain(pattern.substr(2)) == true) {
+				fIgnoredExtensions.insert(pattern.substr(2));
+				continue;
+			}
+		}
+
+		fRules.push_back(rule);
+		_Compile(pattern, fRules.size() - 1,
+			rule.anchored == true ? fPathRules : fNameRules);
+	}
+}
+
+/*
+ * Glob to tokens: '*' and '?' do not match '/', "**" does when a whole
+ * path component. Tokens end with an accept one carrying the rule.
+ */
+void
+ExclusionMatcher::_Compile(const std::string& glob, int32 rule, automaton& nfa)
+{
+	std::vector<glob_token>& tokens = nfa.tokens;
+	const size_t size = glob.size();
+
+	nfa.starts.push_back(tokens.size());
+
+	for (size_t i = 0; i < size; i++) {
+		const char c = glob[i];
+		glob_token token = { kGlobByte, (uint8)c, 0, 0 };
+
+		if (c == '\\' && i + 1 < size) {
+			token.byte = glob[++i];
+		} else if (c == '?') {
+			token.type = kGlobAny;
+		} else if (c == '*') {
+			const bool component = i == 0 || glob[i - 1] == '/';
+			bool all = false;
+			while (i + 1 < size && glob[i + 1] == '*') {
+				all = true;
+				i++;
+			}
+			if (all == true && component == true && i + 1 < size
+				&& glob[i + 1] == '/') {
+				// "**/": any directories, the slash included, or none
+				tokens.push_back({ kGlobDirs, 0, 2, 0 });
+				token.type = kGlobDirsName;
+				i++;
+			} else if (all == true && component == true && i + 1 == size) {
+				token.type = kGlobAll;
+				token.skip = 1;
+			} else {
+				token.type = kGlobStar;
+				token.skip = 1;
+			}
+		} else if (c == '[') {
+			size_t end = i + 1;
+			if (end < size && (glob[end] == '!' || glob[end] == '^'))
+				end++;
+			// A leading ']' is a member
+			if (end < size && glob[end] == ']')
+				end++;
+			while (end < size && glob[end] != ']') {
+				if (glob[end] == '\\')
+					end++;
+				end++;
+			}
+
+			if (end < size) {
+				std::vector<uint8> set(256, 0);
+				size_t j = i + 1;
+				const bool negated = glob[j] == '!' || glob[j] == '^';
+				if (negated == true)
+					j++;
+				while (j < end) {
+					if (glob[j] == '\\' && j + 1 < end)
+						j++;
+					uint8 low = glob[j++];
+					uint8 high = low;
+					if (j + 1 < end && glob[j] == '-') {
+						j++;
+						if (glob[j] == '\\' && j + 1 < end)
+							j++;
+						high = glob[j++];
+					}
+					for (int32 b = low; b <= high; b++)
+						set[b] = 1;
+				}
+				if (negated == true)
+					for (uint8& b : set)
+						b = !b;
+				set['/'] = 0;
+
+				token.type = kGlobClass;
+				token.value = nfa.classes.size() / 256;
+				nfa.classes.insert(nfa.classes.end(), set.begin(), set.end());
+				i = end;
+			}
+		}
+
+		tokens.push_back(token);
+	}
+
+	tokens.push_back({ kGlobAccept, 0, 0, rule });
+}
+
+void
+ExclusionMatcher::_ReadGitIgnore(const BString& path,
+	std::vector<ignore_rule>& rules)
+{
+	std::string text;
+	if (read_file(path, text) != B_OK)
+		return;
+
+	for (std::string& line : split_lines(text)) {
+		if (line.empty() == true || line[0] == '#')
+			continue;
+
+		// Trailing spaces, unless escaped
+		while (line.empty() == false && line.back() == ' '
+			&& (line.size() < 2 || line[line.size() - 2] != '\\'))
+			line.pop_back();
+
+		ignore_rule rule = { "", false, false, false };
+		if (line.empty() == false && line[0] == '!') {
+			rule.negated = true;
+			line.erase(0, 1);
+		}
+		while (line.empty() == false && line.back() == '/') {
+			rule.directoryOnly = true;
+			line.pop_back();
+		}
+		if (line.empty() == false && line[0] == '/') {
+			rule.anchored = true;
+			line.erase(0, 1);
+		}
+		// "**/name" is "name"
+		if (rule.anchored == false && line.compare(0, 3, "**/") == 0
+			&& line.find('/', 3) == std::string::npos)
+			line.erase(0, 3);
+		if (line.find('/') != std::string::npos)
+			rule.anchored = true;
+
+		if (line.empty() == true)
+			continue;
+
+		rule.pattern = line;
+		rules.push_back(rule);
+	}
+}
+
+/*
+ * Neither globs nor regular expressions are rooted in .hgignore: globs
+ * with a '/' get a leading "**" and expressions are searched in the path
+ */
+void
+ExclusionMatcher::_ReadHgIgnore(const BString& path,
+	std::vector<ignore_rule>& rules, std::vector<std::string>& expressions)
+{
+	std::string text;
+	if (read_file(path, text) != B_OK)
+		return;
+
+	std::string syntax("regexp");
+
+	for (std::string& line : split_lines(text)) {
+		// Comments, "\#" is a '#'
+		for (size_t hash = 0; (hash = line.find('#', hash)) != std::string::npos;) {
+			if (hash > 0 && line[hash - 1] == '\\') {
+				line.erase(hash - 1, 1);
+				continue;
+			}
+			line.erase(hash);
+		}
+		while (line.empty() == false && isspace((uint8)line.back()))
+			line.pop_back();
+		if (line.empty() == true)
+			continue;
+
+		if (line.compare(0, 7, "syntax:") == 0) {
+			syntax = line.substr(7);
+			syntax.erase(0, syntax.find_first_not_of(" \t"));
+			if (syntax == "re")
+				syntax = "regexp";
+			continue;
+		}
+
+		std::string kind(syntax);
+		const size_t colon = line.find(':');
+		if (colon != std::string::npos) {
+			const std::string prefix(line, 0, colon);
+			if (prefix == "re" || prefix == "relre" || prefix == "regexp") {
+				kind = "regexp";
+				line.erase(0, colon + 1);
+			} else if (prefix == "glob" || prefix == "relglob"
+				|| prefix == "rootglob") {
+				kind = prefix == "rootglob" ? prefix : "glob";
+				line.erase(0, colon + 1);
+			}
+		}
+
+		if (kind == "regexp") {
+			// Bad ones are left out, not the whole file
+			TextRegex check(line.data(), line.size(), true, false);
+			if (check.InitCheck() == B_OK)
+				expressions.push_back(line);
+			continue;
+		}
+
+		ignore_rule rule = { line, false, false, kind == "rootglob" };
+		while (rule.pattern.size() > 1 && rule.pattern.back() == '/')
+			rule.pattern.pop_back();
+		if (rule.anchored == false
+			&& rule.pattern.find('/') != std::string::npos) {
+			rule.pattern.insert(0, "**/");
+			rule.anchored = true;
+		}
+		rules.push_back(rule);
+	}
+}
+
+/*
+ * Positions of all rules advance together one byte at a time, each at
+ * most once per byte. Returns the last rule matching text whole, -1 if
+ * none. Rules for directories only are skipped for files.
+ */
+int32
+ExclusionMatcher::_Run(const automaton& nfa, const char* text, size_t length,
+	bool directory) const
+{
+	if (nfa.starts.empty() == true)
+		return -1;
+
+	// Scratch, Match() runs on scan workers
+	static thread_local std::vector<uint32> marks;
+	static thread_local std::vector<int32> lists[2];
+	static thread_local uint32 generation = 0;
+
+	const std::vector<glob_token>& tokens = nfa.tokens;
+	if (marks.size() < tokens.size() || generation > UINT32_MAX - length - 2) {
+		marks.assign(std::max(marks.size(), tokens.size()), 0);
+		generation = 0;
+	}
+
+	auto add = [&](std::vector<int32>& list, int32 position) {
+		while (marks[position] != generation) {
+			marks[position] = generation;
+			list.push_back(position);
+			if (tokens[position].skip == 0)
+				break;
+			position += tokens[position].skip;
+		}
+	};
+
+	int32 current = 0;
+	lists[current].clear();
+	generation++;
+	for (int32 start : nfa.starts)
+		add(lists[current], start);
+
+	for (size_t i = 0; i < length && lists[current].empty() == false; i++) {
+		const uint8 c = text[i];
+		std::vector<int32>& next = lists[1 - current];
+		next.clear();
+		generation++;
+
+		for (int32 position : lists[current]) {
+			const glob_token& token = tokens[position];
+			switch (token.type) {
+				case kGlobByte:
+					if (c == token.byte)
+						add(next, position + 1);
+					break;
+				case kGlobAny:
+					if (c != '/')
+						add(next, position + 1);
+					break;
+				case kGlobClass:
+					if (nfa.classes[token.value * 256 + c] != 0)
+						add(next, position + 1);
+					break;
+				case kGlobStar:
+					if (c != '/')
+						add(next, position);
+					break;
+				case kGlobAll:
+					add(next, position);
+					break;
+				case kGlobDirs:
+					add(next, c == '/' ? position : position + 1);
+					break;
+				case kGlobDirsName:
+					add(next, c == '/' ? position - 1 : position);
+					break;
+			}
+		}
+
+		current = 1 - current;
+	}
+
+	int32 rule = -1;
+	for (int32 position : lists[current]) {
+		const glob_token& token = tokens[position];
+		if (token.type == kGlobAccept && token.value > rule
+			&& (directory == true || fRules[token.value].directoryOnly == false))
+			rule = token.value;
+	}
+
+	return rule;
+}
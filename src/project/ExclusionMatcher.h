@@ -0,0 +1,112 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef EXCLUSION_MATCHER_H
+#define EXCLUSION_MATCHER_H
+
+#include <Message.h>
+#include <String.h>
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+class TextRegex;
+
+/*
+ * Tells which entries a project scan leaves out. Rules come from the
+ * defaults (objects.* and app directories, .o and .d files, cargo target),
+ * the "parseless_dirs", "parseless_dirs_startchars", "parseless_extensions"
+ * and "parseless_item" settings, and the .gitignore and .hgignore files at
+ * the project root (nested ones are not read).
+ *
+ * Plain names and extensions are looked up in hash sets. Wildcard
+ * patterns are compiled to one NFA over the name and one over the path
+ * relative to the root, run for all rules at once: the last rule matching
+ * wins, as in git. Plain ignore rules after the last '!' one are hashed
+ * too, nothing may override them.
+ *
+ * An excluded directory is meant to be pruned, so rules see an entry only
+ * if its parents were included, as git does. Match() is const and may be
+ * called by several threads at once.
+ */
+class ExclusionMatcher {
+public:
+	enum {
+		MATCH_INCLUDED = 0,
+		MATCH_EXCLUDED,
+		// Listed in "parseless_item"
+		MATCH_PARSELESS
+	};
+
+								ExclusionMatcher();
+								~ExclusionMatcher();
+
+			status_t			Load(const BString& root,
+									const BMessage& settings,
+									const BString& projectType);
+
+			int32				Match(const BString& path, const char* name,
+									bool directory) const;
+
+			int32				CountParselessItems() const
+									{ return fParseless.size(); }
+			int32				CountRules() const { return fRulesCount; }
+
+private:
+	struct glob_token {
+		uint8					type;
+		uint8					byte;
+		// Loops: positions skipped when matching nothing
+		uint8					skip;
+		// Class index or rule of kGlobAccept
+		int32					value;
+	};
+	struct automaton {
+		std::vector<glob_token>	tokens;
+		std::vector<int32>		starts;
+		// 256 entries per class
+		std::vector<uint8>		classes;
+	};
+	struct ignore_rule {
+		std::string				pattern;
+		bool					negated;
+		bool					directoryOnly;
+		// Has a '/': matched against the relative path
+		bool					anchored;
+	};
+
+			void				_AddRules(std::vector<ignore_rule>& rules);
+			void				_Compile(const std::string& glob, int32 rule,
+									automaton& nfa);
+			void				_ReadGitIgnore(const BString& path,
+									std::vector<ignore_rule>& rules);
+			void				_ReadHgIgnore(const BString& path,
+									std::vector<ignore_rule>& rules,
+									std::vector<std::string>& expressions);
+			int32				_Run(const automaton& nfa, const char* text,
+									size_t length, bool directory) const;
+
+			BString				fRoot;
+			int32				fRulesCount;
+
+			std::unordered_set<std::string>	fParseless;
+			// Of files, of any kind ("*.ext" ignore rules)
+			std::unordered_set<std::string>	fExtensions;
+			std::unordered_set<std::string>	fIgnoredExtensions;
+			// Of any kind, only directories
+			std::unordered_set<std::string>	fNames;
+			std::unordered_set<std::string>	fDirectories;
+			// Directory name prefixes, by first byte
+			std::vector<std::vector<std::string>>	fPrefixes;
+
+			std::vector<ignore_rule>	fRules;
+			automaton			fNameRules;
+			automaton			fPathRules;
+			// .hgignore regular expressions, joined
+			std::unique_ptr<TextRegex>	fRegex;
+};
+
+#endif // EXCLUSION_MATCHER_H
@@ -13,6 +13,8 @@
 Project::Project(BString const& name)
 	:
 	fExtensionedName(name)
+	, fLoadedGeneration(-1)
+	, fReleaseMode(false)
 {
 }
 
@@ -31,21 +33,15 @@ Project::Activate()
 BString  const
 Project::BuildCommand()
 {
-	BString command("");
-	TPreferences prefs(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
-	prefs.FindString("project_build_command", &command);
-
-	return command;
+	_Load();
+	return fBuildCommand;
 }
 
 BString const
 Project::CleanCommand()
 {
-	BString command("");
-	TPreferences prefs(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
-	prefs.FindString("project_clean_command", &command);
-
-	return command;
+	_Load();
+	return fCleanCommand;
 }
 
 void
@@ -58,15 +54,7 @@ Project::Deactivate()
 std::vector<BString> const
 Project::FilesList()
 {
-	fFilesList.clear();
-
-	TPreferences prefs(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
-	BString file;
-	int count = 0;
-
-	while (prefs.FindString("project_file", count++, &file) == B_OK)
-		fFilesList.push_back(file);
-
+	_Load();
 	return fFilesList;
 }
 
@@ -76,75 +64,142 @@ Project::Open(bool activate)
 	if (fExtensionedName.IsEmpty())
 		throw std::logic_error("Empty name");
 
-	TPreferences idmproFile(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
-
 	isActive = activate;
 
 	fProjectTitle = new ProjectTitleItem(fExtensionedName.String(), activate);
 
 	// name without extension
-	if (idmproFile.FindString("project_name", &fName) != B_OK)
+	if (_Load() != B_OK || fName.IsEmpty())
 		throw std::logic_error("Empty name");
 
-	if (idmproFile.FindString("project_directory", &fProjectDirectory) != B_OK)
-		fProjectDirectory = "";
-
-	if (idmproFile.FindString("project_type", &fType) != B_OK)
-		fType = "";
-
-	if (idmproFile.FindBool("run_in_terminal", &fRunInTerminal) != B_OK)
-		fRunInTerminal = false;
-
 	return B_OK;
 }
 
 bool
 Project::ReleaseModeEnabled()
 {
-	bool releaseMode = false;
-	TPreferences prefs(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
-	prefs.FindBool("release_mode", &releaseMode);
+	_Load();
+	return fReleaseMode;
+}
+
+BString const
+Project::RunArgs()
+{
+	_Load();
+	return fRunArgs;
+}
 
-	return releaseMode;
+bool
+Project::RunInTerminal()
+{
+	_Load();
+	return fRunInTerminal;
 }
 
 BString const
 Project::Scm()
 {
-	BString	scm("");
-	TPreferences prefs(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
-	prefs.FindString("project_scm", &scm);
-
-	return scm;
+	_Load();
+	return fScm;
 }
 
 void
 Project::SetReleaseMode(bool releaseMode)
 {
-	TPreferences prefs(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
-	prefs.SetBool("release_mode", releaseMode);
+	_Load();
+	if (releaseMode == fReleaseMode)
+		return;
+
+	fReleaseMode = releaseMode;
+	fChanges.RemoveName("release_mode");
+	fChanges.AddBool("release_mode", releaseMode);
+	_Save();
 }
 
 std::vector<BString> const
 Project::SourcesList()
 {
-	fSourcesList.clear();
-	TPreferences prefs(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
-	BString file;
-	int count = 0;
-
-	while (prefs.FindString("project_source", count++, &file) == B_OK)
-		fSourcesList.push_back(file);
-
+	_Load();
 	return fSourcesList;
 }
 
 BString const
 Project::Target()
 {
-	BString target("");
+	_Load();
+	return fTarget;
+}
+
+/*
+ * Read from the TPreferences cache, only if its generation moved
+ */
+status_t
+Project::_Load()
+{
+	const int64 generation = TPreferences::Generation(fExtensionedName,
+		IdeamNames::kApplicationName);
+	if (generation < 0)
+		return B_ENTRY_NOT_FOUND;
+	if (generation == fLoadedGeneration)
+		return B_OK;
+
+	TPreferences settings(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
+	settings.Discard();
+	status_t status;
+	if ((status = settings.InitCheck()) != B_OK)
+		return status;
+
+	fName = settings.GetString("project_name", "");
+	fProjectDirectory = settings.GetString("project_directory", "");
+	fType = settings.GetString("project_type", "");
+	fRunInTerminal = settings.GetBool("run_in_terminal", false);
+
+	fBuildCommand = settings.GetString("project_build_command", "");
+	fCleanCommand = settings.GetString("project_clean_command", "");
+	fScm = settings.GetString("project_scm", "");
+	fTarget = settings.GetString("project_target", "");
+	fRunArgs = settings.GetString("project_run_args", "");
+	fReleaseMode = settings.GetBool("release_mode", false);
+
+	BString item;
+	fFilesList.clear();
+	for (int32 i = 0; settings.FindString("project_file", i, &item) == B_OK; i++)
+		fFilesList.push_back(item);
+	fSourcesList.clear();
+	for (int32 i = 0; settings.FindString("project_source", i, &item) == B_OK; i++)
+		fSourcesList.push_back(item);
+
+	// Taken before reading: a write meanwhile gets read next time
+	fLoadedGeneration = generation;
+
+	return B_OK;
+}
+
+/*
+ * Changed fields only are set on the file as it is now, other writers'
+ * fields are kept
+ */
+status_t
+Project::_Save()
+{
+	if (fChanges.IsEmpty())
+		return B_OK;
+
 	TPreferences prefs(fExtensionedName, IdeamNames::kApplicationName, 'LOPR');
-	prefs.FindString("project_target", &target);
 
-	return target;
+	char* name;
+	type_code type;
+	int32 count;
+	for (int32 i = 0; fChanges.GetInfo(B_ANY_TYPE, i, &name, &type, &count) == B_OK; i++) {
+		prefs.RemoveName(name);
+		for (int32 j = 0; j < count; j++) {
+			const void* data;
+			ssize_t size;
+			if (fChanges.FindData(name, type, j, &data, &size) == B_OK)
+				prefs.AddData(name, type, data, size);
+		}
+	}
+	fChanges.MakeEmpty();
+
+	return B_OK;
 }
@@ -5,12 +5,19 @@
 #ifndef PROJECT_H
 #define PROJECT_H
 
+#include <Message.h>
 #include <String.h>
 #include <vector>
 
 #include "ProjectTitleItem.h"
 #include "TPreferences.h"
 
+/*
+ * The .idmpro settings are read once into memory and read again only when
+ * their TPreferences generation changed, as the parser and the settings
+ * window write to them too. Setters write back only the fields they
+ * changed, and only if the value did change.
+ */
 class Project {
 public:
 								Project(BString const& name);
@@ -27,7 +34,8 @@ public:
 			BString	const		Name() const { return fName; }
 			status_t			Open(bool activate);
 			bool 				ReleaseModeEnabled();
-			bool				RunInTerminal() { return fRunInTerminal; }
+			BString	const		RunArgs();
+			bool				RunInTerminal();
 			BString	const		Scm();
 			void				SetReleaseMode(bool releaseMode);
 	std::vector<BString> const	SourcesList();
@@ -36,6 +44,8 @@ public:
 			BString				Type() const { return fType; }
 
 private:
+			status_t			_Load();
+			status_t			_Save();
 
 private:
 			BString				fName;
@@ -48,6 +58,18 @@ private:
 		std::vector<BString>	fFilesList;
 		std::vector<BString>	fSourcesList;
 
+			// TPreferences::Generation() when loaded
+			int64				fLoadedGeneration;
+
+			BString				fBuildCommand;
+			BString				fCleanCommand;
+			BString				fScm;
+			BString				fTarget;
+			BString				fRunArgs;
+			bool				fReleaseMode;
+			// Changed fields not yet written
+			BMessage			fChanges;
+
 };
 
 
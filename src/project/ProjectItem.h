@@ -0,0 +1,45 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef PROJECT_ITEM_H
+#define PROJECT_ITEM_H
+
+#include <OutlineListView.h>
+
+#include "ProjectTree.h"
+
+/*
+ * Outline item of a project directory or file, shows its name and
+ * tells its full path. Made and deleted by ProjectOutlineView only.
+ */
+class ProjectItem : public BStringItem {
+public:
+	ProjectItem(ProjectTree::node* node, uint32 level)
+		:
+		BStringItem(node->name, level, false)
+		, fNode(node)
+	{
+		fNode->item = this;
+	}
+
+	ProjectTree::node* Node() const
+	{
+		return fNode;
+	}
+
+	const BString& Path() const
+	{
+		return fNode->path;
+	}
+
+	bool IsDirectory() const
+	{
+		return fNode->directory;
+	}
+
+private:
+	ProjectTree::node* fNode;
+};
+
+#endif // PROJECT_ITEM_H
@@ -0,0 +1,481 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ProjectOutlineView.h"
+
+#include <Messenger.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "ProjectItem.h"
+
+// Full window port, retried until the builder is waited for
+static constexpr auto kOutlineSendTimeout = 50000;
+
+struct ProjectOutlineView::tree_build {
+	BMessenger				target;
+	BString					basePath;
+	BString					sourcesTitle;
+	BString					filesTitle;
+	std::vector<BString>	sources;
+	std::vector<BString>	files;
+	std::unique_ptr<ProjectTree>	sourcesTree;
+	std::unique_ptr<ProjectTree>	filesTree;
+	// Joined by the window, which may then not read its port
+	std::atomic<bool>		waited{false};
+
+	void Build()
+	{
+		sourcesTree.reset(new ProjectTree(sourcesTitle, basePath));
+		sourcesTree->Build(sources);
+		std::vector<BString>().swap(sources);
+
+		filesTree.reset(new ProjectTree(filesTitle, basePath));
+		filesTree->Build(files);
+		std::vector<BString>().swap(files);
+	}
+};
+
+static ProjectTree::node*
+root_of(ProjectTree::node* node)
+{
+	while (node->parent != nullptr)
+		node = node->parent;
+	return node;
+}
+
+ProjectOutlineView::ProjectOutlineView(const char* name,
+	const BString& sourcesTitle, const BString& filesTitle)
+	:
+	BOutlineListView(name, B_SINGLE_SELECTION_LIST)
+	, fSourcesTitle(sourcesTitle)
+	, fFilesTitle(filesTitle)
+{
+}
+
+ProjectOutlineView::~ProjectOutlineView()
+{
+	while (fProjects.empty() == false)
+		RemoveProject(fProjects.begin()->first);
+}
+
+void
+ProjectOutlineView::MessageReceived(BMessage* message)
+{
+	switch (message->what) {
+		case PROJECT_OUTLINE_BUILT: {
+			const thread_id builder = message->GetInt32("builder", -1);
+			for (auto& project : fProjects) {
+				if (project.second.builder == builder) {
+					_SwapTrees(project.first, project.second);
+					break;
+				}
+			}
+			break;
+		}
+		default:
+			BOutlineListView::MessageReceived(message);
+			break;
+	}
+}
+
+void
+ProjectOutlineView::Expand(BListItem* item)
+{
+	ProjectItem* projectItem = dynamic_cast<ProjectItem*>(item);
+	if (projectItem != nullptr && projectItem->IsDirectory() == true
+		&& projectItem->Node()->materialized == false)
+		_Materialize(projectItem->Node());
+
+	BOutlineListView::Expand(item);
+}
+
+void
+ProjectOutlineView::Collapse(BListItem* item)
+{
+	BOutlineListView::Collapse(item);
+
+	ProjectItem* projectItem = dynamic_cast<ProjectItem*>(item);
+	if (projectItem != nullptr && projectItem->IsDirectory() == true
+		&& projectItem->Node()->materialized == true)
+		_Dematerialize(projectItem->Node());
+}
+
+/*
+ * A build still running is waited for and dropped, changes patched
+ * meanwhile are in the lists already
+ */
+void
+ProjectOutlineView::SetProject(BListItem* title, const BString& basePath,
+	const std::vector<BString>& sources, const std::vector<BString>& files)
+{
+	if (FullListHasItem(title) == false)
+		AddItem(title);
+
+	project_trees& trees = fProjects[title];
+	_WaitBuilder(trees);
+	trees.patches.clear();
+
+	trees.build.reset(new tree_build{ BMessenger(this), basePath,
+		fSourcesTitle, fFilesTitle, sources, files, nullptr, nullptr });
+
+	trees.builder = spawn_thread(_BuildEntry, "project outline",
+		B_NORMAL_PRIORITY, trees.build.get());
+	if (trees.builder < 0) {
+		trees.build->Build();
+		_SwapTrees(title, trees);
+		return;
+	}
+
+	resume_thread(trees.builder);
+}
+
+void
+ProjectOutlineView::RemoveProject(BListItem* title)
+{
+	auto project = fProjects.find(title);
+	if (project != fProjects.end()) {
+		project_trees& trees = project->second;
+		_WaitBuilder(trees);
+
+		for (ProjectTree* tree : { trees.sources.get(), trees.files.get() })
+			if (tree != nullptr && tree->Root()->item != nullptr)
+				_DeleteItem(tree->Root()->item);
+
+		fProjects.erase(project);
+	}
+
+	RemoveItem(title);
+}
+
+void
+ProjectOutlineView::PatchProject(BListItem* title,
+	const std::vector<BString>& removedSources,
+	const std::vector<BString>& addedSources,
+	const std::vector<BString>& removedFiles,
+	const std::vector<BString>& addedFiles)
+{
+	auto project = fProjects.find(title);
+	if (project == fProjects.end())
+		return;
+
+	project_trees& trees = project->second;
+
+	if (trees.builder >= 0) {
+		for (const BString& path : removedSources)
+			trees.patches.push_back({ true, false, path });
+		for (const BString& path : addedSources)
+			trees.patches.push_back({ true, true, path });
+		for (const BString& path : removedFiles)
+			trees.patches.push_back({ false, false, path });
+		for (const BString& path : addedFiles)
+			trees.patches.push_back({ false, true, path });
+	}
+
+	if (trees.sources != nullptr)
+		_Patch(trees.sources.get(), removedSources, addedSources);
+	if (trees.files != nullptr)
+		_Patch(trees.files.get(), removedFiles, addedFiles);
+}
+
+void
+ProjectOutlineView::RemoveFileItem(BListItem* item)
+{
+	ProjectItem* projectItem = dynamic_cast<ProjectItem*>(item);
+	if (projectItem == nullptr || projectItem->IsDirectory() == true)
+		return;
+
+	ProjectTree::node* root = root_of(projectItem->Node());
+	const BString path(projectItem->Path());
+
+	for (auto& project : fProjects) {
+		project_trees& trees = project.second;
+		for (ProjectTree* tree : { trees.sources.get(), trees.files.get() }) {
+			if (tree == nullptr || tree->Root() != root)
+				continue;
+			if (trees.builder >= 0)
+				trees.patches.push_back({ tree == trees.sources.get(), false, path });
+			_Patch(tree, { path }, {});
+			return;
+		}
+	}
+}
+
+bool
+ProjectOutlineView::FileItemList(BListItem* item, bool& source)
+{
+	ProjectItem* projectItem = dynamic_cast<ProjectItem*>(item);
+	if (projectItem == nullptr || projectItem->IsDirectory() == true)
+		return false;
+
+	ProjectTree::node* root = root_of(projectItem->Node());
+
+	for (auto& project : fProjects) {
+		project_trees& trees = project.second;
+		if (trees.sources != nullptr && trees.sources->Root() == root) {
+			source = true;
+			return true;
+		}
+		if (trees.files != nullptr && trees.files->Root() == root) {
+			source = false;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* static */
+status_t
+ProjectOutlineView::_BuildEntry(void* data)
+{
+	tree_build* build = static_cast<tree_build*>(data);
+	build->Build();
+
+	BMessage message(PROJECT_OUTLINE_BUILT);
+	message.AddInt32("builder", find_thread(NULL));
+
+	// Dropped once waited for, stale builders are not swapped in anyway
+	status_t status;
+	do {
+		status = build->target.SendMessage(&message, (BHandler*)nullptr,
+			kOutlineSendTimeout);
+	} while ((status == B_TIMED_OUT || status == B_WOULD_BLOCK)
+		&& build->waited == false);
+
+	return B_OK;
+}
+
+/*
+ * Returns the index after the item, and after the placeholder of a
+ * directory not empty
+ */
+int32
+ProjectOutlineView::_AddNodeItem(ProjectTree::node* node, uint32 level,
+	int32 index)
+{
+	AddItem(new ProjectItem(node, level), index++);
+	if (node->directory == true && node->children.empty() == false)
+		AddItem(new BStringItem("", level + 1), index++);
+
+	return index;
+}
+
+/*
+ * Item and all beneath are removed deepest first, so no one goes with
+ * subitems whatever the list does with them, then deleted
+ */
+void
+ProjectOutlineView::_DeleteItem(BListItem* item)
+{
+	const int32 index = FullListIndexOf(item);
+	if (index < 0)
+		return;
+
+	for (int32 last = index + CountItemsUnder(item, false); last >= index; last--) {
+		BListItem* gone = RemoveItem(last);
+
+		ProjectItem* projectItem = dynamic_cast<ProjectItem*>(gone);
+		if (projectItem != nullptr) {
+			projectItem->Node()->item = nullptr;
+			projectItem->Node()->materialized = false;
+		}
+		delete gone;
+	}
+}
+
+void
+ProjectOutlineView::_Dematerialize(ProjectTree::node* directory)
+{
+	BListItem* item = directory->item;
+	const int32 index = FullListIndexOf(item) + 1;
+	const uint32 level = item->OutlineLevel() + 1;
+	BListItem* child;
+
+	while ((child = FullListItemAt(index)) != nullptr
+		&& child->OutlineLevel() >= level)
+		_DeleteItem(child);
+
+	directory->materialized = false;
+
+	if (directory->children.empty() == false)
+		AddItem(new BStringItem("", level), index);
+}
+
+void
+ProjectOutlineView::_Materialize(ProjectTree::node* directory)
+{
+	BListItem* item = directory->item;
+	int32 index = FullListIndexOf(item) + 1;
+	const uint32 level = item->OutlineLevel() + 1;
+
+	BListItem* placeholder = FullListItemAt(index);
+	if (placeholder != nullptr && placeholder->OutlineLevel() == level
+		&& dynamic_cast<ProjectItem*>(placeholder) == nullptr)
+		_DeleteItem(placeholder);
+
+	// Parent collapsed yet: not shown one by one
+	for (auto& child : directory->children)
+		index = _AddNodeItem(child.get(), level, index);
+
+	directory->materialized = true;
+}
+
+/*
+ * Items are made or deleted only where the parent directory has them
+ */
+void
+ProjectOutlineView::_Patch(ProjectTree* tree,
+	const std::vector<BString>& removed, const std::vector<BString>& added)
+{
+	for (const BString& path : removed) {
+		ProjectTree::node* gone = tree->Remove(path);
+		if (gone == nullptr)
+			continue;
+
+		ProjectTree::node* parent = gone->parent;
+		if (gone->item != nullptr)
+			_DeleteItem(gone->item);
+		tree->Erase(gone);
+
+		// Root left empty, no latch
+		if (parent->children.empty() == true && parent->item != nullptr
+			&& parent->materialized == false) {
+			BListItem* placeholder = FullListItemAt(
+				FullListIndexOf(parent->item) + 1);
+			if (placeholder != nullptr
+				&& placeholder->OutlineLevel() > parent->item->OutlineLevel())
+				_DeleteItem(placeholder);
+		}
+	}
+
+	for (const BString& path : added) {
+		ProjectTree::node* top = tree->Add(path);
+		if (top == nullptr)
+			continue;
+
+		ProjectTree::node* parent = top->parent;
+		if (parent->item == nullptr)
+			continue;
+
+		const uint32 level = parent->item->OutlineLevel() + 1;
+		const int32 parentIndex = FullListIndexOf(parent->item);
+
+		if (parent->materialized == false) {
+			if (parent->children.size() == 1)
+				AddItem(new BStringItem("", level), parentIndex + 1);
+			continue;
+		}
+
+		// Before the next sibling, or after all under the parent
+		auto& siblings = parent->children;
+		auto next = std::find_if(siblings.begin(), siblings.end(),
+			[top](const std::unique_ptr<ProjectTree::node>& sibling) {
+				return sibling.get() == top;
+			}) + 1;
+
+		const int32 index = next != siblings.end()
+			? FullListIndexOf((*next)->item)
+			: parentIndex + 1 + CountItemsUnder(parent->item, false);
+		_AddNodeItem(top, level, index);
+	}
+}
+
+/*
+ * Changes made while building are done again on the new trees, then
+ * items are made for what was expanded and selected
+ */
+void
+ProjectOutlineView::_SwapTrees(BListItem* title, project_trees& trees)
+{
+	status_t result;
+	wait_for_thread(trees.builder, &result);
+	trees.builder = -1;
+
+	std::unique_ptr<tree_build> build(std::move(trees.build));
+	for (const tree_patch& patch : trees.patches) {
+		ProjectTree* tree = patch.source == true
+			? build->sourcesTree.get() : build->filesTree.get();
+		if (patch.added == true)
+			tree->Add(patch.path);
+		else if (ProjectTree::node* gone = tree->Remove(patch.path))
+			tree->Erase(gone);
+	}
+	trees.patches.clear();
+
+	ProjectItem* selection = dynamic_cast<ProjectItem*>(ItemAt(CurrentSelection()));
+	std::unique_ptr<ProjectTree>* slots[2] = { &trees.sources, &trees.files };
+	std::unique_ptr<ProjectTree>* built[2] = { &build->sourcesTree,
+		&build->filesTree };
+	std::vector<BString> expanded[2];
+	BString selected;
+	int32 selectedTree = -1;
+
+	for (int32 i = 0; i < 2; i++) {
+		ProjectTree* tree = slots[i]->get();
+		if (tree == nullptr)
+			continue;
+
+		// Parents first
+		std::vector<ProjectTree::node*> pending(1, tree->Root());
+		while (pending.empty() == false) {
+			ProjectTree::node* node = pending.back();
+			pending.pop_back();
+			if (node->materialized == false)
+				continue;
+			expanded[i].push_back(node->path);
+			for (auto child = node->children.rbegin();
+					child != node->children.rend(); child++)
+				if ((*child)->directory == true)
+					pending.push_back(child->get());
+		}
+
+		if (selection != nullptr && root_of(selection->Node()) == tree->Root()) {
+			selected = selection->Path();
+			selectedTree = i;
+			selection = nullptr;
+		}
+
+		if (tree->Root()->item != nullptr)
+			_DeleteItem(tree->Root()->item);
+	}
+
+	const uint32 level = title->OutlineLevel() + 1;
+	int32 index = FullListIndexOf(title) + 1;
+
+	for (int32 i = 0; i < 2; i++) {
+		*slots[i] = std::move(*built[i]);
+		index = _AddNodeItem((*slots[i])->Root(), level, index);
+	}
+
+	for (int32 i = 0; i < 2; i++) {
+		for (const BString& path : expanded[i]) {
+			ProjectTree::node* node = (*slots[i])->Find(path);
+			if (node != nullptr && node->directory == true && node->item != nullptr)
+				Expand(node->item);
+		}
+	}
+
+	if (selectedTree >= 0) {
+		ProjectTree::node* node = (*slots[selectedTree])->Find(selected);
+		if (node != nullptr && node->item != nullptr)
+			Select(IndexOf(node->item));
+	}
+}
+
+void
+ProjectOutlineView::_WaitBuilder(project_trees& trees)
+{
+	if (trees.builder < 0)
+		return;
+
+	trees.build->waited = true;
+
+	status_t result;
+	wait_for_thread(trees.builder, &result);
+	trees.builder = -1;
+	trees.build.reset();
+}
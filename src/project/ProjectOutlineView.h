@@ -0,0 +1,93 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef PROJECT_OUTLINE_VIEW_H
+#define PROJECT_OUTLINE_VIEW_H
+
+#include <OutlineListView.h>
+#include <String.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "ProjectTree.h"
+
+enum {
+	PROJECT_OUTLINE_BUILT		= 'Pobt'
+};
+
+/*
+ * Projects outline: under each project title a sources and a files
+ * heading, then directories and files as ProjectTree has them.
+ *
+ * Items are made when their directory is expanded and deleted when it is
+ * collapsed, a collapsed directory holds a placeholder item only for its
+ * latch to show. Trees are built on a thread of their own and swapped in
+ * when done, expanded directories and selection are kept by path.
+ */
+class ProjectOutlineView : public BOutlineListView {
+public:
+								ProjectOutlineView(const char* name,
+									const BString& sourcesTitle,
+									const BString& filesTitle);
+	virtual						~ProjectOutlineView();
+
+	virtual	void				MessageReceived(BMessage* message);
+	virtual	void				Expand(BListItem* item);
+	virtual	void				Collapse(BListItem* item);
+
+			// Adds the project title or builds its trees again
+			void				SetProject(BListItem* title,
+									const BString& basePath,
+									const std::vector<BString>& sources,
+									const std::vector<BString>& files);
+			void				RemoveProject(BListItem* title);
+			void				PatchProject(BListItem* title,
+									const std::vector<BString>& removedSources,
+									const std::vector<BString>& addedSources,
+									const std::vector<BString>& removedFiles,
+									const std::vector<BString>& addedFiles);
+			// File item deleted, its tree node too
+			void				RemoveFileItem(BListItem* item);
+			// Whether a file item is under a sources or a files heading,
+			// false if it is no file item
+			bool				FileItemList(BListItem* item, bool& source);
+
+private:
+	struct tree_build;
+	struct tree_patch {
+		bool					source;
+		bool					added;
+		BString					path;
+	};
+	struct project_trees {
+		std::unique_ptr<ProjectTree>	sources;
+		std::unique_ptr<ProjectTree>	files;
+		thread_id				builder = -1;
+		std::unique_ptr<tree_build>	build;
+		// Made while building, done again on the new trees
+		std::vector<tree_patch>	patches;
+	};
+
+	static	status_t			_BuildEntry(void* data);
+
+			int32				_AddNodeItem(ProjectTree::node* node,
+									uint32 level, int32 index);
+			void				_DeleteItem(BListItem* item);
+			void				_Dematerialize(ProjectTree::node* directory);
+			void				_Materialize(ProjectTree::node* directory);
+			void				_Patch(ProjectTree* tree,
+									const std::vector<BString>& removed,
+									const std::vector<BString>& added);
+			void				_SwapTrees(BListItem* title,
+									project_trees& trees);
+			void				_WaitBuilder(project_trees& trees);
+
+			BString				fSourcesTitle;
+			BString				fFilesTitle;
+			std::map<BListItem*, project_trees>	fProjects;
+};
+
+#endif // PROJECT_OUTLINE_VIEW_H
@@ -9,24 +9,73 @@
 #include <Catalog.h>
 #include <Directory.h>
 #include <Entry.h>
+#include <Path.h>
 #include <Window.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
 #include <iostream>
+#include <mutex>
+#include <sys/stat.h>
 
-#include "IdeamCommon.h"
+#include "IdeamNamespace.h"
+#include "TrigramIndex.h"
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "ProjectParser"
 
-const std::vector<std::string> ProjectParser :: source_extensions =
-{ "s", "S", "awk", "c", "cpp", "cxx", "c++", "h", "rs" };
+// Directory workers are capped, scanning is mostly file system bound
+static constexpr auto kProjectScanMaxWorkers = 8;
+// Scans lasting longer report progress at this interval
+static constexpr auto kProjectScanProgressTime = 1000000;
+static constexpr auto kProjectScanPollTime = 5000;
+// Wait of a worker finding all queues empty while others still scan
+static constexpr auto kProjectScanIdleTime = 1000;
+static constexpr auto kProjectScanDirentsSize = 8192;
+// Directories modified this close to their last read are read again
+// whatever their modification time, file systems may store seconds only
+static constexpr auto kProjectScanTimeGrain = 2000000;
+// Full target port, retried until the scan is waited for
+static constexpr auto kProjectScanSendTimeout = 50000;
+
+struct ProjectParser::scan_worker {
+	ProjectParser*			parser;
+	int32					index;
+	std::mutex				lock;
+	// Directories and their depth
+	std::deque<std::pair<BString, int32>>	queue;
+	std::vector<std::pair<node_ref, dir_snapshot>>	directories;
+};
 
-const std::vector<std::string> ProjectParser :: excluded_extensions =
-{ "o", "d"};
+struct async_scan {
+	ProjectParser*			parser;
+	BString					projectName;
+	BString					directory;
+	BMessenger				target;
+};
+
+static bigtime_t
+to_bigtime(const timespec& time)
+{
+	return (bigtime_t)time.tv_sec * 1000000 + time.tv_nsec / 1000;
+}
+
+const std::unordered_set<std::string> ProjectParser :: source_extensions =
+{ "s", "S", "awk", "c", "cpp", "cxx", "c++", "h", "rs" };
 
 
 ProjectParser::ProjectParser(TPreferences* prefs)
 	:
 	fPreferences(prefs)
+	, fNamed(false)
+	, fAsyncWaited(false)
+	, fPending(0)
+	, fEntries(0)
+	, fExcluded(0)
+	, fPruned(0)
+	, fRuleTime(0)
 {
 	if (fPreferences == nullptr)
 		throw;
@@ -35,30 +84,106 @@ ProjectParser::ProjectParser(TPreferences* prefs)
 	fPreferences->FindString("project_type", &fProjectType);
 }
 
+ProjectParser::ProjectParser(const BString& projectName)
+	:
+	fPreferences(nullptr)
+	, fNamed(true)
+	, fAsyncWaited(false)
+	, fProjectFullName(projectName)
+	, fPending(0)
+	, fEntries(0)
+	, fExcluded(0)
+	, fPruned(0)
+	, fRuleTime(0)
+{
+	TPreferences prefs(fProjectFullName, IdeamNames::kApplicationName, 'LOPR');
+	prefs.FindString("project_type", &fProjectType);
+}
+
 ProjectParser::~ProjectParser()
 {
+	StopWatching();
 }
 
+/*
+ * Preferences are read for the rules, then opened again only to store the
+ * lists: settings changed while scanning are kept
+ */
 status_t
 ProjectParser::ParseProjectFiles(BString directory)
 {
 	if (directory.IsEmpty())
 		throw;
 
-	fPreferences->RemoveName("project_file");
-	fPreferences->RemoveName("project_source");
-	fPreferences->RemoveName("project_scm");
+	// Paths are built by appending names, start from a normalized one
+	BPath root(directory.String());
+	fRoot = root.Path() != nullptr ? root.Path() : directory.String();
+
+	const bigtime_t start = system_time();
 
-	fSourcesCount = 0;
-	fFilesCount = 0;
 	parseless_found.clear();
-	fParselessIn = _GetParselessItems();
+	fParselessIn = _LoadExclusions();
+
+	system_info info;
+	int32 count = 1;
+	if (get_system_info(&info) == B_OK)
+		count = std::max<int32>(1, std::min<int32>(info.cpu_count,
+			kProjectScanMaxWorkers));
+
+	_ScanTrees({ std::make_pair(fRoot, 0) }, count);
+
+	// Merge and commit once
+	std::vector<BString> sources;
+	std::vector<BString> files;
+	fSnapshot.clear();
+	for (auto& worker : fWorkers) {
+		for (auto& record : worker->directories) {
+			const dir_snapshot& snapshot = record.second;
+			sources.insert(sources.end(), snapshot.sources.begin(),
+				snapshot.sources.end());
+			files.insert(files.end(), snapshot.files.begin(),
+				snapshot.files.end());
+			parseless_found.insert(parseless_found.end(),
+				snapshot.parseless.begin(), snapshot.parseless.end());
+			fSnapshot[record.first] = std::move(record.second);
+		}
+	}
+	fWorkers.clear();
 
-	// Mind: recursive function
-	_ScanDirectory(directory);
+	// Workers order is random
+	std::sort(sources.begin(), sources.end());
+	std::sort(files.begin(), files.end());
 
+	_OpenPreferences();
+	fPreferences->RemoveName("project_file");
+	fPreferences->RemoveName("project_source");
+
+	_SetScm();
+	for (const BString& file : files)
+		fPreferences->AddString("project_file", file);
+	for (const BString& source : sources)
+		fPreferences->AddString("project_source", source);
+
+	fSourcesCount = sources.size();
+	fFilesCount = files.size();
 	fParselessOut = _SetParselessItems();
 
+	_ClosePreferences();
+
+	const bigtime_t elapsed = std::max<bigtime_t>(1, system_time() - start);
+	const int64 entries = fEntries;
+	const int64 excluded = fExcluded;
+	const int64 pruned = fPruned;
+	const int64 ruleTime = fRuleTime;
+
+	// Bring the search index up to date, unchanged files are not read
+	files.insert(files.end(), sources.begin(), sources.end());
+
+	TrigramIndex index(fProjectFullName);
+	TrigramIndex::update_stats stats;
+	index.Load();
+	status_t indexStatus = index.Update(files, stats);
+
 	BString notification;
 	notification
 		<< B_TRANSLATE("Project scan") << ":  " << fProjectFullName
@@ -66,103 +191,526 @@ ProjectParser::ParseProjectFiles(BString directory)
 		<< "; F = " << fFilesCount
 		<< "; Pi = " << fParselessIn
 		<< "; Po = " << fParselessOut
+		<< "; E = " << entries
+		<< " (" << entries * 1000000 / elapsed << "/s) "
+		<< elapsed / 1000 << " ms"
+		<< "; X = " << excluded << " (" << pruned << " " << B_TRANSLATE("dirs")
+		<< ") " << B_TRANSLATE("rules") << " = " << fExclusions.CountRules()
+		<< " " << ruleTime << " us"
 		;
-	BMessage message('NOTI');
-	message.AddString("notification", notification);
-	message.AddString("type", "PROJ_SCAN");
-	be_app->WindowAt(0)->PostMessage(&message);
+	if (indexStatus == B_OK)
+		notification
+			<< "; " << B_TRANSLATE("Index") << " = " << stats.files
+			<< " (" << stats.reindexed << " " << B_TRANSLATE("read") << ") "
+			<< stats.size / 1024 << " KiB "
+			<< stats.elapsed / 1000 << " ms"
+			;
+	_SendNotification(notification);
+
+	return B_OK;
+}
+
+thread_id
+ProjectParser::ParseProjectFilesAsync(const BString& directory,
+	const BMessenger& target)
+{
+	async_scan* scan = new async_scan{ this, fProjectFullName, directory, target };
+	fAsyncWaited = false;
+
+	thread_id thread = spawn_thread(_AsyncEntry, "project parser",
+		B_LOW_PRIORITY, scan);
+	if (thread < 0) {
+		delete scan;
+		return thread;
+	}
+
+	resume_thread(thread);
+	return thread;
+}
+
+/*
+ * Directories are read again only if changed since their snapshot: new
+ * subdirectories are scanned, gone ones dropped with all beneath. A
+ * directory moved or renamed is dropped and found again as new.
+ */
+status_t
+ProjectParser::RescanDirectories(const std::set<node_ref>& directories,
+	scan_changes& changes)
+{
+	const bigtime_t start = system_time();
+
+	_LoadExclusions();
+
+	std::vector<std::pair<BString, int32>> roots;
+
+	for (const node_ref& nref : directories) {
+		auto it = fSnapshot.find(nref);
+		if (it == fSnapshot.end())
+			continue;
+
+		dir_snapshot& snapshot = it->second;
+		BDirectory dir(snapshot.path.String());
+		struct stat st;
+
+		if (dir.InitCheck() != B_OK || dir.GetStat(&st) != B_OK
+			|| node_ref(st.st_dev, st.st_ino) != nref) {
+			_DropDirectory(nref, changes);
+			continue;
+		}
+
+		if (to_bigtime(st.st_mtim) == snapshot.mtime
+			&& snapshot.scanned - snapshot.mtime > kProjectScanTimeGrain)
+			continue;
+
+		scan_worker worker;
+		_ScanDirectory(snapshot.path, snapshot.depth, worker);
+		// Subdirectories were queued: only new ones are scanned
+		fPending = 0;
+		changes.directories++;
+
+		if (worker.directories.empty()) {
+			_DropDirectory(nref, changes);
+			continue;
+		}
+
+		dir_snapshot& current = worker.directories.front().second;
+
+		std::set_difference(snapshot.sources.begin(), snapshot.sources.end(),
+			current.sources.begin(), current.sources.end(),
+			std::back_inserter(changes.removedSources));
+		std::set_difference(current.sources.begin(), current.sources.end(),
+			snapshot.sources.begin(), snapshot.sources.end(),
+			std::back_inserter(changes.addedSources));
+		std::set_difference(snapshot.files.begin(), snapshot.files.end(),
+			current.files.begin(), current.files.end(),
+			std::back_inserter(changes.removedFiles));
+		std::set_difference(current.files.begin(), current.files.end(),
+			snapshot.files.begin(), snapshot.files.end(),
+			std::back_inserter(changes.addedFiles));
+
+		for (const auto& subdir : snapshot.subdirs)
+			if (std::find(current.subdirs.begin(), current.subdirs.end(),
+					subdir) == current.subdirs.end())
+				_DropDirectory(subdir.first, changes);
+
+		for (const auto& subdir : current.subdirs)
+			if (std::find(snapshot.subdirs.begin(), snapshot.subdirs.end(),
+					subdir) == snapshot.subdirs.end())
+				roots.emplace_back(subdir.second, current.depth + 1);
+
+		snapshot = std::move(current);
+	}
+
+	_ScanTrees(roots, 1);
+
+	for (auto& record : fWorkers.front()->directories) {
+		const dir_snapshot& snapshot = record.second;
+		changes.addedSources.insert(changes.addedSources.end(),
+			snapshot.sources.begin(), snapshot.sources.end());
+		changes.addedFiles.insert(changes.addedFiles.end(),
+			snapshot.files.begin(), snapshot.files.end());
+
+		if (fWatchTarget.IsValid() == true
+			&& watch_node(&record.first, B_WATCH_DIRECTORY, fWatchTarget) == B_OK)
+			fWatched.insert(record.first);
+
+		fSnapshot[record.first] = std::move(record.second);
+		changes.directories++;
+	}
+	fWorkers.clear();
+
+	_OpenPreferences();
+	_SetScm();
+	_UpdateList("project_source", changes.removedSources, changes.addedSources);
+	_UpdateList("project_file", changes.removedFiles, changes.addedFiles);
+
+	_ClosePreferences();
+
+	changes.elapsed = system_time() - start;
+
+	return B_OK;
+}
+
+/*
+ * Watches the directories of the last scan, may be called again after
+ * a new one. Node monitor slots are limited, on failure directories
+ * left are not watched.
+ */
+status_t
+ProjectParser::StartWatching(const BMessenger& target)
+{
+	status_t status = B_OK;
+
+	fWatchTarget = target;
+
+	for (auto it = fWatched.begin(); it != fWatched.end();) {
+		if (fSnapshot.find(*it) == fSnapshot.end()) {
+			watch_node(&*it, B_STOP_WATCHING, fWatchTarget);
+			it = fWatched.erase(it);
+		} else
+			it++;
+	}
+
+	for (const auto& record : fSnapshot) {
+		if (fWatched.find(record.first) != fWatched.end())
+			continue;
+		if ((status = watch_node(&record.first, B_WATCH_DIRECTORY,
+				fWatchTarget)) != B_OK)
+			break;
+		fWatched.insert(record.first);
+	}
 
+	return status;
+}
+
+void
+ProjectParser::StopWatching()
+{
+	for (const node_ref& nref : fWatched)
+		watch_node(&nref, B_STOP_WATCHING, fWatchTarget);
+
+	fWatched.clear();
+}
+
+bool
+ProjectParser::IsWatching(const node_ref& directory) const
+{
+	return fWatched.find(directory) != fWatched.end();
+}
+
+/*
+ * Joins an async scan thread, which stops waiting for room in the target
+ * port: the target may be the caller
+ */
+status_t
+ProjectParser::WaitAsync(thread_id thread)
+{
+	status_t result;
+
+	fAsyncWaited = true;
+	if (wait_for_thread(thread, &result) != B_OK)
+		return B_ERROR;
+
+	return result;
+}
+
+/* static */
+status_t
+ProjectParser::_AsyncEntry(void* data)
+{
+	std::unique_ptr<async_scan> scan(static_cast<async_scan*>(data));
+
+	// Project file is written on return
+	status_t status = scan->parser->ParseProjectFiles(scan->directory);
+
+	BMessage message(PROJECT_PARSER_SCAN_DONE);
+	message.AddString("project_name", scan->projectName);
+	message.AddInt32("status", status);
+
+	status_t sent;
+	do {
+		sent = scan->target.SendMessage(&message, (BHandler*)nullptr,
+			kProjectScanSendTimeout);
+	} while ((sent == B_TIMED_OUT || sent == B_WOULD_BLOCK)
+		&& scan->parser->fAsyncWaited == false);
+
+	return status;
+}
+
+/* static */
+status_t
+ProjectParser::_WorkerEntry(void* data)
+{
+	scan_worker* worker = static_cast<scan_worker*>(data);
+	worker->parser->_ScanWorker(worker->index);
 	return B_OK;
 }
 
+void
+ProjectParser::_ClosePreferences()
+{
+	if (fNamed == true) {
+		delete fPreferences;
+		fPreferences = nullptr;
+	}
+}
+
+void
+ProjectParser::_DropDirectory(const node_ref& directory, scan_changes& changes)
+{
+	auto it = fSnapshot.find(directory);
+	if (it == fSnapshot.end())
+		return;
+
+	const dir_snapshot snapshot = std::move(it->second);
+	fSnapshot.erase(it);
+
+	changes.removedSources.insert(changes.removedSources.end(),
+		snapshot.sources.begin(), snapshot.sources.end());
+	changes.removedFiles.insert(changes.removedFiles.end(),
+		snapshot.files.begin(), snapshot.files.end());
+
+	if (fWatched.erase(directory) > 0)
+		watch_node(&directory, B_STOP_WATCHING, fWatchTarget);
+
+	for (const auto& subdir : snapshot.subdirs)
+		_DropDirectory(subdir.first, changes);
+}
+
+/*
+ * Rules are read again for each job, settings and ignore files may
+ * have changed. Returns the count of parseless items.
+ */
 int32
-ProjectParser::_GetParselessItems()
+ProjectParser::_LoadExclusions()
 {
-	int32 count = 0;
-	BString item;
+	_OpenPreferences();
+	fExclusions.Load(fRoot, *fPreferences, fProjectType);
+	_ClosePreferences();
 
-	parseless_items.clear();
+	return fExclusions.CountParselessItems();
+}
 
-	while (fPreferences->FindString("parseless_item", count++, &item) == B_OK)
-		parseless_items.push_back(item);
- 
-	return --count;
+void
+ProjectParser::_OpenPreferences()
+{
+	if (fNamed == true)
+		fPreferences = new TPreferences(fProjectFullName,
+			IdeamNames::kApplicationName, 'LOPR');
 }
 
+/*
+ * Raw entries and a stat relative to the directory, BEntry and BPath are
+ * too costly for each file. Subdirectories go to the worker's own queue.
+ */
 void
-ProjectParser::_ScanDirectory(BString directory)
-{
-	BDirectory dir(directory);
-	BEntry entry;
-	entry_ref ref;
-	char name[B_FILE_NAME_LENGTH];
-
-	// TODO: does not work with traverse on
-	while ((dir.GetNextEntry(&entry)) == B_OK) {
-		entry.GetName(name);
-		std::string token_name(name);
-
-		// Manage directories
-		if (entry.IsDirectory()) {
-
-			if (token_name == ".git") {
-				fPreferences->SetBString("project_scm", "git");
-			} else if (token_name == ".hg") {
-				fPreferences->SetBString("project_scm", "hg");
-			} else if (token_name == ".bzr") {
-				fPreferences->SetBString("project_scm", "bzr");
-			}
-			// Exclude objects dir (starts with)
-			else if (token_name.find("objects.") == 0) {
-				;
-			}
-			// Exclude app dir if any
-			else if (token_name == "app") {
-				;
-			}
-			// Cargo specific
-			else if (fProjectType == "cargo"
-				&& token_name == "target") {
-				// Exclude target dir TODO: better tune
-				;
-			}
-			// Mind recurse quirks
-			else {
-				BPath newPath(directory);
-				newPath.Append(entry.Name());
-				_ScanDirectory(newPath.Path());
+ProjectParser::_ScanDirectory(const BString& directory, int32 depth,
+	scan_worker& worker)
+{
+	BDirectory dir(directory.String());
+	struct stat st;
+
+	if (dir.InitCheck() != B_OK || dir.GetStat(&st) != B_OK)
+		return;
+
+	const node_ref nref(st.st_dev, st.st_ino);
+	dir_snapshot snapshot;
+	snapshot.path = directory;
+	snapshot.depth = depth;
+	snapshot.mtime = to_bigtime(st.st_mtim);
+	snapshot.scanned = real_time_clock_usecs();
+
+	int64 excluded = 0;
+	int64 pruned = 0;
+	bigtime_t ruleTime = 0;
+
+	alignas(dirent) char buffer[kProjectScanDirentsSize];
+	dirent* dirents = reinterpret_cast<dirent*>(buffer);
+	int32 count;
+
+	while ((count = dir.GetNextDirents(dirents, sizeof(buffer))) > 0) {
+		dirent* current = dirents;
+		for (; count > 0; count--, current = reinterpret_cast<dirent*>(
+				reinterpret_cast<char*>(current) + current->d_reclen)) {
+			const char* name = current->d_name;
+			if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+				continue;
+
+			fEntries++;
+
+			// Links are not followed
+			if (dir.GetStatFor(name, &st) != B_OK)
+				continue;
+
+			std::string token_name(name);
+			BString path(directory);
+			path << "/" << name;
+
+			const bool isDirectory = S_ISDIR(st.st_mode);
+
+			// Scm directories are never descended into
+			if (isDirectory == true && token_name == ".git") {
+				snapshot.scm = "git";
+				continue;
+			} else if (isDirectory == true && token_name == ".hg") {
+				snapshot.scm = "hg";
+				continue;
+			} else if (isDirectory == true && token_name == ".bzr") {
+				snapshot.scm = "bzr";
+				continue;
 			}
-		} else {
-			// Entry is a file, get it
-			if ((entry.GetRef(&ref)) == B_OK) {
 
-				BPath path(&entry);
+			const bigtime_t ruleStart = system_time();
+			const int32 match = fExclusions.Match(path, name, isDirectory);
+			ruleTime += system_time() - ruleStart;
+
+			if (match != ExclusionMatcher::MATCH_INCLUDED)
+				excluded++;
+
+			// Manage directories, excluded ones are pruned whole
+			if (isDirectory == true) {
+				if (match == ExclusionMatcher::MATCH_INCLUDED) {
+					snapshot.subdirs.emplace_back(node_ref(st.st_dev, st.st_ino),
+						path);
+					std::lock_guard<std::mutex> guard(worker.lock);
+					fPending++;
+					worker.queue.emplace_back(path, depth + 1);
+				} else
+					pruned++;
+			} else {
 				// Get extension if any
-				std::string extension("");
-				if (token_name.find_last_of(".") != std::string::npos)
-					extension = token_name.substr(token_name.find_last_of(".") + 1);
+				const char* dot = strrchr(name, '.');
+				std::string extension(dot != nullptr ? dot + 1 : "");
 
 				// Excluded item found: save in a list
 				// If a parseless item was not found it means it has been
 				// deleted, so one may like to delete the reference as well
-				if (Ideam::_in_container(path.Path(), parseless_items))
-					parseless_found.push_back(path.Path());
-				// Excluded extension: skip
-				else if (Ideam::_in_container(extension, excluded_extensions))
+				if (match == ExclusionMatcher::MATCH_PARSELESS)
+					snapshot.parseless.push_back(path);
+				// Excluded by settings or ignore files: skip
+				else if (match == ExclusionMatcher::MATCH_EXCLUDED)
 					;
 				// Sources list
-				else if (Ideam::_in_container(extension, source_extensions)) {
-					fPreferences->AddString("project_source", path.Path());
-					fSourcesCount++;
-				}
+				else if (source_extensions.find(extension)
+						!= source_extensions.end())
+					snapshot.sources.push_back(path);
 				// Everything else is a file
-				else {
-					fPreferences->AddString("project_file", path.Path());
-					fFilesCount++;
-				}
+				else
+					snapshot.files.push_back(path);
 			}
 		}
 	}
+
+	fExcluded += excluded;
+	fPruned += pruned;
+	fRuleTime += ruleTime;
+
+	// Compared with later reads
+	std::sort(snapshot.sources.begin(), snapshot.sources.end());
+	std::sort(snapshot.files.begin(), snapshot.files.end());
+
+	worker.directories.emplace_back(nref, std::move(snapshot));
+}
+
+/*
+ * Own queue is taken depth first, the others are stolen from the other
+ * end where the bigger subtrees usually are
+ */
+bool
+ProjectParser::_ScanTake(int32 index, BString& directory, int32& depth)
+{
+	const int32 count = fWorkers.size();
+
+	for (int32 i = 0; i < count; i++) {
+		scan_worker& worker = *fWorkers[(index + i) % count];
+		std::lock_guard<std::mutex> guard(worker.lock);
+
+		if (worker.queue.empty())
+			continue;
+
+		if (i == 0) {
+			directory = worker.queue.back().first;
+			depth = worker.queue.back().second;
+			worker.queue.pop_back();
+		} else {
+			directory = worker.queue.front().first;
+			depth = worker.queue.front().second;
+			worker.queue.pop_front();
+		}
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * Scans the trees at roots, on threads if more than one worker.
+ * Directories found are left in the workers.
+ */
+void
+ProjectParser::_ScanTrees(const std::vector<std::pair<BString, int32>>& roots,
+	int32 workers)
+{
+	const bigtime_t start = system_time();
+
+	fWorkers.clear();
+	for (int32 i = 0; i < workers; i++) {
+		fWorkers.emplace_back(new scan_worker);
+		fWorkers[i]->parser = this;
+		fWorkers[i]->index = i;
+	}
+
+	fEntries = 0;
+	fExcluded = 0;
+	fPruned = 0;
+	fRuleTime = 0;
+	fPending = roots.size();
+	fWorkers[0]->queue.insert(fWorkers[0]->queue.end(), roots.begin(),
+		roots.end());
+
+	std::vector<thread_id> threads;
+	for (int32 i = 0; workers > 1 && i < workers; i++) {
+		thread_id thread = spawn_thread(_WorkerEntry, "project scan",
+			B_NORMAL_PRIORITY, fWorkers[i].get());
+		if (thread >= 0)
+			threads.push_back(thread);
+	}
+
+	if (threads.empty()) {
+		_ScanWorker(0);
+		return;
+	}
+
+	for (thread_id thread : threads)
+		resume_thread(thread);
+
+	bigtime_t progressTime = start + kProjectScanProgressTime;
+	while (fPending > 0) {
+		snooze(kProjectScanPollTime);
+		const bigtime_t now = system_time();
+		if (now >= progressTime && fPending > 0) {
+			progressTime = now + kProjectScanProgressTime;
+			const int64 entries = fEntries;
+			BString notification;
+			notification
+				<< B_TRANSLATE("Project scan") << ":  " << fProjectFullName
+				<< "  " << entries << " " << B_TRANSLATE("entries")
+				<< " (" << entries * 1000000 / (now - start) << "/s)"
+				;
+			_SendNotification(notification);
+		}
+	}
+
+	for (thread_id thread : threads) {
+		status_t result;
+		wait_for_thread(thread, &result);
+	}
+}
+
+void
+ProjectParser::_ScanWorker(int32 index)
+{
+	BString directory;
+	int32 depth;
+
+	// Queued subdirectories are counted before their parent is done
+	while (fPending > 0) {
+		if (_ScanTake(index, directory, depth) == false) {
+			snooze(kProjectScanIdleTime);
+			continue;
+		}
+		_ScanDirectory(directory, depth, *fWorkers[index]);
+		fPending--;
+	}
+}
+
+void
+ProjectParser::_SendNotification(const BString& notification)
+{
+	BMessage message('NOTI');
+	message.AddString("notification", notification);
+	message.AddString("type", "PROJ_SCAN");
+	be_app->WindowAt(0)->PostMessage(&message);
 }
 
 // Set parseless_items to parseless_found
@@ -179,3 +727,55 @@ ProjectParser::_SetParselessItems()
 
 	return parseless_found.size();
 }
+
+// Shallowest one found
+void
+ProjectParser::_SetScm()
+{
+	BString scm;
+	int32 depth = INT32_MAX;
+
+	for (const auto& record : fSnapshot) {
+		if (record.second.scm.IsEmpty() == false && record.second.depth < depth) {
+			scm = record.second.scm;
+			depth = record.second.depth;
+		}
+	}
+
+	if (scm.IsEmpty() == true)
+		fPreferences->RemoveName("project_scm");
+	else
+		fPreferences->SetBString("project_scm", scm);
+}
+
+/*
+ * Lists stay sorted as ParseProjectFiles() writes them, the outline
+ * relies on it
+ */
+void
+ProjectParser::_UpdateList(const char* name, const std::vector<BString>& removed,
+	const std::vector<BString>& added)
+{
+	if (removed.empty() == true && added.empty() == true)
+		return;
+
+	const std::set<BString> gone(removed.begin(), removed.end());
+	std::vector<BString> items;
+	BString item;
+
+	for (int32 i = 0; fPreferences->FindString(name, i, &item) == B_OK; i++)
+		if (gone.find(item) == gone.end())
+			items.push_back(item);
+
+	// Lists appended to before are sorted again
+	std::sort(items.begin(), items.end());
+	for (const BString& path : added) {
+		auto at = std::lower_bound(items.begin(), items.end(), path);
+		if (at == items.end() || *at != path)
+			items.insert(at, path);
+	}
+
+	fPreferences->RemoveName(name);
+	for (const BString& path : items)
+		fPreferences->AddString(name, path);
+}
@@ -20,6 +20,8 @@ bool    "run_in_terminal"
 // "project_source" and "project_file" set in ProjectParser class
 // "parseless_item" set in context menu: Exclude File
 // "release_mode" set in menu Build->Build mode
+// "parseless_dirs*" and "parseless_extensions" set by hand, see
+// ExclusionMatcher, as are .gitignore and .hgignore in base directory
 
 BString "project_target"					// Executable path
 											// or base directory in cargo
@@ -31,40 +33,127 @@ BString "project_source" []
 BString "parseless_item" []	 				// an excluded file or source
 BString "project_run_args" []	 			// run arguments
 bool    "release_mode"
-
-Possible future settings
-BString "parseless_dirs"  []
-BString "parseless_dirs_startchars"  []
-BString "parseless_extensions" []
+BString "parseless_dirs"  []				// excluded directory names
+BString "parseless_dirs_startchars"  []		// and name beginnings
+BString "parseless_extensions" []			// excluded file extensions
  */
 #ifndef PROJECT_PARSER_H
 #define PROJECT_PARSER_H
 
 
+#include <Messenger.h>
+#include <Node.h>
+#include <OS.h>
 #include <String.h>
 #include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "ExclusionMatcher.h"
 #include "TPreferences.h"
 
+enum {
+	PROJECT_PARSER_SCAN_DONE		= 'PPsd'
+};
+
+/*
+ * Directories are scanned on a pool of workers, each taking from its own
+ * queue and stealing from the others when empty. Results are collected
+ * per worker and written to the preferences once, when all are done.
+ *
+ * A snapshot of every directory (node, modification time, entries) is
+ * kept from the last scan. After StartWatching() directories are node
+ * monitored and RescanDirectories() reads again only those reported
+ * changed, telling which files came and went.
+ *
+ * Parsers made on a project name open its preferences for each job and
+ * may be kept around. Preferences are only read before scanning and
+ * written after, they are not held meanwhile.
+ * ParseProjectFilesAsync() runs a scan in a thread of its own and sends
+ * PROJECT_PARSER_SCAN_DONE with "project_name" and "status" to target
+ * once the project file is written; the parser must not be used
+ * meanwhile but for WaitAsync(), after which the message may be dropped.
+ */
 class ProjectParser {
 public:
+	struct scan_changes {
+		std::vector<BString>	addedSources;
+		std::vector<BString>	addedFiles;
+		std::vector<BString>	removedSources;
+		std::vector<BString>	removedFiles;
+		int32					directories = 0;
+		bigtime_t				elapsed = 0;
+	};
+
 								ProjectParser(TPreferences* prefs);
+								ProjectParser(const BString& projectName);
 								~ProjectParser();
 
 			status_t			ParseProjectFiles(BString directory);
+			thread_id			ParseProjectFilesAsync(const BString& directory,
+									const BMessenger& target);
+			status_t			RescanDirectories(
+									const std::set<node_ref>& directories,
+									scan_changes& changes);
+
+			status_t			StartWatching(const BMessenger& target);
+			void				StopWatching();
+			bool				IsWatching(const node_ref& directory) const;
+
+			// Instead of wait_for_thread() on a ParseProjectFilesAsync() one
+			status_t			WaitAsync(thread_id thread);
 
 private:
-			int32				_GetParselessItems();
-			void				_ScanDirectory(BString directory);
+	struct dir_snapshot {
+		BString					path;
+		int32					depth;
+		bigtime_t				mtime;
+		// Real time of the read
+		bigtime_t				scanned;
+		// Full paths, sorted
+		std::vector<BString>	sources;
+		std::vector<BString>	files;
+		std::vector<BString>	parseless;
+		std::vector<std::pair<node_ref, BString>>	subdirs;
+		BString					scm;
+	};
+	struct scan_worker;
+
+	static	status_t			_AsyncEntry(void* data);
+	static	status_t			_WorkerEntry(void* data);
+
+			void				_ClosePreferences();
+			void				_DropDirectory(const node_ref& directory,
+									scan_changes& changes);
+			int32				_LoadExclusions();
+			void				_OpenPreferences();
+			void				_ScanDirectory(const BString& directory,
+									int32 depth, scan_worker& worker);
+			bool				_ScanTake(int32 index, BString& directory,
+									int32& depth);
+			void				_ScanTrees(const std::vector<
+									std::pair<BString, int32>>& roots,
+									int32 workers);
+			void				_ScanWorker(int32 index);
+			void				_SendNotification(const BString& notification);
 			int32				_SetParselessItems();
+			void				_SetScm();
+			void				_UpdateList(const char* name,
+									const std::vector<BString>& removed,
+									const std::vector<BString>& added);
 
 			TPreferences*		fPreferences;
+			// Made on a project name, fPreferences is opened per job
+			bool				fNamed;
+			std::atomic<bool>	fAsyncWaited;
 
-	static const std::vector<std::string> source_extensions;
-	static const std::vector<std::string> excluded_extensions;
-	    std::vector<BString> 	parseless_items;
+	static const std::unordered_set<std::string> source_extensions;
 	    std::vector<BString> 	parseless_found;
 	    BString					fProjectFullName;
 	    BString					fProjectType;
@@ -72,6 +161,24 @@ private:
 	    int32					fParselessOut;
 	    int32					fSourcesCount;
 	    int32					fFilesCount;
+
+			// Normalized base directory of the last scan
+			BString				fRoot;
+			ExclusionMatcher	fExclusions;
+
+			std::vector<std::unique_ptr<scan_worker>>	fWorkers;
+			// Directories queued or being scanned
+			std::atomic<int32>	fPending;
+			std::atomic<int64>	fEntries;
+			// Entries left out, directories among them, and the cost
+			std::atomic<int64>	fExcluded;
+			std::atomic<int64>	fPruned;
+			std::atomic<int64>	fRuleTime;
+
+			std::map<node_ref, dir_snapshot>	fSnapshot;
+			// Only touched by the owner's thread, unlike fSnapshot
+			std::set<node_ref>	fWatched;
+			BMessenger			fWatchTarget;
 };
 
 
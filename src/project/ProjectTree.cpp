@@ -0,0 +1,258 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ProjectTree.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+static std::unique_ptr<ProjectTree::node>
+new_node(const char* name, size_t nameLength, const char* path,
+	size_t pathLength, bool directory, ProjectTree::node* parent)
+{
+	std::unique_ptr<ProjectTree::node> created(new ProjectTree::node);
+	created->name.SetTo(name, nameLength);
+	created->path.SetTo(path, pathLength);
+	created->directory = directory;
+	created->parent = parent;
+	created->item = nullptr;
+	created->materialized = false;
+	return created;
+}
+
+// Name against a part of a path
+static int
+compare_name(const BString& name, const char* part, size_t length)
+{
+	const int result = strncmp(name.String(), part, length);
+	if (result != 0)
+		return result;
+
+	return (size_t)name.Length() > length ? 1 : 0;
+}
+
+ProjectTree::ProjectTree(const BString& title, const BString& basePath)
+	:
+	fFilesCount(0)
+{
+	fRoot.name = title;
+	fRoot.path = basePath;
+	fRoot.directory = true;
+	fRoot.parent = nullptr;
+	fRoot.item = nullptr;
+	fRoot.materialized = false;
+}
+
+/*
+ * Directories are found through a hash of their relative path while
+ * building, children are sorted once at the end
+ */
+void
+ProjectTree::Build(const std::vector<BString>& paths)
+{
+	std::unordered_map<std::string, node*> directories;
+
+	fRoot.children.clear();
+	fFilesCount = 0;
+
+	for (const BString& path : paths) {
+		const char* text = path.String();
+		const size_t start = _Relative(path);
+		const char* relative = text + start;
+
+		node* parent = &fRoot;
+		const char* name = relative;
+		const char* slash;
+
+		while ((slash = strchr(name, '/')) != nullptr) {
+			if (slash > name) {
+				const std::string key(relative, slash - relative);
+				node*& directory = directories[key];
+				if (directory == nullptr) {
+					parent->children.push_back(new_node(name, slash - name,
+						text, slash - text, true, parent));
+					directory = parent->children.back().get();
+				}
+				parent = directory;
+			}
+			name = slash + 1;
+		}
+
+		if (*name == '\0')
+			continue;
+
+		parent->children.push_back(new_node(name, strlen(name), text,
+			path.Length(), false, parent));
+		fFilesCount++;
+	}
+
+	std::vector<node*> pending(1, &fRoot);
+	while (pending.empty() == false) {
+		node* directory = pending.back();
+		pending.pop_back();
+
+		std::vector<std::unique_ptr<node>>& children = directory->children;
+		std::sort(children.begin(), children.end(), Compare);
+
+		// Listed twice
+		auto same = [](const std::unique_ptr<node>& a,
+				const std::unique_ptr<node>& b) {
+			return a->directory == false && b->directory == false
+				&& a->name == b->name;
+		};
+		auto last = std::unique(children.begin(), children.end(), same);
+		fFilesCount -= children.end() - last;
+		children.erase(last, children.end());
+
+		for (auto& child : children)
+			if (child->directory == true)
+				pending.push_back(child.get());
+	}
+}
+
+ProjectTree::node*
+ProjectTree::Find(const BString& path)
+{
+	if (path == fRoot.path)
+		return &fRoot;
+
+	const char* name = path.String() + _Relative(path);
+	node* current = &fRoot;
+	const char* slash;
+
+	while (current != nullptr && (slash = strchr(name, '/')) != nullptr) {
+		if (slash > name)
+			current = _Child(current, name, slash - name, true);
+		name = slash + 1;
+	}
+
+	if (current == nullptr || *name == '\0')
+		return current;
+
+	node* found = _Child(current, name, strlen(name), false);
+	return found != nullptr ? found : _Child(current, name, strlen(name), true);
+}
+
+ProjectTree::node*
+ProjectTree::Add(const BString& path)
+{
+	const char* text = path.String();
+	const char* name = text + _Relative(path);
+	node* parent = &fRoot;
+	node* top = nullptr;
+	const char* slash;
+
+	auto insert = [&top](node* parent, std::unique_ptr<node> created) {
+		node* added = created.get();
+		auto& children = parent->children;
+		children.insert(std::lower_bound(children.begin(), children.end(),
+			created, Compare), std::move(created));
+		if (top == nullptr)
+			top = added;
+		return added;
+	};
+
+	while ((slash = strchr(name, '/')) != nullptr) {
+		if (slash > name) {
+			node* directory = _Child(parent, name, slash - name, true);
+			if (directory == nullptr)
+				directory = insert(parent, new_node(name, slash - name, text,
+					slash - text, true, parent));
+			parent = directory;
+		}
+		name = slash + 1;
+	}
+
+	if (*name == '\0' || _Child(parent, name, strlen(name), false) != nullptr)
+		return top;
+
+	insert(parent, new_node(name, strlen(name), text, path.Length(), false,
+		parent));
+	fFilesCount++;
+
+	return top;
+}
+
+ProjectTree::node*
+ProjectTree::Remove(const BString& path)
+{
+	node* top = Find(path);
+	if (top == nullptr || top->directory == true)
+		return nullptr;
+
+	while (top->parent != &fRoot && top->parent->children.size() == 1)
+		top = top->parent;
+
+	return top;
+}
+
+void
+ProjectTree::Erase(node* gone)
+{
+	std::vector<node*> pending(1, gone);
+	while (pending.empty() == false) {
+		node* current = pending.back();
+		pending.pop_back();
+		if (current->directory == false)
+			fFilesCount--;
+		for (auto& child : current->children)
+			pending.push_back(child.get());
+	}
+
+	auto& siblings = gone->parent->children;
+	siblings.erase(std::find_if(siblings.begin(), siblings.end(),
+		[gone](const std::unique_ptr<node>& sibling) {
+			return sibling.get() == gone;
+		}));
+}
+
+/* static */
+bool
+ProjectTree::Compare(const std::unique_ptr<node>& a,
+	const std::unique_ptr<node>& b)
+{
+	if (a->directory != b->directory)
+		return a->directory == true;
+
+	return strcmp(a->name.String(), b->name.String()) < 0;
+}
+
+ProjectTree::node*
+ProjectTree::_Child(node* parent, const char* name, size_t length,
+	bool directory) const
+{
+	// As Compare()
+	auto before = [directory, name, length](const std::unique_ptr<node>& child,
+			int) {
+		if (child->directory != directory)
+			return child->directory == true;
+		return compare_name(child->name, name, length) < 0;
+	};
+
+	auto& children = parent->children;
+	auto found = std::lower_bound(children.begin(), children.end(), 0, before);
+	if (found == children.end() || (*found)->directory != directory
+		|| compare_name((*found)->name, name, length) != 0)
+		return nullptr;
+
+	return found->get();
+}
+
+/*
+ * Offset of the part under the base directory, paths elsewhere are
+ * taken whole
+ */
+size_t
+ProjectTree::_Relative(const BString& path) const
+{
+	const int32 length = fRoot.path.Length();
+	if (path.Length() > length && path.ByteAt(length) == '/'
+		&& strncmp(path.String(), fRoot.path.String(), length) == 0)
+		return length + 1;
+
+	return 0;
+}
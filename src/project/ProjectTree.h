@@ -0,0 +1,64 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef PROJECT_TREE_H
+#define PROJECT_TREE_H
+
+#include <ListItem.h>
+#include <String.h>
+
+#include <memory>
+#include <vector>
+
+/*
+ * Directory hierarchy of a project list (sources or files) under its
+ * base directory. Build() splits the paths and sorts each directory once,
+ * directories first, so it may run off the window thread. Directories
+ * exist only as path prefixes: one left empty goes too, the root stays.
+ *
+ * Nodes keep their outline item, if made, see ProjectOutlineView.
+ */
+class ProjectTree {
+public:
+	struct node {
+		BString					name;
+		// Full path, base directory for the root
+		BString					path;
+		bool					directory;
+		node*					parent;
+		std::vector<std::unique_ptr<node>>	children;
+		BListItem*				item;
+		// Children have their items too
+		bool					materialized;
+	};
+
+								ProjectTree(const BString& title,
+									const BString& basePath);
+
+			void				Build(const std::vector<BString>& paths);
+
+			node*				Root() { return &fRoot; }
+			node*				Find(const BString& path);
+			int32				CountFiles() const { return fFilesCount; }
+
+			// Topmost node made, nullptr if path was there
+			node*				Add(const BString& path);
+			// Topmost node to go (the file or ancestors left empty), still
+			// in the tree for its items to be dropped, then Erase() it
+			node*				Remove(const BString& path);
+			void				Erase(node* gone);
+
+	static	bool				Compare(const std::unique_ptr<node>& a,
+									const std::unique_ptr<node>& b);
+
+private:
+			node*				_Child(node* parent, const char* name,
+									size_t length, bool directory) const;
+			size_t				_Relative(const BString& path) const;
+
+			node				fRoot;
+			int32				fFilesCount;
+};
+
+#endif // PROJECT_TREE_H
@@ -0,0 +1,664 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "TrigramIndex.h"
+
+#include <Entry.h>
+#include <File.h>
+#include <FindDirectory.h>
+#include <Path.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "IdeamNamespace.h"
+#include "TextScanner.h"
+
+static const uint32 kIndexMagic = 'IDMX';
+static const uint32 kIndexVersion = 1;
+static const uint32 kFileUnindexed = 1 << 0;
+// Head of a file sniffed for binary content, as done on load
+static constexpr auto kIndexSniffSize = 8192;
+
+struct index_header {
+	uint32	magic;
+	uint32	version;
+	uint32	fileCount;
+	uint32	trigramCount;
+	uint64	postingsSize;
+	uint32	stringsSize;
+	uint32	reserved;
+};
+
+struct index_file {
+	int64	mtime;
+	int64	size;
+	uint32	pathOffset;
+	uint32	pathLength;
+	uint32	flags;
+	uint32	reserved;
+};
+
+struct index_trigram {
+	uint32	trigram;
+	uint32	count;
+	uint64	offset;
+};
+
+// Posting lists: first id, then deltas, LEB128 varints
+static inline void
+append_varint(std::string& bytes, uint32 value)
+{
+	while (value >= 0x80) {
+		bytes.push_back(char((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back(char(value));
+}
+
+struct TrigramIndex::posting_builder {
+	std::string	bytes;
+	uint32		last = 0;
+	uint32		count = 0;
+
+	void Append(uint32 id)
+	{
+		append_varint(bytes, count == 0 ? id : id - last);
+		last = id;
+		count++;
+	}
+};
+
+static inline uint8
+fold(uint8 c)
+{
+	return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+static void
+extract_trigrams(const char* text, size_t length, std::vector<uint32>& trigrams)
+{
+	const uint8* bytes = reinterpret_cast<const uint8*>(text);
+
+	trigrams.clear();
+	if (length < 3)
+		return;
+
+	trigrams.reserve(length - 2);
+	uint32 trigram = fold(bytes[0]) << 8 | fold(bytes[1]);
+	for (size_t i = 2; i < length; i++) {
+		trigram = ((trigram << 8) | fold(bytes[i])) & 0xFFFFFF;
+		trigrams.push_back(trigram);
+	}
+
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+static void
+decode_posting(const uint8* bytes, uint32 count, std::vector<uint32>& ids)
+{
+	uint32 id = 0;
+
+	ids.clear();
+	ids.reserve(count);
+	for (uint32 i = 0; i < count; i++) {
+		uint32 value = 0;
+		int shift = 0;
+		uint8 byte;
+		do {
+			byte = *bytes++;
+			value |= uint32(byte & 0x7F) << shift;
+			shift += 7;
+		} while (byte & 0x80);
+		id = (i == 0) ? value : id + value;
+		ids.push_back(id);
+	}
+}
+
+/*
+ * Every path and posting inside the file, posting ids below the file count
+ * so decode_posting() and the tables can be used unchecked
+ */
+static bool
+check_index(const void* map, off_t mapSize)
+{
+	const index_header* header = static_cast<const index_header*>(map);
+	const index_file* files = reinterpret_cast<const index_file*>(header + 1);
+	const index_trigram* trigrams = reinterpret_cast<const index_trigram*>(
+		files + header->fileCount);
+	const uint8* postings = reinterpret_cast<const uint8*>(
+		trigrams + header->trigramCount);
+
+	for (uint32 id = 0; id < header->fileCount; id++) {
+		if (uint64(files[id].pathOffset) + files[id].pathLength
+				> header->stringsSize)
+			return false;
+	}
+
+	for (uint32 i = 0; i < header->trigramCount; i++) {
+		if (i > 0 && trigrams[i].trigram <= trigrams[i - 1].trigram)
+			return false;
+		if (trigrams[i].offset >= header->postingsSize)
+			return false;
+
+		const uint8* bytes = postings + trigrams[i].offset;
+		const uint8* end = postings + header->postingsSize;
+		uint64 id = 0;
+		for (uint32 count = 0; count < trigrams[i].count; count++) {
+			uint64 value = 0;
+			int shift = 0;
+			uint8 byte;
+			do {
+				if (bytes == end || shift > 28)
+					return false;
+				byte = *bytes++;
+				value |= uint64(byte & 0x7F) << shift;
+				shift += 7;
+			} while (byte & 0x80);
+			id = count == 0 ? value : id + value;
+			if (id >= header->fileCount)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+TrigramIndex::TrigramIndex(const BString& projectName)
+	:
+	fMap(nullptr)
+	, fMapSize(0)
+	, fQueryTime(0)
+{
+	BPath path;
+	find_directory(B_USER_SETTINGS_DIRECTORY, &path);
+	path.Append(IdeamNames::kApplicationName);
+
+	BString name(projectName);
+	name.RemoveLast(IdeamNames::kProjectExtension);
+	name << IdeamNames::kProjectIndexExtension;
+	path.Append(name);
+
+	fPath = path.Path();
+}
+
+TrigramIndex::~TrigramIndex()
+{
+	Unload();
+}
+
+/*
+ * Map the index file and check it is consistent. Overlaid files are
+ * dropped, a new index includes them.
+ */
+status_t
+TrigramIndex::Load()
+{
+	Unload();
+
+	int fd = open(fPath.String(), O_RDONLY);
+	if (fd < 0)
+		return B_ENTRY_NOT_FOUND;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(index_header)) {
+		close(fd);
+		return B_BAD_DATA;
+	}
+
+	void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED)
+		return B_NO_MEMORY;
+
+	const index_header* header = static_cast<const index_header*>(map);
+	uint64 expected = sizeof(index_header)
+		+ uint64(header->fileCount) * sizeof(index_file)
+		+ uint64(header->trigramCount) * sizeof(index_trigram)
+		+ header->postingsSize + header->stringsSize;
+
+	if (header->magic != kIndexMagic || header->version != kIndexVersion
+		|| header->postingsSize > uint64(st.st_size)
+		|| expected != uint64(st.st_size)
+		|| check_index(map, st.st_size) == false) {
+		munmap(map, st.st_size);
+		return B_BAD_DATA;
+	}
+
+	fMap = map;
+	fMapSize = st.st_size;
+
+	const index_file* files = reinterpret_cast<const index_file*>(header + 1);
+	const char* strings = static_cast<const char*>(fMap) + fMapSize
+		- header->stringsSize;
+
+	fPathIds.reserve(header->fileCount);
+	for (uint32 id = 0; id < header->fileCount; id++)
+		fPathIds[std::string(strings + files[id].pathOffset,
+			files[id].pathLength)] = id;
+
+	return B_OK;
+}
+
+void
+TrigramIndex::Unload()
+{
+	if (fMap != nullptr)
+		munmap(fMap, fMapSize);
+
+	fMap = nullptr;
+	fMapSize = 0;
+	fPathIds.clear();
+	fOverlay.clear();
+}
+
+/*
+ * Files unchanged since last indexing (mtime and size) keep their
+ * postings, the others are read again. Files are sorted by path so
+ * old to new ids are monotonic and posting lists merge in one pass.
+ */
+status_t
+TrigramIndex::Update(std::vector<BString> files, update_stats& stats)
+{
+	bigtime_t start = system_time();
+
+	stats.files = 0;
+	stats.reindexed = 0;
+	stats.elapsed = 0;
+	stats.size = 0;
+
+	std::sort(files.begin(), files.end());
+	files.erase(std::unique(files.begin(), files.end()), files.end());
+
+	const index_header* header = static_cast<const index_header*>(fMap);
+	const index_file* oldFiles = nullptr;
+	uint32 oldCount = 0;
+	if (IsLoaded() == true) {
+		oldFiles = reinterpret_cast<const index_file*>(header + 1);
+		oldCount = header->fileCount;
+	}
+
+	std::vector<BString> kept;
+	std::vector<overlay> data;
+	std::vector<int64> oldToNew(oldCount, -1);
+	std::unordered_map<uint32, posting_builder> fresh;
+
+	for (const BString& path : files) {
+		struct stat st;
+		if (stat(path.String(), &st) != 0 || S_ISREG(st.st_mode) == false)
+			continue;
+
+		const uint32 id = kept.size();
+		overlay entry;
+		entry.mtime = st.st_mtime;
+		entry.size = st.st_size;
+		entry.unindexed = false;
+
+		auto old = fPathIds.find(path.String());
+		auto updated = fOverlay.find(path);
+
+		if (updated != fOverlay.end() && updated->second.mtime == entry.mtime
+			&& updated->second.size == entry.size) {
+			entry = updated->second;
+		} else if (old != fPathIds.end() && oldFiles[old->second].mtime == entry.mtime
+			&& oldFiles[old->second].size == entry.size) {
+			entry.unindexed = (oldFiles[old->second].flags & kFileUnindexed) != 0;
+			oldToNew[old->second] = id;
+		} else {
+			_IndexFile(path, entry);
+			stats.reindexed++;
+		}
+
+		for (uint32 trigram : entry.trigrams)
+			fresh[trigram].Append(id);
+
+		entry.trigrams.clear();
+		entry.trigrams.shrink_to_fit();
+
+		kept.push_back(path);
+		data.push_back(entry);
+	}
+
+	// Merge old (remapped) and fresh postings, trigram by trigram
+	std::vector<uint32> freshKeys;
+	freshKeys.reserve(fresh.size());
+	for (auto& it : fresh)
+		freshKeys.push_back(it.first);
+	std::sort(freshKeys.begin(), freshKeys.end());
+
+	const index_trigram* oldTrigrams = nullptr;
+	const uint8* oldPostings = nullptr;
+	uint32 oldTrigramCount = 0;
+	if (IsLoaded() == true) {
+		oldTrigrams = reinterpret_cast<const index_trigram*>(oldFiles + oldCount);
+		oldPostings = reinterpret_cast<const uint8*>(oldTrigrams + header->trigramCount);
+		oldTrigramCount = header->trigramCount;
+	}
+
+	std::map<uint32, posting_builder> postings;
+	std::vector<uint32> oldIds, freshIds, merged;
+	size_t a = 0, b = 0;
+
+	while (a < oldTrigramCount || b < freshKeys.size()) {
+		uint32 trigram;
+		if (b == freshKeys.size() || (a < oldTrigramCount
+				&& oldTrigrams[a].trigram <= freshKeys[b]))
+			trigram = oldTrigrams[a].trigram;
+		else
+			trigram = freshKeys[b];
+
+		merged.clear();
+		freshIds.clear();
+
+		if (a < oldTrigramCount && oldTrigrams[a].trigram == trigram) {
+			decode_posting(oldPostings + oldTrigrams[a].offset,
+				oldTrigrams[a].count, oldIds);
+			for (uint32 id : oldIds) {
+				if (oldToNew[id] >= 0)
+					merged.push_back(oldToNew[id]);
+			}
+			a++;
+		}
+
+		if (b < freshKeys.size() && freshKeys[b] == trigram) {
+			posting_builder& builder = fresh[trigram];
+			decode_posting(reinterpret_cast<const uint8*>(builder.bytes.data()),
+				builder.count, freshIds);
+			builder.bytes.clear();
+			b++;
+
+			std::vector<uint32> both;
+			both.reserve(merged.size() + freshIds.size());
+			std::merge(merged.begin(), merged.end(), freshIds.begin(),
+				freshIds.end(), std::back_inserter(both));
+			merged.swap(both);
+		}
+
+		if (merged.empty())
+			continue;
+
+		posting_builder& builder = postings[trigram];
+		for (uint32 id : merged)
+			builder.Append(id);
+	}
+
+	// Write beside and rename over, then map the new one
+	BString temporary(fPath);
+	temporary << "~";
+
+	status_t status = _Write(temporary, kept, data, postings);
+	if (status != B_OK) {
+		BEntry(temporary).Remove();
+		return status;
+	}
+
+	Unload();
+
+	BEntry entry(temporary);
+	BPath path(fPath);
+	if ((status = entry.Rename(path.Leaf(), true)) != B_OK)
+		return status;
+
+	status = Load();
+
+	stats.files = kept.size();
+	stats.size = fMapSize;
+	stats.elapsed = system_time() - start;
+
+	return status;
+}
+
+/*
+ * Node monitor driven: the file is read again and kept aside until the
+ * next Update()
+ */
+status_t
+TrigramIndex::UpdateFile(const BString& path)
+{
+	struct stat st;
+	if (stat(path.String(), &st) != 0)
+		return B_ENTRY_NOT_FOUND;
+
+	overlay& entry = fOverlay[path];
+	entry.mtime = st.st_mtime;
+	entry.size = st.st_size;
+	entry.unindexed = false;
+
+	return _IndexFile(path, entry);
+}
+
+/*
+ * Not read now, it may still be being written
+ */
+void
+TrigramIndex::Invalidate(const BString& path)
+{
+	overlay& entry = fOverlay[path];
+	entry.mtime = 0;
+	entry.size = 0;
+	entry.unindexed = true;
+	entry.trigrams.clear();
+}
+
+status_t
+TrigramIndex::Remove()
+{
+	Unload();
+
+	return BEntry(fPath).Remove();
+}
+
+status_t
+TrigramIndex::Candidates(const BString& literal,
+	const std::vector<BString>& files, std::vector<BString>& candidates)
+{
+	bigtime_t start = system_time();
+
+	if (IsLoaded() == false)
+		return B_NO_INIT;
+
+	std::vector<uint32> query;
+	extract_trigrams(literal.String(), literal.Length(), query);
+	if (query.empty())
+		return B_BAD_VALUE;
+
+	// Intersect posting lists
+	std::vector<uint32> hits, ids, both;
+	for (size_t i = 0; i < query.size(); i++) {
+		if (_Posting(query[i], ids) == false) {
+			hits.clear();
+			break;
+		}
+		if (i == 0)
+			hits.swap(ids);
+		else {
+			both.clear();
+			std::set_intersection(hits.begin(), hits.end(), ids.begin(),
+				ids.end(), std::back_inserter(both));
+			hits.swap(both);
+		}
+		if (hits.empty())
+			break;
+	}
+
+	const index_header* header = static_cast<const index_header*>(fMap);
+	const index_file* indexFiles = reinterpret_cast<const index_file*>(header + 1);
+
+	std::vector<bool> hit(header->fileCount, false);
+	for (uint32 id : hits)
+		hit[id] = true;
+
+	// No filesystem access, changes come through UpdateFile() and
+	// Invalidate()
+	for (const BString& path : files) {
+		auto updated = fOverlay.find(path);
+		if (updated != fOverlay.end()) {
+			const overlay& entry = updated->second;
+			bool all = true;
+			for (size_t i = 0; i < query.size() && all == true; i++)
+				all = std::binary_search(entry.trigrams.begin(),
+					entry.trigrams.end(), query[i]);
+			if (entry.unindexed == true || all == true)
+				candidates.push_back(path);
+			continue;
+		}
+
+		auto found = fPathIds.find(path.String());
+		if (found == fPathIds.end()) {
+			candidates.push_back(path);
+			continue;
+		}
+
+		const index_file& file = indexFiles[found->second];
+		if ((file.flags & kFileUnindexed) != 0 || hit[found->second] == true)
+			candidates.push_back(path);
+	}
+
+	fQueryTime = system_time() - start;
+
+	return B_OK;
+}
+
+int32
+TrigramIndex::CountFiles() const
+{
+	if (IsLoaded() == false)
+		return 0;
+
+	return static_cast<const index_header*>(fMap)->fileCount;
+}
+
+/*
+ * Binary files get no trigrams (they are skipped by search anyway),
+ * big ones are flagged unindexed
+ */
+status_t
+TrigramIndex::_IndexFile(const BString& path, overlay& data)
+{
+	data.trigrams.clear();
+
+	if (data.size > kTrigramIndexMaxFileSize) {
+		data.unindexed = true;
+		return B_OK;
+	}
+	if (data.size == 0)
+		return B_OK;
+
+	int fd = open(path.String(), O_RDONLY);
+	if (fd < 0) {
+		data.unindexed = true;
+		return B_ERROR;
+	}
+
+	void* map = mmap(nullptr, data.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (map == MAP_FAILED) {
+		data.unindexed = true;
+		return B_NO_MEMORY;
+	}
+
+	const char* text = static_cast<const char*>(map);
+
+	TextScanner scanner;
+	scanner.Scan(text, std::min<off_t>(data.size, kIndexSniffSize));
+	scanner.Finish();
+
+	if (scanner.IsBinary() == false)
+		extract_trigrams(text, data.size, data.trigrams);
+
+	munmap(map, data.size);
+
+	return B_OK;
+}
+
+/*
+ * Binary search of the trigram table
+ */
+bool
+TrigramIndex::_Posting(uint32 trigram, std::vector<uint32>& ids) const
+{
+	const index_header* header = static_cast<const index_header*>(fMap);
+	const index_file* files = reinterpret_cast<const index_file*>(header + 1);
+	const index_trigram* trigrams = reinterpret_cast<const index_trigram*>(
+		files + header->fileCount);
+	const index_trigram* end = trigrams + header->trigramCount;
+	const uint8* postings = reinterpret_cast<const uint8*>(end);
+
+	const index_trigram* found = std::lower_bound(trigrams, end, trigram,
+		[](const index_trigram& item, uint32 value) {
+			return item.trigram < value;
+		});
+
+	if (found == end || found->trigram != trigram)
+		return false;
+
+	decode_posting(postings + found->offset, found->count, ids);
+	return true;
+}
+
+status_t
+TrigramIndex::_Write(const BString& path, const std::vector<BString>& files,
+	const std::vector<overlay>& data, std::map<uint32, posting_builder>& postings)
+{
+	BFile file(path.String(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	index_header header = {};
+	header.magic = kIndexMagic;
+	header.version = kIndexVersion;
+	header.fileCount = files.size();
+	header.trigramCount = postings.size();
+
+	std::vector<index_file> fileTable(files.size());
+	std::string strings;
+	for (size_t id = 0; id < files.size(); id++) {
+		index_file& entry = fileTable[id];
+		entry.mtime = data[id].mtime;
+		entry.size = data[id].size;
+		entry.pathOffset = strings.size();
+		entry.pathLength = files[id].Length();
+		entry.flags = data[id].unindexed == true ? kFileUnindexed : 0;
+		entry.reserved = 0;
+		strings.append(files[id].String(), files[id].Length());
+	}
+	header.stringsSize = strings.size();
+
+	std::vector<index_trigram> trigramTable;
+	trigramTable.reserve(postings.size());
+	uint64 offset = 0;
+	for (auto& it : postings) {
+		trigramTable.push_back({it.first, it.second.count, offset});
+		offset += it.second.bytes.size();
+	}
+	header.postingsSize = offset;
+
+	ssize_t expected = sizeof(header);
+	ssize_t written = file.Write(&header, sizeof(header));
+	expected += fileTable.size() * sizeof(index_file);
+	written += file.Write(fileTable.data(), fileTable.size() * sizeof(index_file));
+	expected += trigramTable.size() * sizeof(index_trigram);
+	written += file.Write(trigramTable.data(),
+		trigramTable.size() * sizeof(index_trigram));
+	for (auto& it : postings) {
+		expected += it.second.bytes.size();
+		written += file.Write(it.second.bytes.data(), it.second.bytes.size());
+	}
+	expected += strings.size();
+	written += file.Write(strings.data(), strings.size());
+
+	if (written != expected)
+		return B_IO_ERROR;
+
+	return file.Sync();
+}
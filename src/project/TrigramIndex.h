@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef TRIGRAM_INDEX_H
+#define TRIGRAM_INDEX_H
+
+#include <OS.h>
+#include <String.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Files above this size are not indexed and always searched
+constexpr auto kTrigramIndexMaxFileSize = 8 * 1024 * 1024;
+
+/*
+ * Per project trigram index, stored as <project>.idmidx beside the
+ * .idmpro settings file and mapped in memory when loaded.
+ *
+ * Layout: header, file table (sorted by path), trigram table (sorted by
+ * trigram) and posting lists of file ids, delta and varint encoded, then
+ * the path strings. Trigrams are ASCII case folded.
+ *
+ * Candidates() may only return too many files, never too few as long as
+ * changes are told: files saved or modified while open go through
+ * UpdateFile(), ones created or moved over in a watched directory through
+ * Invalidate(). Unknown and too big files are always candidates. Queries
+ * do not touch the filesystem, files edited in place by others while not
+ * open are seen at the next Update().
+ */
+class TrigramIndex {
+public:
+	struct update_stats {
+		int32		files;
+		int32		reindexed;
+		bigtime_t	elapsed;
+		off_t		size;
+	};
+
+								TrigramIndex(const BString& projectName);
+								~TrigramIndex();
+
+			status_t			Load();
+			void				Unload();
+			bool				IsLoaded() const { return fMap != nullptr; }
+
+			status_t			Update(std::vector<BString> files,
+									update_stats& stats);
+			status_t			UpdateFile(const BString& path);
+			// Always a candidate until next Update()
+			void				Invalidate(const BString& path);
+			status_t			Remove();
+
+			status_t			Candidates(const BString& literal,
+									const std::vector<BString>& files,
+									std::vector<BString>& candidates);
+
+			int32				CountFiles() const;
+			off_t				Size() const { return fMapSize; }
+			bigtime_t			LastQueryTime() const { return fQueryTime; }
+
+private:
+	struct posting_builder;
+	struct overlay {
+		int64					mtime;
+		int64					size;
+		bool					unindexed;
+		std::vector<uint32>		trigrams;
+	};
+
+			status_t			_IndexFile(const BString& path, overlay& data);
+			bool				_Posting(uint32 trigram,
+									std::vector<uint32>& ids) const;
+			status_t			_Write(const BString& path,
+									const std::vector<BString>& files,
+									const std::vector<overlay>& data,
+									std::map<uint32, posting_builder>& postings);
+
+			BString				fPath;
+			void*				fMap;
+			off_t				fMapSize;
+			std::unordered_map<std::string, uint32>	fPathIds;
+			std::map<BString, overlay>	fOverlay;
+			bigtime_t			fQueryTime;
+};
+
+#endif // TRIGRAM_INDEX_H
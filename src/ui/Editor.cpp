@@ -9,16 +9,24 @@
 #include <Application.h>
 #include <Catalog.h>
 #include <Control.h>
+#include <Directory.h>
+#include <Looper.h>
 #include <NodeMonitor.h>
+#include <OS.h>
 #include <Path.h>
 #include <SciLexer.h>
 #include <Volume.h>
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
 #include "IdeamCommon.h"
 #include "IdeamNamespace.h"
+#include "LineDiff.h"
+#include "TextRegex.h"
+#include "TextSearch.h"
 #include "keywords.h"
 
 #undef B_TRANSLATION_CONTEXT
@@ -33,6 +41,25 @@ using namespace IdeamNames;
 
 //#define USE_LINEBREAKS_ATTRS
 
+enum {
+	MSG_LOAD_CHUNK		= 'loch',
+	MSG_INCREMENTAL		= 'incr'
+};
+
+// Resident memory of the whole team, used to report load peaks
+static size_t
+team_memory_usage()
+{
+	size_t usage = 0;
+	ssize_t cookie = 0;
+	area_info info;
+
+	while (get_next_area_info(B_CURRENT_TEAM, &cookie, &info) == B_OK)
+		usage += info.ram_size;
+
+	return usage;
+}
+
 Editor::Editor(entry_ref* ref, const BMessenger& target)
 	:
 	BScintillaView(ref->name, 0, true, true)
@@ -46,6 +73,35 @@ Editor::Editor(entry_ref* ref, const BMessenger& target)
 	, fCommenter("")
 	, fCurrentLine(-1)
 	, fCurrentColumn(-1)
+	, fLargeFileMode(false)
+	, fLargeFileUserSet(false)
+	, fLoadFile(nullptr)
+	, fLoadBuffer(nullptr)
+	, fLoadSize(0)
+	, fLoadOffset(0)
+	, fLoadSlices(0)
+	, fLoaded(false)
+	, fLoading(false)
+	, fLoadEditable(true)
+	, fLoadStartTime(0)
+	, fLoadFirstPaintTime(0)
+	, fLoadBaseMemory(0)
+	, fLoadPeakMemory(0)
+	, fSaveSyncTime(0)
+	, fContentHash(0)
+	, fContentSize(-1)
+	, fIncrementalGeneration(0)
+	, fIncrementalRunning(false)
+	, fIncrementalPass(0)
+	, fIncrementalPosition(0)
+	, fIncrementalEnd(0)
+	, fIncrementalVisibleStart(0)
+	, fIncrementalVisibleEnd(0)
+	, fIncrementalAnchor(0)
+	, fIncrementalFirst(-1)
+	, fIncrementalSelected(false)
+	, fIncrementalCount(0)
+	, fIncrementalStartTime(0)
 {
 	fFileName = BString(ref->name);
 	SetTarget(target);
@@ -74,11 +130,16 @@ Editor::Editor(entry_ref* ref, const BMessenger& target)
 
 Editor::~Editor()
 {
+	// Closed while loading or never loaded: caret is meaningless,
+	// keep the saved one
+	bool loaded = fLoaded && !fLoading;
+	_LoadAbort();
+
 	// Stop monitoring
 	StopMonitoring();
 
 	// Set caret position
-	if (Settings.save_caret == true) {
+	if (Settings.save_caret == true && loaded == true) {
 		BNode node(&fFileRef);
 		if (node.InitCheck() == B_OK) {
 			int32 pos = GetCurrentPosition();
@@ -91,7 +152,18 @@ void
 Editor::MessageReceived(BMessage* message)
 {
 	switch (message->what) {
-
+		case MSG_LOAD_CHUNK: {
+			if (fLoading == true)
+				_LoadSlice();
+			break;
+		}
+		case MSG_INCREMENTAL: {
+			// Stale slices of a canceled search are dropped
+			if (fIncrementalRunning == true && message->GetUInt32("generation",
+					0) == fIncrementalGeneration)
+				_IncrementalSlice();
+			break;
+		}
 		default:
 			BScintillaView::MessageReceived(message);
 			break;
@@ -115,7 +187,7 @@ Editor::ApplySettings()
 	SendMessage(SCI_STYLECLEARALL, UNSET, UNSET);
 
 	// Highlighting
-	if (Settings.syntax_highlight == B_CONTROL_ON) {
+	if (Settings.syntax_highlight == B_CONTROL_ON && fLargeFileMode == false) {
 		_ApplyExtensionSettings();
 		_HighlightFile();
 	}
@@ -124,7 +196,7 @@ Editor::ApplySettings()
 		_HighlightBraces();
 
 	// Caret line visible
-	if (Settings.mark_caretline == true) {
+	if (Settings.mark_caretline == true && fLargeFileMode == false) {
 		SendMessage(SCI_SETCARETLINEVISIBLE, 1, UNSET);
 		SendMessage(SCI_SETCARETLINEBACK, kCaretLineBackColor, UNSET);
 	}
@@ -168,8 +240,14 @@ Editor::ApplySettings()
 	SendMessage(SCI_MARKERSETFORE, sci_BOOKMARK, kMarkerForeColor);
 	SendMessage(SCI_MARKERSETBACK, sci_BOOKMARK, kMarkerBackColor);
 
+	// Incremental search matches
+	SendMessage(SCI_INDICSETSTYLE, sci_SEARCH_INDICATOR, INDIC_ROUNDBOX);
+	SendMessage(SCI_INDICSETFORE, sci_SEARCH_INDICATOR, kSearchIndicatorColor);
+	SendMessage(SCI_INDICSETALPHA, sci_SEARCH_INDICATOR, 100);
+	SendMessage(SCI_INDICSETUNDER, sci_SEARCH_INDICATOR, true);
+
 	// Folding
-	if (Settings.enable_folding == B_CONTROL_ON)
+	if (Settings.enable_folding == B_CONTROL_ON && fLargeFileMode == false)
 		_SetFoldMargin();
 
 	// Line commenter margin
@@ -177,6 +255,8 @@ Editor::ApplySettings()
 		SendMessage(SCI_SETMARGINWIDTHN, sci_COMMENT_MARGIN, 12);
 		SendMessage(SCI_SETMARGINSENSITIVEN, sci_COMMENT_MARGIN, 1);
 	}
+
+	_ApplyLargeFileMode();
 }
 
 void
@@ -314,6 +394,12 @@ Editor::Cut()
 	SendMessage(SCI_CUT, UNSET, UNSET);
 }
 
+BString const
+Editor::EncodingString()
+{
+	return fTextScanner.EncodingString();
+}
+
 BString const
 Editor::EndOfLineString()
 {
@@ -361,12 +447,16 @@ Editor::Find(const BString&  text, int flags, bool backwards /* = false */)
 {
 	int position;
 
-	SendMessage(SCI_SEARCHANCHOR, UNSET, UNSET);
+	if ((flags & SCFIND_REGEXP) != 0)
+		position = _FindRegex(text, flags, backwards);
+	else {
+		SendMessage(SCI_SEARCHANCHOR, UNSET, UNSET);
 
-	if (backwards == false)
-		position = SendMessage(SCI_SEARCHNEXT, flags, (sptr_t) text.String());
-	else
-		position = SendMessage(SCI_SEARCHPREV, flags, (sptr_t) text.String());
+		if (backwards == false)
+			position = SendMessage(SCI_SEARCHNEXT, flags, (sptr_t) text.String());
+		else
+			position = SendMessage(SCI_SEARCHPREV, flags, (sptr_t) text.String());
+	}
 
 	if (position != -1) {
 		SendMessage(SCI_ENSUREVISIBLEENFORCEPOLICY,
@@ -388,54 +478,61 @@ Editor::FindInTarget(const BString& search, int flags, int startPosition, int en
 	return position;
 }
 
+/*
+ * One pass over the buffer, one marker per matching line and a single
+ * result message carrying the (1 based) line numbers.
+ */
 int32
 Editor::FindMarkAll(const BString& text, int flags)
 {
-	int position, count = 0;
-	int line, firstMark;
-
 	// Clear all
 	BookmarkClearAll(sci_BOOKMARK);
 
-	// TODO use wrap
-	SendMessage(SCI_TARGETWHOLEDOCUMENT, UNSET, UNSET);
-	SendMessage(SCI_SETSEARCHFLAGS, flags, UNSET);
-	position = SendMessage(SCI_SEARCHINTARGET, text.Length(), (sptr_t) text.String());
-	firstMark = position;
+	const char* buffer = reinterpret_cast<const char*>(
+		SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+	size_t length = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
+
+	std::vector<size_t> positions;
+	if ((flags & SCFIND_REGEXP) != 0) {
+		std::vector<TextRegex::match> matches;
+		auto regex = _Regex(text, flags);
+		if (regex != nullptr)
+			regex->FindAll(buffer, length, matches);
+		for (const auto& found : matches)
+			positions.push_back(found.start);
+	} else {
+		TextSearch search(text.String(), text.Length(),
+			(flags & SCFIND_MATCHCASE) != 0, (flags & SCFIND_WHOLEWORD) != 0);
+		search.FindAll(buffer, length, positions);
+	}
+	int32 count = positions.size();
 
-	if (position == -1)
-		// No occurrence found
-		return 0;
-	else
-		SendMessage(SCI_GOTOPOS, position, UNSET);
+	// Positions are sorted, skip to the next line after each hit
+	std::vector<int32> lines;
+	ssize_t nextLineStart = 0;
+	for (size_t position : positions) {
+		if ((ssize_t)position < nextLineStart)
+			continue;
 
-	while (position != -1) {
-		SendMessage(SCI_SEARCHANCHOR, 0, 0);
-		position = SendMessage(SCI_SEARCHNEXT, flags, (sptr_t) text.String());
+		int32 line = SendMessage(SCI_LINEFROMPOSITION, position, UNSET);
+		SendMessage(SCI_MARKERADD, line, sci_BOOKMARK);
+		lines.push_back(line + 1);
 
-		if (position == -1)
+		nextLineStart = SendMessage(SCI_POSITIONFROMLINE, line + 1, UNSET);
+		if (nextLineStart < 0)
 			break;
-		else {
-			// Get line
-			line = SendMessage(SCI_LINEFROMPOSITION, position, UNSET);
-			SendMessage(SCI_MARKERADD, line, sci_BOOKMARK);
-			SendMessage(SCI_CHARRIGHT, UNSET, UNSET);
-			count++;
-
-			// Found occurrence, message window
-			BMessage message(EDITOR_FIND_SET_MARK);
-			message.AddRef("ref", &fFileRef);
-			int line = SendMessage(SCI_LINEFROMPOSITION, position, UNSET) + 1;
-			message.AddInt32("line", line);
-			fTarget.SendMessage(&message);
-		}
 	}
 
-	SendMessage(SCI_GOTOPOS, firstMark, UNSET);
+	if (count > 0)
+		SendMessage(SCI_GOTOPOS, positions[0], UNSET);
 
 	BMessage message(EDITOR_FIND_COUNT);
+	message.AddRef("ref", &fFileRef);
 	message.AddString("text_to_find", text);
 	message.AddInt32("count", count);
+	if (lines.empty() == false)
+		message.AddData("lines", B_INT32_TYPE, lines.data(),
+			lines.size() * sizeof(int32));
 	fTarget.SendMessage(&message);
 
 	return count;
@@ -523,6 +620,65 @@ Editor::GrabFocus()
 	SendMessage(SCI_GRABFOCUS, UNSET, UNSET);
 }
 
+/*
+ * Starts marking text matches, canceling a search still running.
+ * Visible lines are done right away, then the rest of the document in
+ * slices of kIncrementalSliceTime between looper turns. The first match
+ * from the selection start on is selected, wrapping if none.
+ */
+void
+Editor::IncrementalSearch(const BString& text, int flags)
+{
+	IncrementalSearchClear();
+
+	if (text.IsEmpty())
+		return;
+
+	fIncrementalSearch.reset();
+	fIncrementalRegex.reset();
+
+	if ((flags & SCFIND_REGEXP) != 0) {
+		fIncrementalRegex = _Regex(text, flags);
+		if (fIncrementalRegex == nullptr)
+			return;
+	} else
+		fIncrementalSearch.reset(new TextSearch(text.String(), text.Length(),
+			(flags & SCFIND_MATCHCASE) != 0, (flags & SCFIND_WHOLEWORD) != 0));
+
+	const int32 firstLine = SendMessage(SCI_DOCLINEFROMVISIBLE,
+		SendMessage(SCI_GETFIRSTVISIBLELINE, UNSET, UNSET), UNSET);
+	const int32 lastLine = SendMessage(SCI_DOCLINEFROMVISIBLE,
+		SendMessage(SCI_GETFIRSTVISIBLELINE, UNSET, UNSET)
+		+ SendMessage(SCI_LINESONSCREEN, UNSET, UNSET), UNSET);
+
+	fIncrementalText = text;
+	fIncrementalVisibleStart = SendMessage(SCI_POSITIONFROMLINE, firstLine, UNSET);
+	fIncrementalVisibleEnd = SendMessage(SCI_GETLINEENDPOSITION, lastLine, UNSET);
+	fIncrementalAnchor = SendMessage(SCI_GETSELECTIONSTART, UNSET, UNSET);
+	fIncrementalFirst = -1;
+	fIncrementalSelected = false;
+	fIncrementalCount = 0;
+	fIncrementalStartTime = system_time();
+
+	fIncrementalPass = 0;
+	fIncrementalPosition = fIncrementalVisibleStart;
+	fIncrementalEnd = fIncrementalVisibleEnd;
+	fIncrementalRunning = true;
+
+	_IncrementalSlice();
+}
+
+void
+Editor::IncrementalSearchClear()
+{
+	fIncrementalRunning = false;
+	fIncrementalGeneration++;
+
+	SendMessage(SCI_SETINDICATORCURRENT, sci_SEARCH_INDICATOR, UNSET);
+	SendMessage(SCI_INDICATORCLEARRANGE, 0,
+		SendMessage(SCI_GETLENGTH, UNSET, UNSET));
+}
+
 bool
 Editor::IsOverwrite()
 {
@@ -547,6 +703,12 @@ Editor::IsReadOnly()
 bool
 Editor::IsSearchSelected(const BString& search, int flags)
 {
+	if ((flags & SCFIND_REGEXP) != 0) {
+		auto regex = _Regex(search, flags);
+		TextRegex::match found;
+		return regex != nullptr && _RegexSelected(*regex, found) == true;
+	}
+
 	int start = SendMessage(SCI_GETSELECTIONSTART, UNSET, UNSET);
 	int end = SendMessage(SCI_GETSELECTIONEND, UNSET, UNSET);
 
@@ -565,67 +727,62 @@ Editor::IsTextSelected()
 
 /*
  * Code (editable) taken from stylededit
+ *
+ * The file is read in kLoadChunkSize pieces and appended to the document,
+ * so no full-size copy is ever held besides scintilla's own. When a slice
+ * exceeds kLoadSliceTime the rest is loaded from the looper, letting the
+ * window paint and stay responsive. EDITOR_LOAD_DONE is sent at the end.
  */
 status_t
 Editor::LoadFromFile()
 {
 	status_t status;
-	BFile file;
 	struct stat st;
 
-	if ((status = file.SetTo(&fFileRef, B_READ_ONLY)) != B_OK)
-		return status;
-	if ((status = file.InitCheck()) != B_OK)
-		return status;
-	if ((status = file.Lock()) != B_OK)
+	_LoadAbort();
+
+	fLoadFile = new BFile();
+
+	if ((status = fLoadFile->SetTo(&fFileRef, B_READ_ONLY)) != B_OK
+			|| (status = fLoadFile->Lock()) != B_OK) {
+		_LoadAbort();
 		return status;
-	if ((status = file.GetStat(&st)) != B_OK)
+	}
+	if ((status = fLoadFile->GetStat(&st)) != B_OK) {
+		_LoadAbort();
 		return status;
+	}
 
 	bool editable = (getuid() == st.st_uid && S_IWUSR & st.st_mode)
 					|| (getgid() == st.st_gid && S_IWGRP & st.st_mode)
 					|| (S_IWOTH & st.st_mode);
 	BVolume volume(fFileRef.device);
-	editable = editable && !volume.IsReadOnly();
-
-	off_t size;
-	file.GetSize(&size);
-
-	char* buffer = new char[size + 1];
-
-	off_t len = file.Read(buffer, size);
-
-	buffer[size] = '\0';
-
-	SendMessage(SCI_SETTEXT, 0, (sptr_t) buffer);
-
-	// Check the first newline only
-	int32 lineLength = SendMessage(SCI_LINELENGTH, 0, UNSET);
-	char *lineBuffer = new char[lineLength];
-	SendMessage(SCI_GETLINE, 0, (sptr_t)lineBuffer);
-	_EndOfLineAssign(lineBuffer, lineLength);
-	delete[] lineBuffer;
-
-	delete[] buffer;
-
-	if (len != size)
-		return B_ERROR;
-
-	if ((status = file.Unlock()) != B_OK)
-		return status;
-
-	SendMessage(SCI_EMPTYUNDOBUFFER, UNSET, UNSET);
-	SendMessage(SCI_SETSAVEPOINT, UNSET, UNSET);
-
-	if (editable == false)
-		SetReadOnly();
-
-	// Monitor node
-	StartMonitoring();
+	fLoadEditable = editable && !volume.IsReadOnly();
+
+	fLoadSize = st.st_size;
+	fLoadOffset = 0;
+	fLoadSlices = 0;
+
+	if (fLargeFileUserSet == false)
+		fLargeFileMode = fLoadSize >= kLargeFileSize;
+	fLoadBuffer = new char[std::max<off_t>(std::min<off_t>(fLoadSize,
+		kLoadChunkSize), 1)];
+	fLoadStartTime = system_time();
+	fLoadFirstPaintTime = 0;
+	fLoadBaseMemory = fLoadPeakMemory = team_memory_usage();
+	fLoading = true;
+	fTextScanner.Reset();
+	fContentHasher.Reset();
 
 	fFileType = Ideam::file_type(fFileName.String());
 
-	return B_OK;
+	// No undo history for the initial content
+	SendMessage(SCI_SETUNDOCOLLECTION, 0, UNSET);
+	SendMessage(SCI_ALLOCATE, fLoadSize + 1, UNSET);
+
+	// First slice is loaded synchronously, so the tab shows up with
+	// its first screenful. Later slices (if any) come from the looper
+	return _LoadSlice();
 }
 
 BString const
@@ -665,6 +822,13 @@ Editor::NotificationReceived(SCNotification* notification)
 			if (notification->linesAdded != 0)
 				if (Settings.show_linenumber == true)
 					_RedrawNumberMargin();
+			// Positions of a running incremental search are stale,
+			// marks already set move along with the text
+			if (fIncrementalRunning == true && (notification->modificationType
+					& (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) != 0) {
+				fIncrementalRunning = false;
+				fIncrementalGeneration++;
+			}
 			break;
 		}
 	// case SCN_NEEDSHOWN: {
@@ -672,6 +836,9 @@ Editor::NotificationReceived(SCNotification* notification)
 		// break;
 		// }
 		case SCN_SAVEPOINTLEFT: {
+			// Appending loaded text is not a modification
+			if (fLoading == true)
+				break;
 			fModified = true;
 			BMessage message(EDITOR_SAVEPOINT_LEFT);
 			message.AddRef("ref", &fFileRef);
@@ -749,47 +916,88 @@ Editor::Redo()
 	SendMessage(SCI_REDO, UNSET, UNSET);
 }
 
+/*
+ * Only the lines changed on disk are replaced, as one undo action, so
+ * undo history, caret, folds and styling of untouched lines are kept.
+ * Large files are reloaded whole.
+ */
 status_t
 Editor::Reload()
 {
 	status_t status;
+
+	// A reload while loading just restarts the load
+	if (fLoading == true)
+		return LoadFromFile();
+
+	if (fLargeFileMode == true)
+		return _ReloadFull();
+
 	BFile file;
 
 	//TODO errors should be notified
 	if ((status = file.SetTo(&fFileRef, B_READ_ONLY)) != B_OK)
 		return status;
-	if ((status = file.InitCheck()) != B_OK)
-		return status;
-
 	if ((status = file.Lock()) != B_OK)
 		return status;
 
+	off_t size;
+	file.GetSize(&size);
+
+	std::string text;
+	text.resize(size);
+
+	off_t offset = 0;
+	while (offset < size) {
+		ssize_t bytes = file.Read(&text[offset],
+			std::min<off_t>(size - offset, kLoadChunkSize));
+		if (bytes <= 0)
+			break;
+		offset += bytes;
+	}
+
+	file.Unlock();
+
+	if (offset != size)
+		return B_ERROR;
+
+	fTextScanner.Reset();
+	fTextScanner.Scan(text.data(), size);
+	fTextScanner.Finish();
+
+	fContentHash = XXHash64::Hash(text.data(), size);
+	fContentSize = size;
+
+	const char* current = reinterpret_cast<const char*>(
+		SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+	LineDiff diff(current, SendMessage(SCI_GETLENGTH, UNSET, UNSET),
+		text.data(), size);
+	diff.Compute();
+
 	// Enable external modifications of readonly file/buffer
 	bool readOnly = IsReadOnly();
 
 	if (readOnly == true)
 		SendMessage(SCI_SETREADONLY, 0, UNSET);
 
-	off_t size;
-	file.GetSize(&size);
-
-	char* buffer = new char[size + 1];
-	off_t len = file.Read(buffer, size);
-	buffer[size] = '\0';
-	SendMessage(SCI_CLEARALL, UNSET, UNSET);
-	SendMessage(SCI_SETTEXT, 0, (sptr_t) buffer);
-	delete[] buffer;
+	// Bottom up, so offsets of preceding hunks stay valid
+	SendMessage(SCI_BEGINUNDOACTION, UNSET, UNSET);
+	const std::vector<LineDiff::hunk>& hunks = diff.Hunks();
+	for (auto it = hunks.rbegin(); it != hunks.rend(); ++it) {
+		size_t start = diff.OldOffset(it->oldStart);
+		size_t end = diff.OldOffset(it->oldStart + it->oldCount);
+		size_t newStart = diff.NewOffset(it->newStart);
+		size_t newEnd = diff.NewOffset(it->newStart + it->newCount);
+
+		SendMessage(SCI_SETTARGETRANGE, start, end);
+		SendMessage(SCI_REPLACETARGET, newEnd - newStart,
+			(sptr_t) (text.data() + newStart));
+	}
+	SendMessage(SCI_ENDUNDOACTION, UNSET, UNSET);
 
 	if (readOnly == true)
 		SendMessage(SCI_SETREADONLY, 1, UNSET);
 
-	if (len != size)
-		return B_ERROR;
-
-	if ((status = file.Unlock()) != B_OK)
-		return status;
-
-	SendMessage(SCI_EMPTYUNDOBUFFER, UNSET, UNSET);
 	SendMessage(SCI_SETSAVEPOINT, UNSET, UNSET);
 
 	return B_OK;
@@ -799,6 +1007,9 @@ int
 Editor::ReplaceAndFindNext(const BString& selection, const BString& replacement,
 															int flags, bool wrap)
 {
+	if ((flags & SCFIND_REGEXP) != 0)
+		return _ReplaceAndFindNextRegex(selection, replacement, flags, wrap);
+
 	int retValue = REPLACE_NONE;
 
 	int position = SendMessage(SCI_GETCURRENTPOS, UNSET, UNSET);
@@ -834,39 +1045,86 @@ Editor::ReplaceAndFindNext(const BString& selection, const BString& replacement,
 }
 
 /*
- * Adapted from Koder EditorWindow::_FindReplace
+ * Matches are found in a single scan of the buffer, the span from first
+ * to last match is rebuilt once and swapped in with one REPLACETARGET,
+ * so the gap buffer moves once and undo is a single step.
+ * One message reports the count and the changed (1 based) lines.
  */
 int32
 Editor::ReplaceAll(const BString& selection, const BString& replacement, int flags)
 {
-	int32 count = 0;
+	if (selection.IsEmpty())
+		return 0;
 
-	SendMessage(SCI_TARGETWHOLEDOCUMENT, UNSET, UNSET);
-	SendMessage(SCI_SETSEARCHFLAGS, flags, UNSET);
+	const char* buffer = reinterpret_cast<const char*>(
+		SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+	size_t length = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
 
-	int position;
-	int endPosition = SendMessage(SCI_GETTARGETEND, 0, 0);
+	std::vector<TextRegex::match> matches;
+	std::shared_ptr<const TextRegex> regex;
 
-	SendMessage(SCI_BEGINUNDOACTION, 0, 0);
+	if ((flags & SCFIND_REGEXP) != 0) {
+		regex = _Regex(selection, flags);
+		if (regex != nullptr)
+			regex->FindAll(buffer, length, matches);
+	} else {
+		TextSearch search(selection.String(), selection.Length(),
+			(flags & SCFIND_MATCHCASE) != 0, (flags & SCFIND_WHOLEWORD) != 0);
 
-	do {
-		position = SendMessage(SCI_SEARCHINTARGET, selection.Length(),
-												(sptr_t) selection.String());
-		if(position != -1) {
-			SendMessage(SCI_REPLACETARGET, -1, (sptr_t) replacement.String());
-			count++;
+		std::vector<size_t> positions;
+		search.FindAll(buffer, length, positions);
+		for (size_t position : positions)
+			matches.push_back({position, position + selection.Length(), {}});
+	}
+
+	int32 count = matches.size();
+	std::vector<int32> lines;
+
+	if (count > 0) {
+		const size_t first = matches.front().start;
+		const size_t last = matches.back().end;
+
+		std::string text;
+		text.reserve(last - first + count * replacement.Length());
+
+		// Lines shift when either match or replacement spans lines
+		int32 lineDelta = 0;
+		ssize_t nextLineStart = 0;
+		size_t from = first;
+		for (const auto& found : matches) {
+			if ((ssize_t)found.start >= nextLineStart && nextLineStart >= 0) {
+				int32 line = SendMessage(SCI_LINEFROMPOSITION, found.start, UNSET);
+				lines.push_back(line + lineDelta + 1);
+				nextLineStart = SendMessage(SCI_POSITIONFROMLINE, line + 1, UNSET);
+			}
 
-			// Found occurrence, message window
-			ReplaceMessage(position, selection, replacement);
+			text.append(buffer + from, found.start - from);
+			size_t replaced = text.size();
+			if (regex != nullptr)
+				regex->Expand(replacement.String(), replacement.Length(),
+					buffer, found, text);
+			else
+				text.append(replacement.String(), replacement.Length());
+			from = found.end;
 
-			SendMessage(SCI_SETTARGETRANGE, position + replacement.Length(), endPosition);
+			lineDelta += std::count(text.begin() + replaced, text.end(), '\n')
+				- std::count(buffer + found.start, buffer + found.end, '\n');
 		}
-	} while(position != -1);
 
-	SendMessage(SCI_ENDUNDOACTION, 0, 0);
+		SendMessage(SCI_BEGINUNDOACTION, UNSET, UNSET);
+		SendMessage(SCI_SETTARGETRANGE, first, last);
+		SendMessage(SCI_REPLACETARGET, text.size(), (sptr_t) text.data());
+		SendMessage(SCI_ENDUNDOACTION, UNSET, UNSET);
+	}
 
 	BMessage message(EDITOR_REPLACE_ALL_COUNT);
+	message.AddRef("ref", &fFileRef);
 	message.AddInt32("count", count);
+	message.AddString("selection", selection);
+	message.AddString("replacement", replacement);
+	if (lines.empty() == false)
+		message.AddData("lines", B_INT32_TYPE, lines.data(),
+			lines.size() * sizeof(int32));
 	fTarget.SendMessage(&message);
 
 	return count;
@@ -889,8 +1147,32 @@ Editor::ReplaceMessage(int position, const BString& selection,
 }
 
 int
-Editor::ReplaceOne(const BString& selection, const BString& replacement)
+Editor::ReplaceOne(const BString& selection, const BString& replacement,
+	int flags /* = 0 */)
 {
+	if ((flags & SCFIND_REGEXP) != 0) {
+		auto regex = _Regex(selection, flags);
+		TextRegex::match found;
+		if (regex == nullptr || _RegexSelected(*regex, found) == false)
+			return REPLACE_NONE;
+
+		const char* buffer = reinterpret_cast<const char*>(
+			SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+		BString matched(buffer + found.start, found.end - found.start);
+		std::string expanded;
+		regex->Expand(replacement.String(), replacement.Length(), buffer,
+			found, expanded);
+
+		SendMessage(SCI_SETTARGETRANGE, found.start, found.end);
+		SendMessage(SCI_REPLACETARGET, expanded.size(), (sptr_t) expanded.data());
+		SendMessage(SCI_GOTOPOS, found.start + expanded.size(), UNSET);
+
+		ReplaceMessage(found.start + expanded.size(), matched,
+			BString(expanded.data(), expanded.size()));
+
+		return REPLACE_DONE;
+	}
+
 	if (selection == Selection()) {
 		SendMessage(SCI_REPLACESEL, UNUSED, (sptr_t)replacement.String());
 
@@ -903,34 +1185,100 @@ Editor::ReplaceOne(const BString& selection, const BString& replacement)
 	return REPLACE_NONE;
 }
 
+/*
+ * Text is written straight from scintilla's buffer to a temporary file in
+ * the same directory, synced and renamed over the original, so a failure
+ * never leaves a truncated file. Attributes and permissions of the original
+ * are carried over. Falls back to writing in place if the directory does
+ * not allow creating the temporary file.
+ */
 ssize_t
 Editor::SaveToFile()
 {
 	BFile file;
 	status_t status;
+	bigtime_t syncStart;
 
-	status = file.SetTo(&fFileRef, B_READ_WRITE | B_ERASE_FILE | B_CREATE_FILE);
-	if (status != B_OK)
-		return 0;
+	fSaveSyncTime = 0;
 
-	// TODO warn user
-	if ((status = file.Lock()) != B_OK)
-		return 0;
+	// Save to the symlink target, not over the symlink
+	BEntry target(&fFileRef, true);
+	BDirectory directory;
+	BString targetName(fFileRef.name);
+	char name[B_FILE_NAME_LENGTH];
+	if (target.GetParent(&directory) == B_OK && target.GetName(name) == B_OK)
+		targetName = name;
 
-	off_t size = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
-	file.Seek(0, SEEK_SET);
-	char* buffer = new char[size + 1];
+	BString tempName;
+	tempName << "." << targetName << kSaveTempSuffix;
+
+	status = file.SetTo(&directory, tempName.String(),
+		B_READ_WRITE | B_ERASE_FILE | B_CREATE_FILE);
+
+	if (status != B_OK) {
+		// Write in place
+		status = file.SetTo(&fFileRef, B_READ_WRITE | B_ERASE_FILE | B_CREATE_FILE);
+		if (status != B_OK)
+			return 0;
+
+		// TODO warn user
+		if ((status = file.Lock()) != B_OK)
+			return 0;
+
+		ssize_t bytes = _WriteText(file);
+
+		syncStart = system_time();
+		file.Sync();
+		fSaveSyncTime = system_time() - syncStart;
+
+		file.Unlock();
+
+		if (bytes >= 0) {
+			fContentHash = fContentHasher.Digest();
+			fContentSize = bytes;
+			SendMessage(SCI_SETSAVEPOINT, UNSET, UNSET);
+		}
 
-	SendMessage(SCI_GETTEXT, size + 1, (sptr_t)buffer);
+		return bytes < 0 ? 0 : bytes;
+	}
+
+	BEntry tempEntry(&directory, tempName.String());
+
+	// Carry attributes (caret, mime type, ...) and permissions over
+	BNode original(&target);
+	if (original.InitCheck() == B_OK) {
+		char attrName[B_ATTR_NAME_LENGTH];
+		while (original.GetNextAttrName(attrName) == B_OK) {
+			attr_info info;
+			if (original.GetAttrInfo(attrName, &info) != B_OK)
+				continue;
+			char* data = new char[info.size];
+			if (original.ReadAttr(attrName, info.type, 0, data, info.size)
+					== info.size)
+				file.WriteAttr(attrName, info.type, 0, data, info.size);
+			delete[] data;
+		}
+		mode_t permissions;
+		if (original.GetPermissions(&permissions) == B_OK)
+			file.SetPermissions(permissions);
+	}
+
+	ssize_t bytes = _WriteText(file);
+
+	syncStart = system_time();
+	status = file.Sync();
+	fSaveSyncTime = system_time() - syncStart;
 
-	off_t bytes = file.Write(buffer, size);
-	file.Flush();
+	file.Unset();
 
-	// TODO warn user
-	if ((status = file.Unlock()) != B_OK)
+	if (bytes < 0 || status != B_OK
+			|| tempEntry.Rename(targetName.String(), true) != B_OK) {
+		tempEntry.Remove();
 		return 0;
+	}
 
-	delete[] buffer;
+	fContentHash = fContentHasher.Digest();
+	fContentSize = bytes;
 
 	SendMessage(SCI_SETSAVEPOINT, UNSET, UNSET);
 
@@ -1008,6 +1356,21 @@ Editor::SetFileRef(entry_ref* ref)
 	return B_OK;
 }
 
+/*
+ * Manual override of the automatic large file mode
+ */
+void
+Editor::SetLargeFileMode(bool enable)
+{
+	fLargeFileUserSet = true;
+
+	if (fLargeFileMode == enable)
+		return;
+
+	fLargeFileMode = enable;
+	ApplySettings();
+}
+
 void
 Editor::SetReadOnly()
 {
@@ -1074,6 +1437,11 @@ Editor::SetSearchFlags(bool matchCase, bool wholeWord, bool wordStart,
 		flags |= SCFIND_WHOLEWORD;
 	if (wordStart == true)
 		flags |= SCFIND_WORDSTART;
+	// Handled by TextRegex, not scintilla's backtracking engine
+	if (regExp == true)
+		flags |= SCFIND_REGEXP;
+	if (posix == true)
+		flags |= SCFIND_POSIX;
 
 	return flags;
 }
@@ -1162,6 +1530,30 @@ Editor::_ApplyExtensionSettings()
 	}
 }
 
+/*
+ * Large file mode: no lexing, folding, caret line and guides; styling
+ * happens when idle and layout is cached for the visible page only
+ */
+void
+Editor::_ApplyLargeFileMode()
+{
+	if (fLargeFileMode == true) {
+		fSyntaxAvailable = false;
+		fFoldingAvailable = false;
+		SendMessage(SCI_SETLEXER, SCLEX_NULL, UNSET);
+		SendMessage(SCI_CLEARDOCUMENTSTYLE, UNSET, UNSET);
+		SendMessage(SCI_SETPROPERTY, (sptr_t) "fold", (sptr_t) "0");
+		SendMessage(SCI_SETMARGINWIDTHN, sci_FOLD_MARGIN, 0);
+		SendMessage(SCI_SETCARETLINEVISIBLE, 0, UNSET);
+		SendMessage(SCI_SETINDENTATIONGUIDES, SC_IV_NONE, UNSET);
+		SendMessage(SCI_SETIDLESTYLING, SC_IDLESTYLING_ALL, UNSET);
+		SendMessage(SCI_SETLAYOUTCACHE, SC_CACHE_PAGE, UNSET);
+	} else {
+		SendMessage(SCI_SETIDLESTYLING, SC_IDLESTYLING_NONE, UNSET);
+		SendMessage(SCI_SETLAYOUTCACHE, SC_CACHE_CARET, UNSET);
+	}
+}
+
 /*
  * TODO: tune better and extensions management
  *
@@ -1241,6 +1633,61 @@ Editor::_AutoIndentLine()
 	SendMessage(SCI_GOTOPOS, position + insertions, UNSET);
 }
 
+/*
+ * In large file mode SCI_BRACEMATCH could scan the whole document on every
+ * caret move, so the matching brace is only looked for within
+ * kLargeFileBraceWindow bytes. No lexer is set then, so ignoring
+ * styles as SCI_BRACEMATCH does is not needed.
+ */
+int32
+Editor::_BraceMatch(int32 position)
+{
+	if (fLargeFileMode == false)
+		return SendMessage(SCI_BRACEMATCH, position, UNUSED);
+
+	char brace = SendMessage(SCI_GETCHARAT, position, UNSET);
+	char match;
+	bool forward = true;
+
+	switch (brace) {
+		case '(': match = ')'; break;
+		case '[': match = ']'; break;
+		case '{': match = '}'; break;
+		case ')': match = '('; forward = false; break;
+		case ']': match = '['; forward = false; break;
+		case '}': match = '{'; forward = false; break;
+		default:
+			return -1;
+	}
+
+	int32 depth = 0;
+
+	if (forward == true) {
+		int32 end = std::min<int32>(SendMessage(SCI_GETLENGTH, UNSET, UNSET),
+			position + kLargeFileBraceWindow);
+		const char* text = reinterpret_cast<const char*>(
+			SendMessage(SCI_GETRANGEPOINTER, position, end - position));
+		for (int32 i = 0; i < end - position; i++) {
+			if (text[i] == brace)
+				depth++;
+			else if (text[i] == match && --depth == 0)
+				return position + i;
+		}
+	} else {
+		int32 start = std::max<int32>(0, position - kLargeFileBraceWindow);
+		const char* text = reinterpret_cast<const char*>(
+			SendMessage(SCI_GETRANGEPOINTER, start, position + 1 - start));
+		for (int32 i = position - start; i >= 0; i--) {
+			if (text[i] == brace)
+				depth++;
+			else if (text[i] == match && --depth == 0)
+				return start + i;
+		}
+	}
+
+	return -1;
+}
+
 /*
  * TODO oneline 'if' indentation guide not highlighted
  */
@@ -1275,7 +1722,7 @@ Editor::_CheckForBraceMatching()
 	// Found a brace, see if it's matched or not
 	// Found before
 	if (_IsBrace(charBefore) == true) {
-		positionMatch = SendMessage(SCI_BRACEMATCH, positionBefore, UNUSED);
+		positionMatch = _BraceMatch(positionBefore);
 		// No match found, highlight brace bad
 		if (positionMatch == -1) {
 			SendMessage(SCI_BRACEBADLIGHT, positionBefore, UNSET);
@@ -1293,7 +1740,7 @@ Editor::_CheckForBraceMatching()
 	}
 	// Found after
 	else if (_IsBrace(charAfter) == true) {
-		positionMatch = SendMessage(SCI_BRACEMATCH, caretPosition, UNUSED);
+		positionMatch = _BraceMatch(caretPosition);
 		// No match found, highlight brace bad
 		if (positionMatch == -1) {
 			SendMessage(SCI_BRACEBADLIGHT, caretPosition, UNSET);
@@ -1345,9 +1792,14 @@ Editor::_EndOfLine()
 	return SendMessage(SCI_GETEOLMODE, UNSET, UNSET);
 }
 
+/*
+ * Line endings mode is the most used one in file, as counted at load
+ */
 void
-Editor::_EndOfLineAssign(char *buffer, int32 size)
+Editor::_EndOfLineAssign()
 {
+	int32 eol;
+
 #ifdef USE_LINEBREAKS_ATTRS
 	BNode node(&fFileRef);
 	if (node.ReadAttr("be:line_breaks", B_INT32_TYPE, 0, &eol, sizeof(eol)) > 0) {
@@ -1356,23 +1808,14 @@ Editor::_EndOfLineAssign(char *buffer, int32 size)
 	}
 #endif
 
-	// Empty file, use default LF
-	if (size == 0) {
-		SendMessage(SCI_SETEOLMODE, SC_EOL_LF, UNSET);
-		return;
-	}
-
-	int32 eol;
-	switch (buffer[size - 1]) {
-		case '\n':
-			if (size > 1 && buffer[size - 2] == '\r')
-				eol = SC_EOL_CRLF;
-			else
-				eol = SC_EOL_LF;
+	switch (fTextScanner.EndOfLine()) {
+		case TextScanner::EOL_CRLF:
+			eol = SC_EOL_CRLF;
 			break;
-		case '\r':
+		case TextScanner::EOL_CR:
 			eol = SC_EOL_CR;
 			break;
+		// Empty or single line file, use default LF
 		default:
 			eol = SC_EOL_LF;
 			break;
@@ -1381,6 +1824,36 @@ Editor::_EndOfLineAssign(char *buffer, int32 size)
 	SendMessage(SCI_SETEOLMODE, eol, UNSET);
 }
 
+/*
+ * Selects the match as SCI_SEARCHNEXT and SCI_SEARCHPREV do, caret at
+ * its start. Searching backwards looks for matches starting before the
+ * selection.
+ */
+int
+Editor::_FindRegex(const BString& text, int flags, bool backwards)
+{
+	auto regex = _Regex(text, flags);
+	if (regex == nullptr)
+		return -1;
+
+	const char* buffer = reinterpret_cast<const char*>(
+		SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+	size_t length = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
+	size_t anchor = SendMessage(SCI_GETSELECTIONSTART, UNSET, UNSET);
+
+	TextRegex::match found;
+	bool hit = backwards == false
+		? regex->Search(buffer, length, anchor, found)
+		: regex->SearchBackward(buffer, length, anchor, found);
+
+	if (hit == false)
+		return -1;
+
+	SendMessage(SCI_SETSEL, found.end, found.start);
+
+	return found.start;
+}
+
 void
 Editor::_HighlightBraces()
 {
@@ -1450,6 +1923,122 @@ Editor::_HighlightFile()
 	}
 }
 
+/*
+ * Match starting in [start, before). The literal search is handed a text
+ * cut just past before, so a call never scans much more than the range.
+ */
+bool
+Editor::_IncrementalFind(const char* buffer, size_t length, size_t start,
+	size_t before, size_t& matchStart, size_t& matchEnd)
+{
+	if (fIncrementalRegex != nullptr) {
+		TextRegex::match found;
+		if (fIncrementalRegex->Search(buffer, length, start, found, before) == false)
+			return false;
+		matchStart = found.start;
+		matchEnd = found.end;
+		return true;
+	}
+
+	const size_t patternLength = fIncrementalSearch->PatternLength();
+	ssize_t position = fIncrementalSearch->Find(buffer,
+		std::min(length, before + patternLength + 1), start);
+	if (position < 0 || (size_t)position >= before)
+		return false;
+
+	matchStart = position;
+	matchEnd = position + patternLength;
+	return true;
+}
+
+/*
+ * Passes: visible range, only marked to show something at once, then the
+ * whole document in order, marked again, counted and selected from
+ */
+void
+Editor::_IncrementalSlice()
+{
+	const bigtime_t sliceStart = system_time();
+	const char* buffer = reinterpret_cast<const char*>(
+		SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+	const size_t length = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
+
+	SendMessage(SCI_SETINDICATORCURRENT, sci_SEARCH_INDICATOR, UNSET);
+
+	while (true) {
+		if (fIncrementalPosition >= fIncrementalEnd) {
+			if (++fIncrementalPass == 1) {
+				// Marked up to here, a match may have run past the visible end
+				fIncrementalVisibleEnd = fIncrementalPosition;
+				fIncrementalPosition = 0;
+				fIncrementalEnd = fIncrementalVisibleStart;
+			} else if (fIncrementalPass == 2) {
+				// A match from before may cover the visible start, the first
+				// pass marks are replaced
+				if (fIncrementalVisibleEnd > fIncrementalPosition)
+					SendMessage(SCI_INDICATORCLEARRANGE, fIncrementalPosition,
+						fIncrementalVisibleEnd - fIncrementalPosition);
+				fIncrementalEnd = length;
+			} else
+				break;
+			continue;
+		}
+
+		size_t before = std::min(fIncrementalEnd,
+			fIncrementalPosition + kIncrementalChunkSize);
+		size_t start, end;
+
+		while (_IncrementalFind(buffer, length, fIncrementalPosition, before,
+				start, end) == true) {
+			if (end > start)
+				SendMessage(SCI_INDICATORFILLRANGE, start, end - start);
+
+			if (fIncrementalPass > 0) {
+				fIncrementalCount++;
+
+				if (fIncrementalFirst < 0)
+					fIncrementalFirst = start;
+
+				if (fIncrementalSelected == false && start >= fIncrementalAnchor) {
+					fIncrementalSelected = true;
+					SendMessage(SCI_SETSEL, end, start);
+					ScrollCaret();
+				}
+			}
+
+			fIncrementalPosition = end > start ? end : end + 1;
+		}
+		fIncrementalPosition = std::max(fIncrementalPosition, before);
+
+		if (system_time() - sliceStart > kIncrementalSliceTime
+			&& Looper() != nullptr) {
+			BMessage message(MSG_INCREMENTAL);
+			message.AddUInt32("generation", fIncrementalGeneration);
+			Looper()->PostMessage(&message, this);
+			return;
+		}
+	}
+
+	fIncrementalRunning = false;
+
+	// Nothing past the anchor, wrap
+	if (fIncrementalSelected == false && fIncrementalFirst >= 0) {
+		size_t start, end;
+		if (_IncrementalFind(buffer, length, fIncrementalFirst,
+				fIncrementalFirst + 1, start, end) == true) {
+			SendMessage(SCI_SETSEL, end, start);
+			ScrollCaret();
+		}
+	}
+
+	BMessage message(EDITOR_INCREMENTAL_COUNT);
+	message.AddRef("ref", &fFileRef);
+	message.AddString("text", fIncrementalText);
+	message.AddInt32("count", fIncrementalCount);
+	message.AddInt64("elapsed", system_time() - fIncrementalStartTime);
+	fTarget.SendMessage(&message);
+}
+
 bool
 Editor::_IsBrace(char character)
 {
@@ -1464,6 +2053,167 @@ Editor::_IsBrace(char character)
 //			|| character == '>';
 }
 
+// Release loading resources, also when interrupted
+void
+Editor::_LoadAbort()
+{
+	if (fLoadFile != nullptr) {
+		fLoadFile->Unlock();
+		delete fLoadFile;
+		fLoadFile = nullptr;
+	}
+
+	delete[] fLoadBuffer;
+	fLoadBuffer = nullptr;
+
+	if (fLoading == true) {
+		fLoading = false;
+		SendMessage(SCI_SETUNDOCOLLECTION, 1, UNSET);
+	}
+}
+
+// Read the next chunk and append it, returns bytes read
+ssize_t
+Editor::_LoadChunk()
+{
+	ssize_t bytes = fLoadFile->Read(fLoadBuffer,
+		std::min<off_t>(fLoadSize - fLoadOffset, kLoadChunkSize));
+
+	if (bytes > 0) {
+		fTextScanner.Scan(fLoadBuffer, bytes);
+		fContentHasher.Update(fLoadBuffer, bytes);
+		SendMessage(SCI_APPENDTEXT, bytes, (sptr_t) fLoadBuffer);
+		fLoadOffset += bytes;
+	}
+
+	return bytes;
+}
+
+void
+Editor::_LoadFinish(status_t status)
+{
+	off_t size = fLoadOffset;
+
+	_LoadAbort();
+	fLoaded = true;
+
+	fTextScanner.Finish();
+	_EndOfLineAssign();
+
+	fContentHash = fContentHasher.Digest();
+	fContentSize = size;
+
+	// Minified or generated single line files
+	if (fLargeFileUserSet == false && fLargeFileMode == false
+			&& fTextScanner.LongestLine() >= kLargeFileLineLength) {
+		fLargeFileMode = true;
+		_ApplyLargeFileMode();
+	}
+
+	SendMessage(SCI_EMPTYUNDOBUFFER, UNSET, UNSET);
+	SendMessage(SCI_SETSAVEPOINT, UNSET, UNSET);
+	SendMessage(SCI_SETREADONLY, fLoadEditable == true ? 0 : 1, UNSET);
+
+	// Monitor node
+	StartMonitoring();
+
+	// Window only restores caret on already loaded buffers
+	SetSavedCaretPosition();
+
+	BMessage message(EDITOR_LOAD_DONE);
+	message.AddRef("ref", &fFileRef);
+	message.AddInt32("status", status);
+	message.AddInt64("size", size);
+	message.AddInt32("slices", fLoadSlices);
+	message.AddInt64("first_paint", fLoadFirstPaintTime);
+	message.AddInt64("elapsed", system_time() - fLoadStartTime);
+	message.AddUInt64("peak_memory", fLoadPeakMemory > fLoadBaseMemory
+		? fLoadPeakMemory - fLoadBaseMemory : 0);
+	message.AddString("encoding", fTextScanner.EncodingString());
+	message.AddBool("binary", fTextScanner.IsBinary());
+	message.AddBool("eol_mixed", fTextScanner.IsMixedEndOfLine());
+	message.AddInt64("longest_line", fTextScanner.LongestLine());
+	message.AddBool("large_file", fLargeFileMode);
+	fTarget.SendMessage(&message);
+}
+
+/*
+ * Append chunks until the file ends or the time slice expires, then
+ * either finish or schedule the next slice reporting progress.
+ * Document is kept read-only between slices.
+ */
+status_t
+Editor::_LoadSlice()
+{
+	bigtime_t sliceStart = system_time();
+	ssize_t bytes = 0;
+
+	SendMessage(SCI_SETREADONLY, 0, UNSET);
+	while (fLoadOffset < fLoadSize) {
+		if ((bytes = _LoadChunk()) <= 0)
+			break;
+		if (system_time() - sliceStart > kLoadSliceTime && Looper() != nullptr)
+			break;
+	}
+	SendMessage(SCI_SETREADONLY, 1, UNSET);
+
+	if (fLoadSlices++ == 0)
+		fLoadFirstPaintTime = system_time() - fLoadStartTime;
+
+	fLoadPeakMemory = std::max(fLoadPeakMemory, team_memory_usage());
+
+	if (bytes < 0 || fLoadOffset >= fLoadSize || bytes == 0) {
+		status_t status = B_OK;
+		if (bytes < 0)
+			status = bytes;
+		else if (fLoadOffset != fLoadSize)
+			status = B_ERROR;
+		_LoadFinish(status);
+		return status;
+	}
+
+	BMessage progress(EDITOR_LOAD_PROGRESS);
+	progress.AddRef("ref", &fFileRef);
+	progress.AddInt64("loaded", fLoadOffset);
+	progress.AddInt64("size", fLoadSize);
+	fTarget.SendMessage(&progress);
+
+	Looper()->PostMessage(MSG_LOAD_CHUNK, this);
+
+	return B_OK;
+}
+
+/*
+ * Write the document in ranges taken from scintilla's gap buffer, so
+ * the gap moves at most once and no copy of the text is made.
+ */
+ssize_t
+Editor::_WriteText(BFile& file)
+{
+	off_t size = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
+	off_t offset = 0;
+
+	fContentHasher.Reset();
+
+	while (offset < size) {
+		off_t length = std::min<off_t>(size - offset, kSaveChunkSize);
+		const char* text = reinterpret_cast<const char*>(
+			SendMessage(SCI_GETRANGEPOINTER, offset, length));
+
+		ssize_t bytes = file.Write(text, length);
+		if (bytes < 0)
+			return bytes;
+		if (bytes != length)
+			return B_IO_ERROR;
+
+		fContentHasher.Update(text, bytes);
+
+		offset += bytes;
+	}
+
+	return offset;
+}
+
 void
 Editor::_RedrawNumberMargin()
 {
@@ -1477,6 +2227,146 @@ Editor::_RedrawNumberMargin()
 	}
 }
 
+/*
+ * Compiled patterns are shared through TextRegex's cache, null if the
+ * pattern does not compile
+ */
+std::shared_ptr<const TextRegex>
+Editor::_Regex(const BString& pattern, int flags)
+{
+	auto regex = TextRegex::Compile(pattern, (flags & SCFIND_MATCHCASE) != 0,
+		(flags & SCFIND_WHOLEWORD) != 0);
+
+	if (regex->InitCheck() != B_OK)
+		return nullptr;
+
+	return regex;
+}
+
+/*
+ * Selection is exactly a match of regex
+ */
+bool
+Editor::_RegexSelected(const TextRegex& regex, TextRegex::match& found)
+{
+	const char* buffer = reinterpret_cast<const char*>(
+		SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+	size_t length = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
+	size_t start = SendMessage(SCI_GETSELECTIONSTART, UNSET, UNSET);
+	size_t end = SendMessage(SCI_GETSELECTIONEND, UNSET, UNSET);
+
+	return regex.MatchAt(buffer, length, start, found) == true
+		&& found.end == end;
+}
+
+/*
+ * Replace the whole buffer with file contents, undo history is lost
+ */
+status_t
+Editor::_ReloadFull()
+{
+	status_t status;
+
+	fLoadFile = new BFile();
+
+	//TODO errors should be notified
+	if ((status = fLoadFile->SetTo(&fFileRef, B_READ_ONLY)) != B_OK
+			|| (status = fLoadFile->Lock()) != B_OK) {
+		_LoadAbort();
+		return status;
+	}
+
+	// Enable external modifications of readonly file/buffer
+	bool readOnly = IsReadOnly();
+
+	if (readOnly == true)
+		SendMessage(SCI_SETREADONLY, 0, UNSET);
+
+	fLoadFile->GetSize(&fLoadSize);
+	fLoadOffset = 0;
+	fLoadBuffer = new char[std::max<off_t>(std::min<off_t>(fLoadSize,
+		kLoadChunkSize), 1)];
+
+	fTextScanner.Reset();
+	fContentHasher.Reset();
+
+	SendMessage(SCI_CLEARALL, UNSET, UNSET);
+	SendMessage(SCI_ALLOCATE, fLoadSize + 1, UNSET);
+
+	ssize_t bytes = 0;
+	while (fLoadOffset < fLoadSize && (bytes = _LoadChunk()) > 0)
+		;
+
+	if (readOnly == true)
+		SendMessage(SCI_SETREADONLY, 1, UNSET);
+
+	fTextScanner.Finish();
+	fContentHash = fContentHasher.Digest();
+	fContentSize = fLoadOffset;
+
+	bool complete = fLoadOffset == fLoadSize;
+
+	_LoadAbort();
+
+	if (bytes < 0 || complete == false)
+		return B_ERROR;
+
+	SendMessage(SCI_EMPTYUNDOBUFFER, UNSET, UNSET);
+	SendMessage(SCI_SETSAVEPOINT, UNSET, UNSET);
+
+	return B_OK;
+}
+
+/*
+ * As ReplaceAndFindNext, \0 to \9 in replacement are expanded from the
+ * replaced match
+ */
+int
+Editor::_ReplaceAndFindNextRegex(const BString& selection,
+	const BString& replacement, int flags, bool wrap)
+{
+	auto regex = _Regex(selection, flags);
+	if (regex == nullptr)
+		return REPLACE_NONE;
+
+	int retValue = REPLACE_NONE;
+	size_t position = SendMessage(SCI_GETCURRENTPOS, UNSET, UNSET);
+	TextRegex::match found;
+
+	if (_RegexSelected(*regex, found) == true) {
+		const char* buffer = reinterpret_cast<const char*>(
+			SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+		std::string expanded;
+		regex->Expand(replacement.String(), replacement.Length(), buffer,
+			found, expanded);
+
+		SendMessage(SCI_SETTARGETRANGE, found.start, found.end);
+		SendMessage(SCI_REPLACETARGET, expanded.size(), (sptr_t) expanded.data());
+
+		position = found.start + expanded.size();
+		// Do not replace an empty match twice
+		if (found.end == found.start)
+			position++;
+		retValue = REPLACE_DONE;
+	}
+
+	// Buffer may have moved
+	const char* buffer = reinterpret_cast<const char*>(
+		SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+	size_t length = SendMessage(SCI_GETLENGTH, UNSET, UNSET);
+
+	bool hit = regex->Search(buffer, length, position, found);
+	if (hit == false && wrap == true)
+		hit = regex->Search(buffer, length, 0, found);
+
+	if (hit == true) {
+		SendMessage(SCI_SETSEL, found.start, found.end);
+		retValue = REPLACE_DONE;
+	}
+
+	return retValue;
+}
+
 void
 Editor::_SetFoldMargin()
 {
@@ -11,13 +11,21 @@
 #include <ScintillaView.h>
 #include <String.h>
 
+#include <memory>
 #include <string>
 
+#include "TextRegex.h"
+#include "TextScanner.h"
+#include "TextSearch.h"
+#include "XXHash.h"
+
 enum {
 	EDITOR_FIND_COUNT				= 'Efco',
 	EDITOR_FIND_NEXT_MISS			= 'Efnm',
 	EDITOR_FIND_PREV_MISS			= 'Efpm',
-	EDITOR_FIND_SET_MARK			= 'Efsm',
+	EDITOR_INCREMENTAL_COUNT		= 'Eico',
+	EDITOR_LOAD_DONE				= 'Eldo',
+	EDITOR_LOAD_PROGRESS			= 'Elpr',
 	EDITOR_POSITION_CHANGED			= 'Epch',
 	EDITOR_PRETEND_POSITION_CHANGED	= 'Eppc',
 	EDITOR_REPLACE_ONE				= 'Eron',
@@ -48,6 +56,9 @@ constexpr auto sci_COMMENT_MARGIN = 3;
 
 constexpr auto sci_BOOKMARK = 0;
 
+// First of the container indicators
+constexpr auto sci_SEARCH_INDICATOR = 8;
+
 // Colors
 static constexpr auto kLineNumberBack = 0xD3D3D3;
 static constexpr auto kWhiteSpaceFore = 0x3030C0;
@@ -57,6 +68,27 @@ static constexpr auto kCaretLineBackColor = 0xF8EFE9;
 static constexpr auto kEdgeColor = 0xE0E0E0;
 static constexpr auto kMarkerForeColor = 0x80FFFF;
 static constexpr auto kMarkerBackColor = 0x3030C0;
+static constexpr auto kSearchIndicatorColor = 0x00A5FF;
+
+// File loading: chunk size and time slice after which the looper is
+// given back to the window (so big files get painted while loading)
+constexpr auto kLoadChunkSize = 1024 * 1024;
+constexpr auto kLoadSliceTime = 16000;
+
+// Incremental search: time slice after which the looper is given back,
+// bytes searched between time checks
+constexpr auto kIncrementalSliceTime = 3000;
+constexpr auto kIncrementalChunkSize = 64 * 1024;
+
+// Large file mode thresholds: expensive features are turned off beyond
+// file size or longest line length. Brace matching is bounded to a window
+constexpr auto kLargeFileSize = 8 * 1024 * 1024;
+constexpr auto kLargeFileLineLength = 32 * 1024;
+constexpr auto kLargeFileBraceWindow = 64 * 1024;
+
+// Saving: ranges written per call and temporary file suffix
+constexpr auto kSaveChunkSize = 1024 * 1024;
+constexpr auto kSaveTempSuffix = ".idmsave~";
 
 constexpr auto kNoBrace = 0;
 constexpr auto kBraceMatch = 1;
@@ -81,11 +113,14 @@ public:
 			bool				CanPaste();
 			bool				CanRedo();
 			bool				CanUndo();
+			uint64				ContentHash() { return fContentHash; }
+			off_t				ContentSize() { return fContentSize; }
 			void				Clear();
 			void				Copy();
 			int32				CountLines();
 			void				Cut();
 			BString	const		EndOfLineString();
+			BString const		EncodingString();
 			void				EndOfLineConvert(int32 eolMode);
 			void				EnsureVisiblePolicy();
 		const BString			FilePath() const;
@@ -98,7 +133,13 @@ public:
 			int32				GetCurrentPosition();
 			void				GoToLine(int32 line);
 			void				GrabFocus();
+			void				IncrementalSearch(const BString& text, int flags);
+			void				IncrementalSearchClear();
 			bool				IsFoldingAvailable() { return fFoldingAvailable; }
+			bool				IsBinary() { return fTextScanner.IsBinary(); }
+			bool				IsLargeFileMode() { return fLargeFileMode; }
+			bool				IsLoaded() { return fLoaded; }
+			bool				IsLoading() { return fLoading; }
 			bool				IsModified() { return fModified; }
 			bool				IsOverwrite();
 			BString const		IsOverwriteString();
@@ -123,8 +164,10 @@ public:
 			void 				ReplaceMessage(int position, const BString& selection,
 									const BString& replacement);
 			int					ReplaceOne(const BString& selection,
-									const BString& replacement);
+									const BString& replacement, int flags = 0);
 			ssize_t				SaveToFile();
+			void				SetLargeFileMode(bool enable);
+			bigtime_t			SaveSyncTime() { return fSaveSyncTime; }
 			void				ScrollCaret();
 			void				SelectAll();
 	const 	BString				Selection();
@@ -145,16 +188,37 @@ public:
 
 private:
 			void				_ApplyExtensionSettings();
+			void				_ApplyLargeFileMode();
 			void				_AutoIndentLine();
+			int32				_BraceMatch(int32 position);
 			void				_CheckForBraceMatching();
 			void				_CommentLine(int32 position);
 			int32				_EndOfLine();
-			void				_EndOfLineAssign(char *buffer, int32 size);
+			void				_EndOfLineAssign();
+			int					_FindRegex(const BString& text, int flags,
+									bool backwards);
 			void				_HighlightBraces();
 			void				_HighlightFile();
+			bool				_IncrementalFind(const char* buffer,
+									size_t length, size_t start, size_t before,
+									size_t& matchStart, size_t& matchEnd);
+			void				_IncrementalSlice();
 			bool				_IsBrace(char character);
+			void				_LoadAbort();
+			ssize_t				_LoadChunk();
+			void				_LoadFinish(status_t status);
+			status_t			_LoadSlice();
 			void				_RedrawNumberMargin();
+			std::shared_ptr<const TextRegex>	_Regex(const BString& pattern,
+									int flags);
+			bool				_RegexSelected(const TextRegex& regex,
+									TextRegex::match& found);
+			status_t			_ReloadFull();
+			int					_ReplaceAndFindNextRegex(const BString& selection,
+									const BString& replacement, int flags,
+									bool wrap);
 			void				_SetFoldMargin();
+			ssize_t				_WriteText(BFile& file);
 
 private:
 
@@ -175,6 +239,49 @@ private:
 
 			int					fCurrentLine;
 			int					fCurrentColumn;
+
+			bool				fLargeFileMode;
+			bool				fLargeFileUserSet;
+
+			// Chunked loading
+			BFile*				fLoadFile;
+			char*				fLoadBuffer;
+			off_t				fLoadSize;
+			off_t				fLoadOffset;
+			int32				fLoadSlices;
+			bool				fLoaded;
+			bool				fLoading;
+			bool				fLoadEditable;
+			bigtime_t			fLoadStartTime;
+			bigtime_t			fLoadFirstPaintTime;
+			size_t				fLoadBaseMemory;
+			size_t				fLoadPeakMemory;
+			TextScanner			fTextScanner;
+
+			bigtime_t			fSaveSyncTime;
+
+			// Incremental search: visible range marked first, then the whole
+			// of the document in slices
+			std::unique_ptr<TextSearch>	fIncrementalSearch;
+			std::shared_ptr<const TextRegex>	fIncrementalRegex;
+			BString				fIncrementalText;
+			uint32				fIncrementalGeneration;
+			bool				fIncrementalRunning;
+			int32				fIncrementalPass;
+			size_t				fIncrementalPosition;
+			size_t				fIncrementalEnd;
+			size_t				fIncrementalVisibleStart;
+			size_t				fIncrementalVisibleEnd;
+			size_t				fIncrementalAnchor;
+			ssize_t				fIncrementalFirst;
+			bool				fIncrementalSelected;
+			int32				fIncrementalCount;
+			bigtime_t			fIncrementalStartTime;
+
+			// Contents as last loaded or saved
+			XXHash64			fContentHasher;
+			uint64				fContentHash;
+			off_t				fContentSize;
 };
 
 #endif // EDITOR_H
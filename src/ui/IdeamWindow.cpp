@@ -11,6 +11,7 @@
 #include <Catalog.h>
 #include <IconUtils.h>
 #include <LayoutBuilder.h>
+#include <MessageRunner.h>
 #include <NodeMonitor.h>
 #include <Path.h>
 #include <PopUpMenu.h>
@@ -19,7 +20,9 @@
 #include <Roster.h>
 #include <SeparatorView.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -29,9 +32,12 @@
 #include "IdeamCommon.h"
 #include "IdeamNamespace.h"
 #include "NewProjectWindow.h"
+#include "ProjectItem.h"
 #include "ProjectSettingsWindow.h"
 #include "SettingsWindow.h"
 #include "TPreferences.h"
+#include "TextRegex.h"
+#include "XXHash.h"
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "IdeamWindow"
@@ -52,6 +58,14 @@ static constexpr auto kFindReplaceMinBytes = 32;
 static constexpr float kFindReplaceOPSize = 120.0f;
 static constexpr auto kFindReplaceMenuItems = 10;
 
+// Session restore: delay between placeholder tabs loads
+static constexpr bigtime_t kEditorPrefetchDelay = 150000;
+
+// External modifications: read size when rehashing a file and time
+// node monitor events are merged for
+static constexpr auto kRehashChunkSize = 1024 * 1024;
+static constexpr bigtime_t kNodeMonitorDelay = 100000;
+
 static float kProjectsWeight  = 1.0f;
 static float kEditorWeight  = 3.14f;
 static float kOutputWeight  = 0.4f;
@@ -84,6 +98,7 @@ enum {
 	MSG_TEXT_OVERWRITE			= 'teov',
 	MSG_WHITE_SPACES_TOGGLE		= 'whsp',
 	MSG_LINE_ENDINGS_TOGGLE		= 'lien',
+	MSG_LARGE_FILE_MODE_TOGGLE	= 'lfmt',
 	MSG_EOL_CONVERT_TO_UNIX		= 'ectu',
 	MSG_EOL_CONVERT_TO_DOS		= 'ectd',
 	MSG_EOL_CONVERT_TO_MAC		= 'ectm',
@@ -98,6 +113,7 @@ enum {
 	MSG_FIND_PREVIOUS			= 'fipr',
 	MSG_FIND_MARK_ALL			= 'fmal',
 	MSG_FIND_NEXT				= 'fite',
+	MSG_FIND_TEXT_MODIFIED		= 'fitm',
 	MSG_REPLACE_GROUP_SHOW		= 'regs',
 	MSG_REPLACE_MENU_SELECTED 	= 'rmse',
 	MSG_REPLACE_ONE				= 'reon',
@@ -156,9 +172,70 @@ enum {
 	MSG_SHOW_HIDE_PROJECTS			= 'shpr',
 	MSG_SHOW_HIDE_OUTPUT			= 'shou',
 
-	MSG_SELECT_TAB				= 'seta'
+	MSG_SELECT_TAB				= 'seta',
+
+	// Session restore
+	MSG_EDITOR_PREFETCH			= 'edpf',
+
+	// External modifications
+	MSG_FILE_REHASHED			= 'firh',
+	MSG_NODE_MONITOR_FLUSH		= 'nmfl',
+
+	// Search results
+	MSG_SEARCH_RESULT_INVOKED	= 'srin',
+
+	// Build problems
+	MSG_PROBLEM_INVOKED			= 'prin'
+};
+
+struct rehash_data {
+	entry_ref	ref;
+	off_t		size;
+	BMessenger	target;
 };
 
+/*
+ * Hash file contents off the window thread. If size differs from the
+ * loaded one contents are different anyway, so hashing is skipped.
+ */
+static status_t
+rehash_file_thread(void* data)
+{
+	rehash_data* rehash = static_cast<rehash_data*>(data);
+
+	BMessage message(MSG_FILE_REHASHED);
+	message.AddRef("ref", &rehash->ref);
+
+	BFile file(&rehash->ref, B_READ_ONLY);
+	off_t size = 0;
+	status_t status = file.InitCheck();
+
+	if (status == B_OK && (status = file.GetSize(&size)) == B_OK) {
+		message.AddInt64("size", size);
+
+		if (size == rehash->size) {
+			XXHash64 hasher;
+			char* buffer = new char[kRehashChunkSize];
+			ssize_t bytes;
+			while ((bytes = file.Read(buffer, kRehashChunkSize)) > 0)
+				hasher.Update(buffer, bytes);
+			delete[] buffer;
+
+			if (bytes < 0)
+				status = bytes;
+			else
+				message.AddUInt64("hash", hasher.Digest());
+		}
+	}
+
+	message.AddInt32("status", status);
+	rehash->target.SendMessage(&message);
+
+	delete rehash;
+
+	return B_OK;
+}
+
 class ProjectRefFilter : public BRefFilter {
 
 public:
@@ -184,7 +261,15 @@ IdeamWindow::IdeamWindow(BRect frame)
 	, fConsoleIOThread(nullptr)
 	, fBuildLogView(nullptr)
 	, fConsoleIOView(nullptr)
+	, fProblemsView(nullptr)
+	, fNodeFlushScheduled(false)
+	, fNodeEventsReceived(0)
+	, fNodeEventsActed(0)
+	, fPendingGoToLine(-1)
+	, fProjectIndex(nullptr)
 {
+	fFileSearcher = new FileSearcher(BMessenger(this));
+
 	// Settings file check.
 	BPath path;
 	find_directory(B_USER_SETTINGS_DIRECTORY, &path);
@@ -247,6 +332,8 @@ IdeamWindow::IdeamWindow(BRect frame)
 
 			if (files.FindInt32("opened_index", &index) == B_OK) {
 				message->AddInt32("opened_index", index);
+				// Only the selected tab is loaded now, see _FileOpen
+				message->AddBool("deferred", true);
 
 				for (count = 0; files.FindRef("file_to_reopen", count, &ref) == B_OK; count++)
 					message->AddRef("refs", &ref);
@@ -260,6 +347,8 @@ IdeamWindow::IdeamWindow(BRect frame)
 
 IdeamWindow::~IdeamWindow()
 {
+	delete fFileSearcher;
+	delete fProjectIndex;
 	delete fEditorObjectList;
 	delete fTabManager;
 
@@ -287,6 +376,7 @@ IdeamWindow::DispatchMessage(BMessage* message, BHandler* handler)
 					}
 					#else
 					{
+						_FindIncrementalClear();
 						fFindGroup->SetVisible(false);
 						fReplaceGroup->SetVisible(false);
 					}
@@ -372,6 +462,9 @@ IdeamWindow::MessageReceived(BMessage* message)
 		case B_NODE_MONITOR:
 			_HandleNodeMonitorMsg(message);
 			break;
+		case MSG_NODE_MONITOR_FLUSH:
+			_FlushNodeMonitorEvents();
+			break;
 		case B_PASTE: {
 			int32 index = fTabManager->SelectedTabIndex();
 
@@ -419,6 +512,39 @@ IdeamWindow::MessageReceived(BMessage* message)
 			}
 			break;
 		}
+		case CONSOLEIOVIEW_OUTPUT_STATS: {
+			const bigtime_t elapsed = message->GetInt64("elapsed", 0);
+			const int64 lines = message->GetInt64("lines", 0);
+
+			BString notification;
+			notification << message->GetString("name", "") << ":  "
+				<< lines << " " << B_TRANSLATE("lines") << ", "
+				<< (elapsed > 0 ? lines * 1000000 / elapsed : lines) << " "
+				<< B_TRANSLATE("lines/s") << ", "
+				<< message->GetInt32("dropped", 0) << "/"
+				<< message->GetInt32("frames", 0) << " "
+				<< B_TRANSLATE("frames dropped") << ", "
+				<< message->GetInt32("stalls", 0) << " "
+				<< B_TRANSLATE("stalls");
+			_SendNotification(notification, "CONSOLE_STATS");
+			break;
+		}
+		case DIAGNOSTICSPARSER_FOUND: {
+			fProblemsView->AddDiagnostics(message);
+			_UpdateProblemsTab();
+
+			if (message->GetBool("done", false) == true
+				&& fProblemsView->CountErrors() + fProblemsView->CountWarnings() > 0) {
+				BString notification;
+				notification << B_TRANSLATE("Build problems:") << "  "
+					<< fProblemsView->CountErrors() << " "
+					<< B_TRANSLATE("errors") << ", "
+					<< fProblemsView->CountWarnings() << " "
+					<< B_TRANSLATE("warnings");
+				_SendNotification(notification, "PROJ_BUILD");
+			}
+			break;
+		}
 		case CONSOLEIOTHREAD_ERROR:
 		case CONSOLEIOTHREAD_EXIT:
 		case CONSOLEIOTHREAD_STOP:
@@ -453,23 +579,6 @@ IdeamWindow::MessageReceived(BMessage* message)
 			}
 			break;
 		}
-		case EDITOR_FIND_SET_MARK: {
-			entry_ref ref;
-			if (message->FindRef("ref", &ref) == B_OK) {
-				int32 index = _GetEditorIndex(&ref);
-				if (index == fTabManager->SelectedTabIndex()) {
-					fEditor = fEditorObjectList->ItemAt(index);
-
-					int32 line;
-					if (message->FindInt32("line", &line) == B_OK) {
-						BString text;
-						text << fEditor->Name() << " :" << line;
-						_SendNotification(text, "FIND_MARK");
-					}
-				}
-			}
-			break;
-		}
 		case EDITOR_FIND_NEXT_MISS: {
 			_SendNotification(B_TRANSLATE("Find next not found"),
 													"FIND_MISS");
@@ -492,8 +601,124 @@ IdeamWindow::MessageReceived(BMessage* message)
 					<< B_TRANSLATE("occurrences found:")
 					<< " " << count;
 
-				_ShowLog(kNotificationLog);
 				_SendNotification(notification, "FIND_COUNT");
+
+				_ShowSearchResultLines(message);
+			}
+			break;
+		}
+		case EDITOR_INCREMENTAL_COUNT: {
+			entry_ref ref;
+			BString text;
+			int32 count;
+			if (message->FindRef("ref", &ref) == B_OK
+				&& _GetEditorIndex(&ref) == fTabManager->SelectedTabIndex()
+				&& message->FindString("text", &text) == B_OK
+				&& message->FindInt32("count", &count) == B_OK) {
+				BString status;
+				status << "  \"" << text << "\"  "
+					<< B_TRANSLATE("matches:") << " " << count;
+				fStatusBar->SetText(status.String());
+			}
+			break;
+		}
+		case EDITOR_LOAD_DONE: {
+			entry_ref ref;
+			if (message->FindRef("ref", &ref) == B_OK) {
+				int32 index = _GetEditorIndex(&ref);
+				if (index < 0)
+					break;
+				fEditor = fEditorObjectList->ItemAt(index);
+				// Monitoring started on load, node is known now
+				_EditorIndexAdd(fEditor);
+
+				int32 status = B_OK;
+				int64 size = 0, firstPaint = 0, elapsed = 0;
+				uint64 peakMemory = 0;
+				message->FindInt32("status", &status);
+				message->FindInt64("size", &size);
+				message->FindInt64("first_paint", &firstPaint);
+				message->FindInt64("elapsed", &elapsed);
+				message->FindUInt64("peak_memory", &peakMemory);
+
+				BString notification;
+				if (status != B_OK) {
+					notification << B_TRANSLATE("File load error:") << "  "
+						<< fEditor->Name() << " " << strerror(status);
+					_SendNotification(notification, "FILE_ERR");
+				} else {
+					notification << B_TRANSLATE("File load:") << "  "
+						<< fEditor->Name() << " "
+						<< size / 1024 << " KiB, "
+						<< B_TRANSLATE("first paint") << " "
+						<< firstPaint / 1000 << " ms, "
+						<< B_TRANSLATE("total") << " "
+						<< elapsed / 1000 << " ms, "
+						<< B_TRANSLATE("peak memory") << " +"
+						<< peakMemory / 1024 << " KiB";
+					_SendNotification(notification, "FILE_LOAD");
+
+					BString encoding;
+					message->FindString("encoding", &encoding);
+
+					if (message->GetBool("binary", false) == true) {
+						notification.SetTo("");
+						notification << B_TRANSLATE("File info:") << "  "
+							<< fEditor->Name() << " "
+							<< B_TRANSLATE("contains NUL bytes, looks like a binary file");
+						_SendNotification(notification, "FILE_INFO");
+					} else if (encoding != "ASCII" && encoding != "UTF-8") {
+						notification.SetTo("");
+						notification << B_TRANSLATE("File info:") << "  "
+							<< fEditor->Name() << " "
+							<< B_TRANSLATE("is not UTF-8, detected encoding:")
+							<< " " << encoding;
+						_SendNotification(notification, "FILE_INFO");
+					}
+					if (message->GetBool("large_file", false) == true) {
+						notification.SetTo("");
+						notification << B_TRANSLATE("File info:") << "  "
+							<< fEditor->Name() << " "
+							<< B_TRANSLATE("opened in large file mode");
+						_SendNotification(notification, "FILE_INFO");
+					}
+					if (message->GetBool("eol_mixed", false) == true) {
+						notification.SetTo("");
+						notification << B_TRANSLATE("File info:") << "  "
+							<< fEditor->Name() << " "
+							<< B_TRANSLATE("has mixed line endings, using") << " "
+							<< fEditor->EndOfLineString();
+						_SendNotification(notification, "FILE_INFO");
+					}
+				}
+
+				if (fPendingGoToLine > 0 && ref == fPendingGoToRef) {
+					fEditor->GoToLine(fPendingGoToLine);
+					fEditor->GrabFocus();
+					fPendingGoToLine = -1;
+				}
+
+				if (index == fTabManager->SelectedTabIndex()) {
+					fEditor->SendCurrentPosition();
+					_UpdateStatusBarTrailing(index);
+					_UpdateTabChange(index, "EDITOR_LOAD_DONE");
+				}
+			}
+			break;
+		}
+		case EDITOR_LOAD_PROGRESS: {
+			entry_ref ref;
+			if (message->FindRef("ref", &ref) == B_OK) {
+				int32 index = _GetEditorIndex(&ref);
+				int64 loaded, size;
+				if (index == fTabManager->SelectedTabIndex()
+					&& message->FindInt64("loaded", &loaded) == B_OK
+					&& message->FindInt64("size", &size) == B_OK && size > 0) {
+					BString text;
+					text << "  " << B_TRANSLATE("Loading:") << " "
+						<< loaded * 100 / size << "%";
+					fStatusBar->SetText(text.String());
+				}
 			}
 			break;
 		}
@@ -515,11 +740,16 @@ IdeamWindow::MessageReceived(BMessage* message)
 		case EDITOR_REPLACE_ALL_COUNT: {
 			int32 count;
 			if (message->FindInt32("count", &count) == B_OK) {
-				BString notification;
+				BString notification, selection, replacement;
 				notification << B_TRANSLATE("Replacements done:") << " " << count;
+				if (message->FindString("selection", &selection) == B_OK
+					&& message->FindString("replacement", &replacement) == B_OK)
+					notification << "  \"" << selection << "\" => \""
+						<< replacement << "\"";
 
-				_ShowLog(kNotificationLog);
 				_SendNotification(notification, "REPL_COUNT");
+
+				_ShowSearchResultLines(message);
 			}
 			break;
 		}
@@ -580,6 +810,53 @@ IdeamWindow::MessageReceived(BMessage* message)
 
 			break;
 		}
+		case FILE_SEARCH_DONE: {
+			if (message->GetInt32("generation", -1) != fFileSearcher->Generation())
+				break;
+
+			BString notification;
+			notification << B_TRANSLATE("Find in files:") << "  \""
+				<< fFindInFilesText << "\"  "
+				<< message->GetInt32("matches", 0) << " "
+				<< B_TRANSLATE("matching lines in") << " "
+				<< fSearchResultsView->CountFiles() << "/"
+				<< message->GetInt32("files", 0) << " "
+				<< B_TRANSLATE("files") << ", "
+				<< message->GetInt32("binaries", 0) << " "
+				<< B_TRANSLATE("binaries skipped") << ", "
+				<< message->GetInt64("elapsed", 0) / 1000 << " ms";
+			if (message->GetBool("canceled", false) == true)
+				notification << " (" << B_TRANSLATE("canceled") << ")";
+			_SendNotification(notification, "FIND_FILES");
+			break;
+		}
+		case PROJECT_PARSER_SCAN_DONE: {
+			BString projectName;
+			if (message->FindString("project_name", &projectName) == B_OK)
+				_ProjectRescanDone(projectName);
+			break;
+		}
+		case FILE_SEARCH_RESULTS: {
+			if (message->GetInt32("generation", -1) != fFileSearcher->Generation())
+				break;
+
+			int32 file, line;
+			BString text;
+			for (int32 i = 0; message->FindInt32("file", i, &file) == B_OK
+					&& message->FindInt32("line", i, &line) == B_OK
+					&& message->FindString("text", i, &text) == B_OK; i++) {
+				// Searcher file index to results view file index
+				if (fSearchResultFiles[file] < 0) {
+					entry_ref ref;
+					if (get_ref_for_path(fFileSearcher->FileAt(file), &ref) != B_OK)
+						continue;
+					fSearchResultFiles[file] = fSearchResultsView->AddFile(ref);
+				}
+				fSearchResultsView->AddMatch(fSearchResultFiles[file], line, text);
+			}
+			fSearchResultsView->Update();
+			break;
+		}
 		case MSG_BOOKMARK_CLEAR_ALL: {
 			int32 index =  fTabManager->SelectedTabIndex();
 
@@ -775,6 +1052,35 @@ IdeamWindow::MessageReceived(BMessage* message)
 				delete tabMenu;
 			break;
 		}
+		case MSG_EDITOR_PREFETCH: {
+			// Load one placeholder per round, so the window stays responsive.
+			// Rounds move forward so a failing file is not retried
+			int32 index = message->GetInt32("index", 0);
+			if (index < fEditorObjectList->CountItems())
+				_EditorLoad(index);
+			_EditorPrefetch(index + 1);
+			break;
+		}
+		case MSG_FILE_REHASHED: {
+			entry_ref ref;
+			if (message->FindRef("ref", &ref) != B_OK)
+				break;
+
+			fRehashPending.erase(ref);
+
+			int32 index = _GetEditorIndex(&ref);
+			if (index < 0)
+				break;
+
+			// Changed again while hashing, start over
+			if (fRehashAgain.erase(ref) > 0) {
+				_FileRehash(index);
+				break;
+			}
+
+			_HandleExternalStatModification(index, message);
+			break;
+		}
 		case MSG_FILE_NEW: {
 			//TODO
 			break;
@@ -842,9 +1148,15 @@ IdeamWindow::MessageReceived(BMessage* message)
 			_FindNext(text, true);
 			break;
 		}
+		case MSG_FIND_TEXT_MODIFIED:
+			_FindIncremental();
+			break;
 		case MSG_FIND_GROUP_TOGGLED:
 			_FindGroupToggled();
 			break;
+		case MSG_FIND_IN_FILES:
+			_FindInFiles();
+			break;
 		case MSG_GIT_COMMAND: {
 			BString command;
 			if (message->FindString("command", &command) == B_OK)
@@ -855,6 +1167,18 @@ IdeamWindow::MessageReceived(BMessage* message)
 			fGotoLine->Show();
 			fGotoLine->MakeFocus();
 			break;
+		case MSG_LARGE_FILE_MODE_TOGGLE: {
+			int32 index = fTabManager->SelectedTabIndex();
+
+			if (index > -1 && index < fTabManager->CountTabs()) {
+				fEditor = fEditorObjectList->ItemAt(index);
+				fEditor->SetLargeFileMode(!fEditor->IsLargeFileMode());
+				fLargeFileModeItem->SetMarked(fEditor->IsLargeFileMode());
+				_UpdateStatusBarTrailing(index);
+				_UpdateTabChange(index, "MSG_LARGE_FILE_MODE_TOGGLE");
+			}
+			break;
+		}
 		case MSG_LINE_ENDINGS_TOGGLE: {
 			int32 index = fTabManager->SelectedTabIndex();
 
@@ -956,6 +1280,16 @@ IdeamWindow::MessageReceived(BMessage* message)
 			break;
 		}
 		case MSG_PROJECT_MENU_OPEN_FILE: {
+			// Directories are toggled
+			ProjectItem* item = dynamic_cast<ProjectItem*>(
+				fProjectsOutline->ItemAt(fProjectsOutline->CurrentSelection()));
+			if (item != nullptr && item->IsDirectory() == true) {
+				if (item->IsExpanded() == true)
+					fProjectsOutline->Collapse(item);
+				else
+					fProjectsOutline->Expand(item);
+				break;
+			}
 			_ProjectFileOpen(_ProjectFileFullPath());
 			break;
 		}
@@ -1031,6 +1365,34 @@ IdeamWindow::MessageReceived(BMessage* message)
 		case MSG_RUN_TARGET:
 			_RunTarget();
 			break;
+		case MSG_PROBLEM_INVOKED:
+		case MSG_SEARCH_RESULT_INVOKED: {
+			entry_ref ref;
+			int32 line;
+			if (message->FindRef("ref", &ref) == B_OK
+				&& message->FindInt32("line", &line) == B_OK) {
+				int32 index = _GetEditorIndex(&ref);
+				if (index < 0) {
+					BMessage refs(B_REFS_RECEIVED);
+					refs.AddRef("refs", &ref);
+					_FileOpen(&refs);
+					if ((index = _GetEditorIndex(&ref)) < 0)
+						break;
+				}
+				if (index != fTabManager->SelectedTabIndex())
+					fTabManager->SelectTab(index);
+				fEditor = fEditorObjectList->ItemAt(index);
+				// Loading is chunked, go to line when done
+				if (fEditor->IsLoading() == true) {
+					fPendingGoToRef = ref;
+					fPendingGoToLine = line;
+					break;
+				}
+				fEditor->GoToLine(line);
+				fEditor->GrabFocus();
+			}
+			break;
+		}
 		case MSG_SELECT_TAB: {
 			int32 index;
 			// Shortcut selection, be careful
@@ -1134,6 +1496,14 @@ IdeamWindow::MessageReceived(BMessage* message)
 // std::cerr << "TABMANAGER_TAB_SELECTED " << "NULL on index: " << index << std::endl;
 					break;
 				}	
+				// Placeholder tab from session restore. Selection messages are
+				// queued: the first tab added gets one even when restore
+				// selects another, leave it for the prefetch
+				if (fEditor->IsLoaded() == false && fEditor->IsLoading() == false) {
+					if (index != fTabManager->SelectedTabIndex())
+						break;
+					_EditorLoad(index);
+				}
 				fEditor->GrabFocus();
 				// In multifile open not-focused files place scroll just after
 				// caret line when reselected. Ensure visibility.
@@ -1158,7 +1528,9 @@ IdeamWindow::MessageReceived(BMessage* message)
 			if (message->FindInt32("index", &index) == B_OK) {
 // std::cerr << "TABMANAGER_TAB_NEW_OPENED" << " index: " << index << std::endl;
 				fEditor = fEditorObjectList->ItemAt(index);
-				fEditor->SetSavedCaretPosition();
+				// Placeholders and sliced loads restore caret on load done
+				if (fEditor->IsLoaded() == true)
+					fEditor->SetSavedCaretPosition();
 			}
 			break;
 		}
@@ -1213,6 +1585,10 @@ IdeamWindow::QuitRequested()
 		}
 	}
 
+	// Scans write their project file
+	while (fProjectScans.empty() == false)
+		_ProjectRescanWait(fProjectScans.begin()->first);
+
 	// Projects to reopen
 	if (IdeamNames::Settings.reopen_projects == true) {
 
@@ -1257,6 +1633,8 @@ IdeamWindow::_AddEditorTab(entry_ref* ref, int32 index)
 
 	assert(added == true);
 
+	_EditorIndexAdd(fEditor);
+
 	return B_OK;
 }
 
@@ -1275,6 +1653,9 @@ IdeamWindow::_BuildProject()
 	fBuildLogView->Clear();
 	_ShowLog(kBuildLog);
 
+	fProblemsView->Clear();
+	_UpdateProblemsTab();
+
 	BString text;
 	text << "Build started: "  << fActiveProject->ExtensionedName();
 	_SendNotification(text, "PROJ_BUILD");
@@ -1291,6 +1672,8 @@ IdeamWindow::_BuildProject()
 	BMessage message;
 	message.AddString("cmd", command);
 	message.AddString("cmd_type", "build");
+	message.AddBool("diagnostics", true);
+	message.AddString("directory", fActiveProject->BasePath());
 
 	// Go to appropriate directory
 	chdir(fActiveProject->BasePath());
@@ -1376,28 +1759,6 @@ IdeamWindow::_CleanProject()
 	return status;
 }
 
-/*static*/ int
-IdeamWindow::_CompareListItems(const BListItem* a, const BListItem* b)
-{
-	if (a == b)
-		return 0;
-
-	const BStringItem* A = dynamic_cast<const BStringItem*>(a);
-	const BStringItem* B = dynamic_cast<const BStringItem*>(b);
-	const char* nameA = A->Text();
-	const char* nameB = B->Text();
-
-	// Or use strcasecmp?
-	if (nameA != NULL && nameB != NULL)
-		return strcmp(nameA, nameB);
-	if (nameA != NULL)
-		return 1;
-	if (nameB != NULL)
-		return -1;
-
-	return (addr_t)a > (addr_t)b ? 1 : -1;
-}
-
 status_t
 IdeamWindow::_DebugProject()
 {
@@ -1419,6 +1780,129 @@ IdeamWindow::_DebugProject()
 	return B_OK;
 }
 
+/*
+ * (Re)index an editor by its ref, resolved ref and node ref.
+ * Called whenever any of them may have changed.
+ */
+void
+IdeamWindow::_EditorIndexAdd(Editor* editor)
+{
+	editor_keys keys;
+
+	// Position is known when reindexing, new editors are appended
+	auto known = fEditorKeys.find(editor);
+	if (known != fEditorKeys.end())
+		keys.index = known->second.index;
+	else if (fEditorObjectList->LastItem() == editor)
+		keys.index = fEditorObjectList->CountItems() - 1;
+	else
+		keys.index = fEditorObjectList->IndexOf(editor);
+
+	_EditorIndexRemove(editor);
+
+	keys.ref = *editor->FileRef();
+	keys.nref = *editor->NodeRef();
+
+	BEntry entry(&keys.ref, true);
+	if (entry.GetRef(&keys.resolved) != B_OK)
+		keys.resolved = keys.ref;
+
+	fEditorsByRef[keys.ref] = keys.index;
+	fEditorsByRef[keys.resolved] = keys.index;
+	// Node is known once monitoring started
+	if (keys.nref.node >= 0)
+		fEditorsByNode[keys.nref] = keys.index;
+
+	fEditorKeys[editor] = keys;
+}
+
+void
+IdeamWindow::_EditorIndexRemove(Editor* editor)
+{
+	auto found = fEditorKeys.find(editor);
+	if (found == fEditorKeys.end())
+		return;
+
+	const editor_keys& keys = found->second;
+
+	// Keys could have been taken over by another editor meanwhile
+	auto ref = fEditorsByRef.find(keys.ref);
+	if (ref != fEditorsByRef.end() && ref->second == keys.index)
+		fEditorsByRef.erase(ref);
+	ref = fEditorsByRef.find(keys.resolved);
+	if (ref != fEditorsByRef.end() && ref->second == keys.index)
+		fEditorsByRef.erase(ref);
+	auto node = fEditorsByNode.find(keys.nref);
+	if (node != fEditorsByNode.end() && node->second == keys.index)
+		fEditorsByNode.erase(node);
+
+	fEditorKeys.erase(found);
+}
+
+/*
+ * Editors after a closed one move back a position
+ */
+void
+IdeamWindow::_EditorIndexShift(int32 removed)
+{
+	for (auto& ref : fEditorsByRef)
+		if (ref.second > removed)
+			ref.second--;
+	for (auto& node : fEditorsByNode)
+		if (node.second > removed)
+			node.second--;
+	for (auto& keys : fEditorKeys)
+		if (keys.second.index > removed)
+			keys.second.index--;
+}
+
+/*
+ * Load a placeholder editor created at session restore
+ */
+status_t
+IdeamWindow::_EditorLoad(int32 index)
+{
+	Editor* editor = fEditorObjectList->ItemAt(index);
+
+	if (editor == nullptr)
+		return B_ERROR;
+
+	if (editor->IsLoaded() == true || editor->IsLoading() == true)
+		return B_OK;
+
+	status_t status = editor->LoadFromFile();
+
+	if (status != B_OK) {
+		BString notification;
+		notification << B_TRANSLATE("File load error:") << "  "
+			<< editor->Name() << " " << strerror(status);
+		_SendNotification(notification, "FILE_ERR");
+		return status;
+	}
+
+	editor->ApplySettings();
+
+	return B_OK;
+}
+
+/*
+ * Schedule loading of the next placeholder editor from index on, if any
+ */
+void
+IdeamWindow::_EditorPrefetch(int32 from)
+{
+	for (int32 index = from; index < fEditorObjectList->CountItems(); index++) {
+		Editor* editor = fEditorObjectList->ItemAt(index);
+		if (editor->IsLoaded() == false && editor->IsLoading() == false) {
+			BMessage message(MSG_EDITOR_PREFETCH);
+			message.AddInt32("index", index);
+			BMessageRunner::StartSending(BMessenger(this), &message,
+				kEditorPrefetchDelay, 1);
+			return;
+		}
+	}
+}
+
 /*
  * ignoreModifications: the file is modified but has been removed
  * 						externally and user choose to discard it.
@@ -1467,7 +1951,9 @@ IdeamWindow::_FileClose(int32 index, bool ignoreModifications /* = false */)
 
 	BView* view = fTabManager->RemoveTab(index);
 	Editor* editorView = dynamic_cast<Editor*>(view);
+	_EditorIndexRemove(editorView);
 	fEditorObjectList->RemoveItem(fEditorObjectList->ItemAt(index));
+	_EditorIndexShift(index);
 	delete editorView;
 
 	// Was it the last one?
@@ -1507,6 +1993,8 @@ IdeamWindow::_FileOpen(BMessage* msg)
 	if (msg->FindInt32("opened_index", &nextIndex) != B_OK)
 		nextIndex = fTabManager->CountTabs();
 
+	bool deferred = msg->GetBool("deferred", false);
+
 	while (msg->FindRef("refs", refsCount, &ref) == B_OK) {
 
 		// If it's a project, just open that
@@ -1543,17 +2031,20 @@ IdeamWindow::_FileOpen(BMessage* msg)
 			return B_ERROR;
 		}
 
-		status = fEditor->LoadFromFile();
+		// Session restore: tab is a placeholder until selected or prefetched
+		if (deferred == false) {
+			status = fEditor->LoadFromFile();
 
-		if (status != B_OK) {
-			continue;
-		}
+			if (status != B_OK) {
+				continue;
+			}
 
-		fEditor->ApplySettings();
+			fEditor->ApplySettings();
 
-		// First tab gets selected by tabview
-		if (index > 0)
-			fTabManager->SelectTab(index);
+			// First tab gets selected by tabview
+			if (index > 0)
+				fTabManager->SelectTab(index);
+		}
 
 		notification << B_TRANSLATE("File open:")  << "  "
 			<< fEditor->Name()
@@ -1567,9 +2058,51 @@ IdeamWindow::_FileOpen(BMessage* msg)
 	if (nextIndex < fTabManager->CountTabs())
 		fTabManager->SelectTab(nextIndex);
 
+	// Load the selected tab now and the others when idle
+	if (deferred == true) {
+		if (nextIndex < fTabManager->CountTabs())
+			status = _EditorLoad(nextIndex);
+		_EditorPrefetch(0);
+	}
+
 	return status;
 }
 
+/*
+ * Rehash an open file on a separate thread, MSG_FILE_REHASHED brings
+ * the result back. Requests for a file already being hashed are merged.
+ */
+void
+IdeamWindow::_FileRehash(int32 index)
+{
+	Editor* editor = fEditorObjectList->ItemAt(index);
+
+	if (editor == nullptr)
+		return;
+
+	entry_ref ref = *editor->FileRef();
+
+	if (fRehashPending.find(ref) != fRehashPending.end()) {
+		fRehashAgain.insert(ref);
+		return;
+	}
+
+	rehash_data* data = new rehash_data;
+	data->ref = ref;
+	data->size = editor->ContentSize();
+	data->target = BMessenger(this);
+
+	thread_id thread = spawn_thread(rehash_file_thread, "file rehash",
+		B_LOW_PRIORITY, data);
+
+	if (thread < B_OK || resume_thread(thread) != B_OK) {
+		delete data;
+		return;
+	}
+
+	fRehashPending.insert(ref);
+}
+
 status_t
 IdeamWindow::_FileSave(int32 index)
 {
@@ -1591,6 +2124,14 @@ IdeamWindow::_FileSave(int32 index)
 		return B_ERROR;
 	}
 
+	// Saving a partially loaded buffer would truncate the file
+	if (fEditor->IsLoading()) {
+		notification << fEditor->Name() << " "
+			<< (B_TRANSLATE("is still loading"));
+		_SendNotification(notification, "FILE_ERR");
+		return B_ERROR;
+	}
+
 	// Readonly file, should not happen
 	if (fEditor->IsReadOnly()) {
 		notification << (B_TRANSLATE("File is Read-only"));
@@ -1608,11 +2149,15 @@ IdeamWindow::_FileSave(int32 index)
 	// Stop monitoring if needed
 	fEditor->StopMonitoring();
 
+	bigtime_t saveStart = system_time();
 	ssize_t written = fEditor->SaveToFile();
+	bigtime_t elapsed = system_time() - saveStart;
 	ssize_t length = fEditor->SendMessage(SCI_GETLENGTH, 0, 0);
 
-	// Restart monitoring
+	// Restart monitoring, saving through a temporary file changed the node
 	fEditor->StartMonitoring();
+	_EditorIndexAdd(fEditor);
+	_ProjectIndexUpdateFile(fEditor->FileRef());
 
 	notification << B_TRANSLATE("File save:")  << "  "
 		<< fEditor->Name()
@@ -1623,7 +2168,14 @@ IdeamWindow::_FileSave(int32 index)
 		<< " -> "
 		<< written
 		<< " "
-		<< B_TRANSLATE("written");
+		<< B_TRANSLATE("written")
+		<< "  ("
+		<< elapsed / 1000
+		<< " ms, "
+		<< B_TRANSLATE("sync")
+		<< " "
+		<< fEditor->SaveSyncTime() / 1000
+		<< " ms)";
 
 	_SendNotification(notification, length == written ? "FILE_SAVE" : "FILE_ERR");
 
@@ -1684,6 +2236,7 @@ IdeamWindow::_FileSaveAs(int32 selection, BMessage* message)
 	}
 
 	fEditor->SetFileRef(&newRef);
+	_EditorIndexAdd(fEditor);
 	fTabManager->SetTabLabel(selection, fEditor->Name().String());
 
 	/* Modified files 'Saved as' get saved to an unmodified state.
@@ -1731,6 +2284,7 @@ IdeamWindow::_FindGroupToggled()
 		_GetFocusAndSelection(fFindTextControl);
 	}
 	else {
+		_FindIncrementalClear();
 		if (fReplaceGroup->IsVisible())
 			fReplaceGroup->SetVisible(false);
 		int32 index = fTabManager->SelectedTabIndex();
@@ -1741,14 +2295,151 @@ IdeamWindow::_FindGroupToggled()
 	}
 }
 
+/*
+ * Search the active project files on the searcher's worker pool.
+ * Modified editors are searched from their buffer. Invoking again while
+ * running cancels.
+ */
+void
+IdeamWindow::_FindInFiles()
+{
+	if (fFileSearcher->IsRunning() == true) {
+		fFileSearcher->Cancel();
+		return;
+	}
+
+	BString text(fFindTextControl->Text());
+	if (text.IsEmpty() || fActiveProject == nullptr) {
+		_FindGroupShow();
+		return;
+	}
+
+	if (_FindRegexValid(text) == false)
+		return;
+
+	const bool regex = fFindRegexCheck->Value() == B_CONTROL_ON;
+
+	// Sources are usually files too
+	std::set<BString> paths;
+	for (auto& path : fActiveProject->FilesList())
+		paths.insert(path);
+	for (auto& path : fActiveProject->SourcesList())
+		paths.insert(path);
+	std::vector<BString> files(paths.begin(), paths.end());
+
+	fFileSearcher->Cancel();
+
+	// Modified buffers are always searched, the index knows files only
+	std::set<BString> buffers;
+	for (int32 index = 0; index < fEditorObjectList->CountItems(); index++) {
+		Editor* editor = fEditorObjectList->ItemAt(index);
+		if (editor->IsLoaded() == false || editor->IsModified() == false)
+			continue;
+
+		BPath path(editor->FileRef());
+		const char* buffer = reinterpret_cast<const char*>(
+			editor->SendMessage(SCI_GETCHARACTERPOINTER, UNSET, UNSET));
+		size_t length = editor->SendMessage(SCI_GETLENGTH, UNSET, UNSET);
+		fFileSearcher->AddBuffer(path.Path(), buffer, length);
+		buffers.insert(path.Path());
+	}
+
+	// Narrow to index candidates
+	if (fProjectIndex == nullptr
+		|| fProjectIndexName != fActiveProject->ExtensionedName()) {
+		delete fProjectIndex;
+		fProjectIndexName = fActiveProject->ExtensionedName();
+		fProjectIndex = new TrigramIndex(fProjectIndexName);
+		fProjectIndex->Load();
+	}
+
+	// A regular expression narrows on the literal all its matches contain
+	BString literal(text);
+	if (regex == true)
+		literal = TextRegex::Compile(text, fFindCaseSensitiveCheck->Value(),
+			fFindWholeWordCheck->Value())->RequiredLiteral().c_str();
+
+	std::vector<BString> candidates;
+	if (fProjectIndex->Candidates(literal, files, candidates) == B_OK) {
+		for (auto& path : buffers) {
+			if (std::find(candidates.begin(), candidates.end(), path) == candidates.end()
+				&& paths.find(path) != paths.end())
+				candidates.push_back(path);
+		}
+
+		BString notification;
+		notification << B_TRANSLATE("Find in files:") << "  "
+			<< B_TRANSLATE("index candidates") << " " << candidates.size()
+			<< "/" << files.size() << " "
+			<< fProjectIndex->LastQueryTime() / 1000 << " ms";
+		_SendNotification(notification, "FIND_FILES");
+
+		files.swap(candidates);
+	}
+
+	fSearchResultsView->Clear();
+	fSearchResultFiles.assign(files.size(), -1);
+	fFindInFilesText = text;
+
+	if (files.empty()) {
+		_SendNotification(B_TRANSLATE("Find in files: no candidate files"),
+			"FIND_FILES");
+		return;
+	}
+
+	status_t status = fFileSearcher->Start(text, fFindCaseSensitiveCheck->Value(),
+		fFindWholeWordCheck->Value(), regex, files);
+
+	if (status != B_OK) {
+		BString notification;
+		notification << B_TRANSLATE("Find in files:") << "  " << strerror(status);
+		_SendNotification(notification, "FIND_FILES");
+		return;
+	}
+
+	_UpdateFindMenuItems(text);
+	_ShowLog(kSearchResults);
+}
+
+/*
+ * Search as typed in the selected editor, options changes search again.
+ * Bad regular expressions (maybe half typed) just clear the marks.
+ */
+void
+IdeamWindow::_FindIncremental()
+{
+	Editor* editor = fEditorObjectList->ItemAt(fTabManager->SelectedTabIndex());
+	if (editor == nullptr)
+		return;
+
+	BString text(fFindTextControl->Text());
+
+	int flags = editor->SetSearchFlags(fFindCaseSensitiveCheck->Value(),
+										fFindWholeWordCheck->Value(),
+										false, fFindRegexCheck->Value(), false);
+
+	editor->IncrementalSearch(text, flags);
+}
+
+void
+IdeamWindow::_FindIncrementalClear()
+{
+	Editor* editor = fEditorObjectList->ItemAt(fTabManager->SelectedTabIndex());
+	if (editor != nullptr)
+		editor->IncrementalSearchClear();
+}
+
 int32
 IdeamWindow::_FindMarkAll(const BString text)
 {
+	if (_FindRegexValid(text) == false)
+		return 0;
+
 	fEditor = fEditorObjectList->ItemAt(fTabManager->SelectedTabIndex());
 
 	int flags = fEditor->SetSearchFlags(fFindCaseSensitiveCheck->Value(),
 										fFindWholeWordCheck->Value(),
-										false, false, false);
+										false, fFindRegexCheck->Value(), false);
 
 	int countMarks = fEditor->FindMarkAll(text, flags);
 
@@ -1762,7 +2453,7 @@ IdeamWindow::_FindMarkAll(const BString text)
 void
 IdeamWindow::_FindNext(const BString& strToFind, bool backwards)
 {
-	if (strToFind.IsEmpty())
+	if (strToFind.IsEmpty() || _FindRegexValid(strToFind) == false)
 		return;
 
 	fEditor = fEditorObjectList->ItemAt(fTabManager->SelectedTabIndex());
@@ -1771,7 +2462,7 @@ IdeamWindow::_FindNext(const BString& strToFind, bool backwards)
 
 	int flags = fEditor->SetSearchFlags(fFindCaseSensitiveCheck->Value(),
 										fFindWholeWordCheck->Value(),
-										false, false, false);
+										false, fFindRegexCheck->Value(), false);
 	bool wrap = fFindWrapCheck->Value();
 
 	if (backwards == false)
@@ -1782,60 +2473,73 @@ IdeamWindow::_FindNext(const BString& strToFind, bool backwards)
 	_UpdateFindMenuItems(strToFind);
 }
 
-int32
-IdeamWindow::_GetEditorIndex(entry_ref* ref)
+/*
+ * Bad regular expressions are reported here, editors and find in files
+ * then only see valid ones
+ */
+bool
+IdeamWindow::_FindRegexValid(const BString& text)
 {
-	BEntry entry(ref, true);
-	int32 filesCount = fEditorObjectList->CountItems();
-
-	// Could try to reopen at start a saved index that was deleted,
-	// check existence
-	if (entry.Exists() == false)
-		return -1;
-		
-	for (int32 index = 0; index < filesCount; index++) {
+	if (fFindRegexCheck->Value() == B_CONTROL_OFF)
+		return true;
 
-		fEditor = fEditorObjectList->ItemAt(index);
+	auto regex = TextRegex::Compile(text, fFindCaseSensitiveCheck->Value(),
+		fFindWholeWordCheck->Value());
+	if (regex->InitCheck() == B_OK)
+		return true;
 
-		if (fEditor == nullptr) {
-			BString notification;
-			notification
-				<< B_TRANSLATE("Index") << " " << index
-				<< ": " << B_TRANSLATE("NULL editor pointer");
-			_SendNotification(notification, "FILE_ERR");
-			continue;
-		}
+	BString notification;
+	notification << B_TRANSLATE("Find:") << "  " << text << "  "
+		<< B_TRANSLATE("regular expression error:") << " "
+		<< regex->ErrorString();
+	_SendNotification(notification, "FIND_ERR");
 
-		BEntry matchEntry(fEditor->FileRef(), true);
+	return false;
+}
 
-		if (matchEntry == entry)
-			return index;
+/*
+ * Lookups go through the indexes, the filesystem is only touched to
+ * resolve a ref that was not opened as is (e.g. a symlink to an open file).
+ * Deleted files left the indexes on their node monitor removal.
+ */
+int32
+IdeamWindow::_GetEditorIndex(entry_ref* ref)
+{
+	auto found = fEditorsByRef.find(*ref);
+
+	if (found == fEditorsByRef.end()) {
+		entry_ref resolved;
+		BEntry entry(ref, true);
+		if (entry.GetRef(&resolved) != B_OK || resolved == *ref)
+			return -1;
+		found = fEditorsByRef.find(resolved);
+		if (found == fEditorsByRef.end())
+			return -1;
 	}
-	return -1;
+
+	Editor* editor = fEditorObjectList->ItemAt(found->second);
+	if (editor == nullptr)
+		return -1;
+
+	fEditor = editor;
+	return found->second;
 }
 
+
 int32
 IdeamWindow::_GetEditorIndex(node_ref* nref)
 {
-	int32 filesCount = fEditorObjectList->CountItems();
-	
-	for (int32 index = 0; index < filesCount; index++) {
+	auto found = fEditorsByNode.find(*nref);
 
-		fEditor = fEditorObjectList->ItemAt(index);
+	if (found == fEditorsByNode.end())
+		return -1;
 
-		if (fEditor == nullptr) {
-			BString notification;
-			notification
-				<< B_TRANSLATE("Index") << " " << index
-				<< ": " << B_TRANSLATE("NULL editor pointer");
-			_SendNotification(notification, "FILE_ERR");
-			continue;
-		}
+	Editor* editor = fEditorObjectList->ItemAt(found->second);
+	if (editor == nullptr)
+		return -1;
 
-		if (*nref == *fEditor->NodeRef())
-			return index;
-	}
-	return -1;
+	fEditor = editor;
+	return found->second;
 }
 
 
@@ -1921,6 +2625,7 @@ IdeamWindow::_HandleExternalMoveModification(entry_ref* oldRef, entry_ref* newRe
 	else if (choice == 2) {
 		fEditor = fEditorObjectList->ItemAt(index);
 		fEditor->SetFileRef(newRef);
+		_EditorIndexAdd(fEditor);
 		fTabManager->SetTabLabel(index, fEditor->Name().String());
 		_UpdateLabel(index, fEditor->IsModified());
 
@@ -1979,8 +2684,12 @@ IdeamWindow::_HandleExternalRemoveModification(int32 index)
 	}
 }
 
+/*
+ * Called with the rehash result: identical contents are ignored, unmodified
+ * buffers are reloaded silently, modified ones ask the user.
+ */
 void
-IdeamWindow::_HandleExternalStatModification(int32 index)
+IdeamWindow::_HandleExternalStatModification(int32 index, BMessage* rehash)
 {
 	if (index < 0) {
 		return; //TODO notify
@@ -1988,6 +2697,26 @@ IdeamWindow::_HandleExternalStatModification(int32 index)
 
 	fEditor = fEditorObjectList->ItemAt(index);
 
+	int64 size;
+	uint64 hash;
+	if (rehash->GetInt32("status", B_ERROR) == B_OK
+		&& rehash->FindInt64("size", &size) == B_OK
+		&& rehash->FindUInt64("hash", &hash) == B_OK
+		&& size == fEditor->ContentSize()
+		&& hash == fEditor->ContentHash())
+		return;
+
+	if (fEditor->IsModified() == false) {
+		fEditor->Reload();
+
+		BString notification;
+		notification << B_TRANSLATE("File info:") << "  "
+			<< fEditor->Name() << " "
+			<< B_TRANSLATE("modified externally, reloaded");
+		_SendNotification(notification, "FILE_INFO");
+		return;
+	}
+
 	BString text;
 	text << IdeamNames::kApplicationName << ":\n";
 	text << (B_TRANSLATE("File \"%file%\" was modified externally, reload it?"));
@@ -2014,62 +2743,84 @@ IdeamWindow::_HandleExternalStatModification(int32 index)
 	}
 }
 
+/*
+ * Node monitor messages are not handled one by one: events are merged per
+ * node for kNodeMonitorDelay and then acted on once, see
+ * _FlushNodeMonitorEvents.
+ */
 void
 IdeamWindow::_HandleNodeMonitorMsg(BMessage* msg)
 {
 	int32 opcode;
 	status_t status;
+	node_ref nref;
 
-	if ((status = msg->FindInt32("opcode", &opcode)) != B_OK) {
+	if ((status = msg->FindInt32("opcode", &opcode)) != B_OK
+		|| msg->FindInt32("device", &nref.device) != B_OK
+		|| msg->FindInt64("node", &nref.node) != B_OK) {
 		// TODO notify
 		return;
-	}	
+	}
+
+	fNodeEventsReceived++;
+
+	// Project directories, see _ProjectUpdateDirectories
+	if (opcode == B_ENTRY_CREATED || opcode == B_ENTRY_REMOVED
+		|| opcode == B_ENTRY_MOVED) {
+		const char* fields[] = { "directory", "from directory", "to directory" };
+		for (const char* field : fields) {
+			int64 node;
+			if (msg->FindInt64(field, &node) != B_OK)
+				continue;
+			const node_ref directory(nref.device, node);
+			for (auto& parser : fProjectParsers)
+				if (parser.second->IsWatching(directory) == true)
+					fProjectDirtyDirectories[parser.first].insert(directory);
+		}
+
+		// New contents at a name the index may know
+		int64 directory;
+		const char* name;
+		if (opcode != B_ENTRY_REMOVED
+			&& (msg->FindInt64("directory", &directory) == B_OK
+				|| msg->FindInt64("to directory", &directory) == B_OK)
+			&& msg->FindString("name", &name) == B_OK) {
+			const entry_ref ref(nref.device, directory, name);
+			_ProjectIndexInvalidate(&ref);
+		}
+	}
+
+	node_event& event = fNodeEvents[nref];
 
 	switch (opcode) {
 		case B_ENTRY_MOVED: {
-			int32 device;
 			int64 srcDir;
 			int64 dstDir;
-			BString name;
+			const char* name;
 			const char* oldName;
 
-			if (msg->FindInt32("device", &device) != B_OK
-				|| msg->FindInt64("to directory", &dstDir) != B_OK
+			if (msg->FindInt64("to directory", &dstDir) != B_OK
 				|| msg->FindInt64("from directory", &srcDir) != B_OK
 				|| msg->FindString("name", &name) != B_OK
 				|| msg->FindString("from name", &oldName) != B_OK)
 					break;
 
-			entry_ref oldRef(device, srcDir, oldName);
-			entry_ref newRef(device, dstDir, name);
-
-			_HandleExternalMoveModification(&oldRef, &newRef);
+			// Keep the first origin and the last destination
+			if (event.moved == false)
+				event.from = entry_ref(nref.device, srcDir, oldName);
+			event.to = entry_ref(nref.device, dstDir, name);
+			event.moved = true;
 
 			break;
 		}
 		case B_ENTRY_REMOVED: {
-			node_ref nref;
-			BString name;
-			int64 dir;
-
-			if (msg->FindInt32("device", &nref.device) != B_OK
-				|| msg->FindString("name", &name) != B_OK
-				|| msg->FindInt64("directory", &dir) != B_OK
-				|| msg->FindInt64("node", &nref.node) != B_OK)
-					break;
-
-			_HandleExternalRemoveModification(_GetEditorIndex(&nref));
-			//entry_ref ref(device, dir, name);
-			//_HandleExternalRemoveModification(_GetEditorIndex(&ref));
+			event.removed = true;
 			break;
 		}
 		case B_STAT_CHANGED: {
-			node_ref nref;
 			int32 fields;
 
-			if (msg->FindInt32("device", &nref.device) != B_OK
-				|| msg->FindInt64("node", &nref.node) != B_OK
-				|| msg->FindInt32("fields", &fields) != B_OK)
+			if (msg->FindInt32("fields", &fields) != B_OK)
 					break;
 #if defined DEBUG
 switch (fields) {
@@ -2128,7 +2879,7 @@ std::cerr << __PRETTY_FUNCTION__ << "fields is: 0x" << std::hex << fields << std
 			if (((fields & B_STAT_MODIFICATION_TIME)  != 0)
 			// Do not reload if the file just got touched 
 				&& ((fields & B_STAT_ACCESS_TIME)  == 0)) {
-				_HandleExternalStatModification(_GetEditorIndex(&nref));
+				event.modified = true;
 			}
 
 			break;
@@ -2136,8 +2887,81 @@ std::cerr << __PRETTY_FUNCTION__ << "fields is: 0x" << std::hex << fields << std
 		default:
 			break;
 	}
+
+	if (fNodeFlushScheduled == false) {
+		BMessage flush(MSG_NODE_MONITOR_FLUSH);
+		BMessageRunner::StartSending(BMessenger(this), &flush,
+			kNodeMonitorDelay, 1);
+		fNodeFlushScheduled = true;
+	}
 }
 
+/*
+ * Act once per node on the merged events:
+ *  - removed: if something else now lives at the file's entry it was
+ *    replaced (e.g. by a rename over it), so rewatch and rehash it
+ *  - moved: a single move from first origin to last destination, none
+ *    if moved back
+ *  - modified: rehash, see _FileRehash
+ */
+void
+IdeamWindow::_FlushNodeMonitorEvents()
+{
+	int32 acted = 0;
+
+	fNodeFlushScheduled = false;
+
+	_ProjectUpdateDirectories();
+
+	for (auto& it : fNodeEvents) {
+		node_ref nref = it.first;
+		node_event& event = it.second;
+
+		int32 index = _GetEditorIndex(&nref);
+		if (index < 0)
+			continue;
+
+		if (event.removed == true) {
+			Editor* editor = fEditorObjectList->ItemAt(index);
+			BEntry entry(event.moved == true ? &event.to : editor->FileRef());
+
+			if (event.moved == false && entry.Exists() == true) {
+				editor->StopMonitoring();
+				editor->StartMonitoring();
+				_EditorIndexAdd(editor);
+				_ProjectIndexUpdateFile(editor->FileRef());
+				_FileRehash(index);
+			} else
+				_HandleExternalRemoveModification(index);
+			acted++;
+			continue;
+		}
+
+		if (event.moved == true && event.from != event.to) {
+			_HandleExternalMoveModification(&event.from, &event.to);
+			acted++;
+		}
+
+		if (event.modified == true) {
+			_FileRehash(index);
+			_ProjectIndexUpdateFile(fEditorObjectList->ItemAt(index)->FileRef());
+			acted++;
+		}
+	}
+
+	fNodeEvents.clear();
+	fNodeEventsActed += acted;
+
+	if (acted > 0) {
+		BString notification;
+		notification << B_TRANSLATE("Node monitor:") << "  "
+			<< fNodeEventsReceived << " "
+			<< B_TRANSLATE("events received,") << " "
+			<< fNodeEventsActed << " "
+			<< B_TRANSLATE("acted on");
+		_SendNotification(notification, "NODE_MON");
+	}
+}
 
 void
 IdeamWindow::_InitCentralSplit()
@@ -2154,6 +2978,7 @@ IdeamWindow::_InitCentralSplit()
 						BSize(charWidth * kFindReplaceMinBytes + 10.0f,
 						B_SIZE_UNSET));
 	fFindTextControl->SetExplicitMaxSize(fFindTextControl->MinSize());
+	fFindTextControl->SetModificationMessage(new BMessage(MSG_FIND_TEXT_MODIFIED));
 
 	fFindNextButton = _LoadIconButton("FindNextButton", MSG_FIND_NEXT, 164, true,
 						B_TRANSLATE("Find Next"));
@@ -2169,6 +2994,11 @@ IdeamWindow::_InitCentralSplit()
 	fFindCaseSensitiveCheck = new BCheckBox(B_TRANSLATE("Match case"));
 	fFindWholeWordCheck = new BCheckBox(B_TRANSLATE("Whole word"));
 	fFindWrapCheck = new BCheckBox(B_TRANSLATE("Wrap"));
+	fFindRegexCheck = new BCheckBox(B_TRANSLATE("Regex"));
+	// Options changes redo the incremental search
+	fFindCaseSensitiveCheck->SetMessage(new BMessage(MSG_FIND_TEXT_MODIFIED));
+	fFindWholeWordCheck->SetMessage(new BMessage(MSG_FIND_TEXT_MODIFIED));
+	fFindRegexCheck->SetMessage(new BMessage(MSG_FIND_TEXT_MODIFIED));
 
 	fFindGroup = BLayoutBuilder::Group<>(B_VERTICAL, 0.0f)
 		.Add(BLayoutBuilder::Group<>(B_HORIZONTAL, B_USE_HALF_ITEM_SPACING)
@@ -2179,6 +3009,7 @@ IdeamWindow::_InitCentralSplit()
 			.Add(fFindWrapCheck)
 			.Add(fFindWholeWordCheck)
 			.Add(fFindCaseSensitiveCheck)
+			.Add(fFindRegexCheck)
 			.Add(fFindMarkAllButton)
 			.AddGlue()
 		)
@@ -2344,6 +3175,8 @@ IdeamWindow::_InitMenu()
 		new BMessage(MSG_WHITE_SPACES_TOGGLE)));
 	menu->AddItem(fToggleLineEndingsItem = new BMenuItem(B_TRANSLATE("Toggle line endings"),
 		new BMessage(MSG_LINE_ENDINGS_TOGGLE)));
+	menu->AddItem(fLargeFileModeItem = new BMenuItem(B_TRANSLATE("Large file mode"),
+		new BMessage(MSG_LARGE_FILE_MODE_TOGGLE)));
 
 	menu->AddSeparatorItem();
 	fLineEndingsMenu = new BMenu(B_TRANSLATE("Line endings"));
@@ -2370,6 +3203,7 @@ IdeamWindow::_InitMenu()
 	fOverwiteItem->SetEnabled(false);
 	fToggleWhiteSpacesItem->SetEnabled(false);
 	fToggleLineEndingsItem->SetEnabled(false);
+	fLargeFileModeItem->SetEnabled(false);
 	fLineEndingsMenu->SetEnabled(false);
 
 	menu->AddItem(fLineEndingsMenu);
@@ -2654,6 +3488,16 @@ IdeamWindow::_InitOutputSplit()
 	fOutputTabView->AddTab(fNotificationsListView);
 	fOutputTabView->AddTab(fBuildLogView);
 	fOutputTabView->AddTab(fConsoleIOView);
+
+	fSearchResultsView = new SearchResultsView(B_TRANSLATE("Search results"),
+		BMessenger(this), MSG_SEARCH_RESULT_INVOKED);
+	fOutputTabView->AddTab(new BScrollView(B_TRANSLATE("Search results"),
+		fSearchResultsView, B_FRAME_EVENTS | B_WILL_DRAW, false, true));
+
+	fProblemsView = new ProblemsView(B_TRANSLATE("Problems"),
+		BMessenger(this), MSG_PROBLEM_INVOKED);
+	fOutputTabView->AddTab(new BScrollView(B_TRANSLATE("Problems"),
+		fProblemsView, B_FRAME_EVENTS | B_WILL_DRAW, false, true));
 }
 
 void
@@ -2661,7 +3505,9 @@ IdeamWindow::_InitSideSplit()
 {
 	// Projects View
 	fProjectsTabView = new BTabView("ProjectsTabview");
-	fProjectsOutline = new BOutlineListView("ProjectsOutline", B_SINGLE_SELECTION_LIST);
+	// WARNING: heading names used in context menu file exclusion
+	fProjectsOutline = new ProjectOutlineView("ProjectsOutline",
+		B_TRANSLATE("Project Sources"), B_TRANSLATE("Project Files"));
 	fProjectsScroll = new BScrollView(B_TRANSLATE("Projects"),
 		fProjectsOutline, B_FRAME_EVENTS | B_WILL_DRAW, true, true, B_FANCY_BORDER);
 	fProjectsTabView->AddTab(fProjectsScroll);
@@ -3132,6 +3978,11 @@ IdeamWindow::_ProjectClose()
 	BString closed(B_TRANSLATE("Project close:"));
 	BString name = fSelectedProjectName;
 
+	// Its file may be deleted next
+	_ProjectRescanWait(name);
+	fProjectParsers.erase(name);
+	fProjectDirtyDirectories.erase(name);
+
 	// Active project closed
 	if (project == fActiveProject) {
 		fActiveProject = nullptr;
@@ -3146,6 +3997,11 @@ IdeamWindow::_ProjectClose()
 	fProjectObjectList->RemoveItem(project);
 //			delete project; // scan-build claims as released
 
+	if (fProjectIndex != nullptr && fProjectIndexName == name) {
+		delete fProjectIndex;
+		fProjectIndex = nullptr;
+	}
+
 	BString notification;
 	notification << closed << " "  << name;
 	_SendNotification(notification, "PROJ_CLOSE");
@@ -3181,7 +4037,10 @@ IdeamWindow::_ProjectDelete(BString name, bool sourcesToo)
 
 	if (entry.Exists()) {
 		BString notification;
+		// Or a pending write would bring it back
+		TPreferences::Evict(name, IdeamNames::kApplicationName);
 		entry.Remove();
+		TrigramIndex(name).Remove();
 		notification << B_TRANSLATE("Project delete:") << "  "  << name.String();
 		_SendNotification(notification, "PROJ_DELETE");
 	}
@@ -3262,6 +4121,16 @@ IdeamWindow::_ProjectFileFullPath()
 	if (project == nullptr)
 		return "";
 
+	// Items may have been made again since chosen
+	fSelectedProjectItem = dynamic_cast<BStringItem*>(
+		fProjectsOutline->ItemAt(fProjectsOutline->CurrentSelection()));
+	if (fSelectedProjectItem == nullptr)
+		return "";
+
+	ProjectItem* projectItem = dynamic_cast<ProjectItem*>(fSelectedProjectItem);
+	if (projectItem != nullptr)
+		return projectItem->Path();
+
 	selectedFileFullpath = project->BasePath();
 	selectedFileFullpath.Append("/");
 	selectedFileFullpath.Append(fSelectedProjectItem->Text());
@@ -3287,31 +4156,22 @@ IdeamWindow::_ProjectFileRemoveItem(bool addToParseless)
 							IdeamNames::kApplicationName, 'LOPR');
 
 	int32 index = 0;
-	BString superItem(""), file;
-	BStringItem *itemType;
-	BListItem *item = fSelectedProjectItem, *parent;
-
-	while ((parent = fProjectsOutline->Superitem(item)) != nullptr) {
-		itemType = dynamic_cast<BStringItem*>(parent);
-		superItem = itemType->Text();
-		if (superItem == B_TRANSLATE("Project Files")
-			|| superItem == B_TRANSLATE("Project Sources"))
-			break;
-
-		item = parent;
-	}
+	BString file;
+	const BString selectedFile(_ProjectFileFullPath());
+	if (selectedFile.IsEmpty())
+		return;
 
-	if (superItem == B_TRANSLATE("Project Sources"))
-		superItem = "project_source";
-	else if (superItem == B_TRANSLATE("Project Files"))
-		superItem = "project_file";
-	else
+	bool source;
+	if (fProjectsOutline->FileItemList(fSelectedProjectItem, source) == false)
 		return;
 
+	const char* superItem = source == true ? "project_source" : "project_file";
+
 	while ((idmproFile.FindString(superItem, index, &file)) != B_BAD_INDEX) {
-		if (_ProjectFileFullPath() == file) {
+		if (selectedFile == file) {
 			idmproFile.RemoveData(superItem, index);
-			fProjectsOutline->RemoveItem(fSelectedProjectItem);
+			fProjectsOutline->RemoveFileItem(fSelectedProjectItem);
+			fSelectedProjectItem = nullptr;
 			// Excluded items go to "parseless_item" array in settings file so
 			// subsequent calls to ProjectParser::ParseProjectFiles() will keep hiding them
 			if (addToParseless == true)
@@ -3322,6 +4182,40 @@ IdeamWindow::_ProjectFileRemoveItem(bool addToParseless)
 	}
 }
 
+/*
+ * Files created or moved over in a project directory, only if the index
+ * project watches it
+ */
+void
+IdeamWindow::_ProjectIndexInvalidate(const entry_ref* ref)
+{
+	if (fProjectIndex == nullptr || fProjectIndex->IsLoaded() == false)
+		return;
+
+	auto parser = fProjectParsers.find(fProjectIndexName);
+	if (parser == fProjectParsers.end() || parser->second->IsWatching(
+			node_ref(ref->device, ref->directory)) == false)
+		return;
+
+	BPath path(ref);
+	if (path.InitCheck() == B_OK)
+		fProjectIndex->Invalidate(path.Path());
+}
+
+/*
+ * Files changed after the last scan are kept as an overlay of the index
+ */
+void
+IdeamWindow::_ProjectIndexUpdateFile(const entry_ref* ref)
+{
+	if (fProjectIndex == nullptr || fProjectIndex->IsLoaded() == false)
+		return;
+
+	BPath path(ref);
+	if (path.InitCheck() == B_OK)
+		fProjectIndex->UpdateFile(path.Path());
+}
+
 void
 IdeamWindow::_ProjectItemChosen()
 {
@@ -3343,13 +4237,13 @@ IdeamWindow::_ProjectItemChosen()
 	fSelectedProjectItemName = fSelectedProjectItem->Text();
 
 	bool isProject = fSelectedProjectItemName.EndsWith(IdeamNames::kProjectExtension);
+	ProjectItem* projectItem = dynamic_cast<ProjectItem*>(fSelectedProjectItem);
 
 	// If a project was chosen fill string name otherwise do some calculations
 	if (isProject) {
 		fSelectedProjectName = fSelectedProjectItemName;
-	} else if (fSelectedProjectItemName == B_TRANSLATE("Project Files")
-			|| fSelectedProjectItemName == B_TRANSLATE("Project Sources")) {
-		// Nothing to do
+	} else if (projectItem != nullptr && projectItem->IsDirectory() == true) {
+		// Headings and directories, nothing to do
 		return;
 	}  else {
 		// Find the project selected file belongs to
@@ -3436,50 +4330,35 @@ IdeamWindow::_ProjectOpen(BString const& projectName, bool activate)
 	BString notification;
 	notification << opened << "  " << projectName;
 	_SendNotification(notification, "PROJ_OPEN");
+
+	// Get a snapshot of the tree to watch, lists are brought up to date
+	_ProjectRescan(projectName);
 }
 
 void
 IdeamWindow::_ProjectOutlineDepopulate(Project* project)
 {
-	fProjectsOutline->RemoveItem(project->Title());
+	fProjectsOutline->RemoveProject(project->Title());
 }
 
 void
-IdeamWindow::_ProjectOutlinePopulate(Project* project)
+IdeamWindow::_ProjectOutlinePatch(Project* project,
+	const ProjectParser::scan_changes& changes)
 {
-	BString basepath(project->BasePath());
-	basepath.Append("/");
-	BString cutpath;
-	int32 count;
-
-	fProjectsOutline->AddItem(project->Title());
-
-	// WARNING: names used in context menu file exclusion
-	fSourcesItem = new BStringItem(B_TRANSLATE("Project Sources"), 1, false);
-	fProjectsOutline->AddUnder(fSourcesItem, project->Title());
-
-	fFilesItem = new BStringItem(B_TRANSLATE("Project Files"), 1, false);
-	fProjectsOutline->AddUnder(fFilesItem, project->Title());
-
-
-	count = project->SourcesList().size();
-	for (int32 index = count - 1; index >= 0 ; index--) {
-		cutpath = project->SourcesList().at(index);
-		cutpath.RemoveFirst(basepath);
-
-		BStringItem* item = new BStringItem(cutpath);
-		fProjectsOutline->AddUnder(item, fSourcesItem);
-	}
-	count = project->FilesList().size();
-	for (int32 index = count - 1; index >= 0 ; index--) {
-		cutpath = project->FilesList().at(index);
-		cutpath.RemoveFirst(basepath);
-		BStringItem* item = new BStringItem(cutpath);
-		fProjectsOutline->AddUnder(item, fFilesItem);
-	}
+	fProjectsOutline->PatchProject(project->Title(), changes.removedSources,
+		changes.addedSources, changes.removedFiles, changes.addedFiles);
+	fProjectsOutline->Invalidate();
+}
 
-	fProjectsOutline->SortItemsUnder(fSourcesItem, true, IdeamWindow::_CompareListItems);
-	fProjectsOutline->SortItemsUnder(fFilesItem, true, IdeamWindow::_CompareListItems);
+/*
+ * Trees are built off the window thread, on a rescan too: expanded
+ * directories and selection are kept
+ */
+void
+IdeamWindow::_ProjectOutlinePopulate(Project* project)
+{
+	fProjectsOutline->SetProject(project->Title(), project->BasePath(),
+		project->SourcesList(), project->FilesList());
 }
 
 Project*
@@ -3493,6 +4372,11 @@ IdeamWindow::_ProjectPointerFromName(BString const& projectName)
 	return nullptr;
 }
 
+/*
+ * Scans run in a thread of their own, the outline is updated on
+ * PROJECT_PARSER_SCAN_DONE. One scan at a time per project: asking again
+ * meanwhile rescans when it is done.
+ */
 void
 IdeamWindow::_ProjectRescan(BString const& projectName)
 {
@@ -3500,14 +4384,62 @@ IdeamWindow::_ProjectRescan(BString const& projectName)
 	if (project == nullptr)
 		return;
 
-	BString projectDirectory("");
-	projectDirectory.SetTo(project->BasePath());
+	if (fProjectScans.find(projectName) != fProjectScans.end()) {
+		fProjectScansPending.insert(projectName);
+		return;
+	}
+
+	std::unique_ptr<ProjectParser>& parser = fProjectParsers[projectName];
+	if (parser == nullptr)
+		parser.reset(new ProjectParser(projectName));
+
+	thread_id thread = parser->ParseProjectFilesAsync(project->BasePath(),
+		BMessenger(this));
+	if (thread < 0) {
+		BString notification;
+		notification << B_TRANSLATE("Project scan") << ":  " << projectName
+			<< "  " << strerror(thread);
+		_SendNotification(notification, "PROJ_SCAN");
+		return;
+	}
+
+	fProjectScans[projectName] = thread;
+}
+
+void
+IdeamWindow::_ProjectRescanDone(BString const& projectName)
+{
+	// Waited for already (project closed)
+	if (fProjectScans.find(projectName) == fProjectScans.end())
+		return;
+
+	const bool again = fProjectScansPending.erase(projectName) > 0;
+	_ProjectRescanWait(projectName);
+
+	Project* project = _ProjectPointerFromName(projectName);
+	if (project == nullptr)
+		return;
+
+	if (again == true) {
+		_ProjectRescan(projectName);
+		return;
+	}
+
+	auto parser = fProjectParsers.find(projectName);
+	if (parser != fProjectParsers.end()) {
+		status_t status = parser->second->StartWatching(BMessenger(this));
+		if (status != B_OK) {
+			BString notification;
+			notification << B_TRANSLATE("Project scan") << ":  " << projectName
+				<< "  " << B_TRANSLATE("directories not all watched:") << " "
+				<< strerror(status);
+			_SendNotification(notification, "PROJ_SCAN");
+		}
+	}
 
-	TPreferences* prefs = new TPreferences(projectName,
-		IdeamNames::kApplicationName, 'LOPR');
-	ProjectParser parser(prefs);
-	parser.ParseProjectFiles(projectDirectory.String());
-	delete prefs;
+	// Parser rewrote the index file
+	if (fProjectIndex != nullptr && fProjectIndexName == projectName)
+		fProjectIndex->Load();
 
 	// If active project was git inited (or git removed) and then rescaned
 	// set Git menu accordingly
@@ -3518,9 +4450,87 @@ IdeamWindow::_ProjectRescan(BString const& projectName)
 			fGitMenu->SetEnabled(false);
 	}
 
-	_ProjectOutlineDepopulate(project);
 	_ProjectOutlinePopulate(project);
 	fProjectsOutline->Invalidate();
+
+	// Changes seen while scanning
+	_ProjectUpdateDirectories();
+
+	// Scans are the heaviest settings users
+	TPreferences::cache_stats stats;
+	TPreferences::GetStats(stats);
+	BString notification;
+	notification << B_TRANSLATE("Settings cache:") << "  "
+		<< stats.hits << " " << B_TRANSLATE("hits,") << " "
+		<< stats.misses << " " << B_TRANSLATE("misses,") << " "
+		<< stats.clean << " " << B_TRANSLATE("unchanged,") << " "
+		<< stats.dirty << " " << B_TRANSLATE("changed,") << " "
+		<< stats.flushes << " " << B_TRANSLATE("written,") << " "
+		<< stats.errors << " " << B_TRANSLATE("failed");
+	_SendNotification(notification, "SETTINGS");
+}
+
+void
+IdeamWindow::_ProjectRescanWait(BString const& projectName)
+{
+	auto scan = fProjectScans.find(projectName);
+	if (scan == fProjectScans.end())
+		return;
+
+	// The scan may be waiting for room in this window's port
+	auto parser = fProjectParsers.find(projectName);
+	if (parser != fProjectParsers.end())
+		parser->second->WaitAsync(scan->second);
+	else {
+		status_t result;
+		wait_for_thread(scan->second, &result);
+	}
+	fProjectScans.erase(scan);
+	fProjectScansPending.erase(projectName);
+}
+
+/*
+ * Directories reported by the node monitor are read again by their
+ * project parser, outline items of files gone or come are patched
+ */
+void
+IdeamWindow::_ProjectUpdateDirectories()
+{
+	for (auto it = fProjectDirtyDirectories.begin();
+			it != fProjectDirtyDirectories.end();) {
+		// Scan running: acted on when done
+		if (fProjectScans.find(it->first) != fProjectScans.end()) {
+			it++;
+			continue;
+		}
+
+		auto parser = fProjectParsers.find(it->first);
+		Project* project = _ProjectPointerFromName(it->first);
+
+		if (parser != fProjectParsers.end() && project != nullptr) {
+			ProjectParser::scan_changes changes;
+			parser->second->RescanDirectories(it->second, changes);
+
+			const int32 added = changes.addedSources.size()
+				+ changes.addedFiles.size();
+			const int32 removed = changes.removedSources.size()
+				+ changes.removedFiles.size();
+
+			if (added > 0 || removed > 0) {
+				_ProjectOutlinePatch(project, changes);
+
+				BString notification;
+				notification << B_TRANSLATE("Project update:") << "  "
+					<< it->first << "  +" << added << " -" << removed
+					<< " (" << changes.directories << " "
+					<< B_TRANSLATE("directories read") << ", "
+					<< changes.elapsed / 1000 << " ms)";
+				_SendNotification(notification, "PROJ_SCAN");
+			}
+		}
+
+		it = fProjectDirtyDirectories.erase(it);
+	}
 }
 
 status_t
@@ -3563,10 +4573,13 @@ IdeamWindow::_Replace(int what)
 	BString replacement(fReplaceTextControl->Text());
 	int retValue = REPLACE_NONE;
 
+	if (_FindRegexValid(selection) == false)
+		return REPLACE_SKIP;
+
 	fEditor = fEditorObjectList->ItemAt(fTabManager->SelectedTabIndex());
 	int flags = fEditor->SetSearchFlags(fFindCaseSensitiveCheck->Value(),
 										fFindWholeWordCheck->Value(),
-										false, false, false);
+										false, fFindRegexCheck->Value(), false);
 
 	bool wrap = fFindWrapCheck->Value();
 
@@ -3581,7 +4594,7 @@ IdeamWindow::_Replace(int what)
 			break;
 		}
 		case REPLACE_ONE: {
-			retValue = fEditor->ReplaceOne(selection, replacement);
+			retValue = fEditor->ReplaceOne(selection, replacement, flags);
 			break;
 		}
 		case REPLACE_PREVIOUS: {
@@ -3711,9 +4724,7 @@ IdeamWindow::_RunTarget()
 		return;
 
 	// Check if run args present
-	BString args("");
-	TPreferences prefs(fActiveProject->ExtensionedName(), IdeamNames::kApplicationName, 'LOPR');
-	prefs.FindString("project_run_args", &args);
+	BString args(fActiveProject->RunArgs());
 
 	// Differentiate terminal projects from window ones
 	if (fActiveProject->RunInTerminal() == true) {
@@ -3795,6 +4806,28 @@ IdeamWindow::_ShowLog(int32 index)
 	fOutputTabView->Select(index);
 }
 
+/*
+ * Fill search results from an editor message carrying a "lines" blob
+ */
+void
+IdeamWindow::_ShowSearchResultLines(BMessage* message)
+{
+	entry_ref ref;
+	const void* lines;
+	ssize_t size = 0;
+
+	fSearchResultsView->Clear();
+
+	if (message->FindRef("ref", &ref) == B_OK
+		&& message->FindData("lines", B_INT32_TYPE, &lines, &size) == B_OK) {
+		int32 file = fSearchResultsView->AddFile(ref);
+		fSearchResultsView->AddLines(file,
+			static_cast<const int32*>(lines), size / sizeof(int32));
+		_ShowLog(kSearchResults);
+	} else
+		_ShowLog(kNotificationLog);
+}
+
 
 void
 IdeamWindow::_UpdateFindMenuItems(const BString& text)
@@ -3830,6 +4863,26 @@ IdeamWindow::_UpdateLabel(int32 index, bool isModified)
 	return B_ERROR;
 }
 
+/*
+ * Counts in the tab label, updated as the build goes
+ */
+void
+IdeamWindow::_UpdateProblemsTab()
+{
+	BTab* tab = fOutputTabView->TabAt(kProblems);
+	if (tab == nullptr)
+		return;
+
+	BString label(B_TRANSLATE("Problems"));
+	const int32 errors = fProblemsView->CountErrors();
+	const int32 warnings = fProblemsView->CountWarnings();
+	if (errors + warnings > 0)
+		label << " (" << errors << "/" << warnings << ")";
+
+	tab->SetLabel(label.String());
+	fOutputTabView->Invalidate();
+}
+
 void
 IdeamWindow::_UpdateProjectActivation(bool active)
 {
@@ -3840,6 +4893,7 @@ IdeamWindow::_UpdateProjectActivation(bool active)
 		fMakeCatkeysItem->SetEnabled(true);
 		fMakeBindcatalogsItem->SetEnabled(true);
 		fBuildButton->SetEnabled(true);
+		fFindinFilesButton->SetEnabled(true);
 
 		// Is this a git project?
 		if (fActiveProject->Scm() == "git")
@@ -3891,6 +4945,7 @@ IdeamWindow::_UpdateProjectActivation(bool active)
 		fRunButton->SetEnabled(false);
 		fDebugButton->SetEnabled(false);
 		fBuildModeButton->SetEnabled(false);
+		fFindinFilesButton->SetEnabled(false);
 	}
 }
 
@@ -3972,7 +5027,9 @@ IdeamWindow::_UpdateStatusBarTrailing(int32 index)
 	trailing << fEditor->IsOverwriteString() << '\t';
 	trailing << fEditor->EndOfLineString() << '\t';
 	trailing << fEditor->ModeString() << '\t';
-	//trailing << fEditor->EncodingString() << '\t';
+	if (fEditor->IsLargeFileMode())
+		trailing << B_TRANSLATE("LARGE") << '\t';
+	trailing << fEditor->EncodingString() << '\t';
 
 	fStatusBar->SetTrailingText(trailing.String());
 }
@@ -4020,6 +5077,8 @@ IdeamWindow::_UpdateTabChange(int32 index, const BString& caller)
 		fOverwiteItem->SetEnabled(false);
 		fToggleWhiteSpacesItem->SetEnabled(false);
 		fToggleLineEndingsItem->SetEnabled(false);
+		fLargeFileModeItem->SetEnabled(false);
+		fLargeFileModeItem->SetMarked(false);
 		fLineEndingsMenu->SetEnabled(false);
 		fFindItem->SetEnabled(false);
 		fReplaceItem->SetEnabled(false);
@@ -4080,6 +5139,8 @@ IdeamWindow::_UpdateTabChange(int32 index, const BString& caller)
 	// fOverwiteItem->SetMarked(fEditor->IsOverwrite());
 	fToggleWhiteSpacesItem->SetEnabled(true);
 	fToggleLineEndingsItem->SetEnabled(true);
+	fLargeFileModeItem->SetEnabled(true);
+	fLargeFileModeItem->SetMarked(fEditor->IsLargeFileMode());
 	fLineEndingsMenu->SetEnabled(!fEditor->IsReadOnly());
 	fFindItem->SetEnabled(true);
 	fReplaceItem->SetEnabled(true);
@@ -23,16 +23,27 @@
 #include <TextControl.h>
 #include <Window.h>
 
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
 #if defined CLASSES_VIEW
 #include "ClassesView.h"
 #endif
 #include "ConsoleIOThread.h"
 #include "ConsoleIOView.h"
 #include "Editor.h"
+#include "FileSearcher.h"
 #include "Project.h"
+#include "ProjectOutlineView.h"
 #include "ProjectParser.h"
+#include "ProblemsView.h"
+#include "SearchResultsView.h"
 #include "TabManager.h"
 #include "TPreferences.h"
+#include "TrigramIndex.h"
 
 enum {
 	kProjectsOutline = 0,
@@ -47,7 +58,27 @@ enum {
 enum {
 	kNotificationLog = 0,
 	kBuildLog,
-	kOutputLog
+	kOutputLog,
+	kSearchResults,
+	kProblems
+};
+
+// Hashes for the editor lookup indexes
+struct entry_ref_hash {
+	size_t operator()(const entry_ref& ref) const
+	{
+		uint64 hash = 14695981039346656037ULL;
+		for (const char* c = ref.name; c != nullptr && *c != '\0'; c++)
+			hash = (hash ^ (uint8)*c) * 1099511628211ULL;
+		return hash ^ ((uint64)ref.directory << 8) ^ (uint64)ref.device;
+	}
+};
+
+struct node_ref_hash {
+	size_t operator()(const node_ref& nref) const
+	{
+		return (uint64)nref.node * 1099511628211ULL ^ (uint64)nref.device;
+	}
 };
 
 class IdeamWindow : public BWindow
@@ -67,21 +98,30 @@ private:
 			status_t			_BuildProject();
 			status_t			_CargoNew(BString args);
 			status_t			_CleanProject();
-	static	int					_CompareListItems(const BListItem* a,
-									const BListItem* b);
 
 			status_t			_DebugProject();
+			void				_EditorIndexAdd(Editor* editor);
+			void				_EditorIndexRemove(Editor* editor);
+			void				_EditorIndexShift(int32 removed);
+			status_t			_EditorLoad(int32 index);
+			void				_EditorPrefetch(int32 from);
 			status_t			_FileClose(int32 index, bool ignoreModifications = false);
 			void				_FileCloseAll();
 			status_t			_FileOpen(BMessage* msg);
+			void				_FileRehash(int32 index);
 			status_t			_FileSave(int32	index);
 			void				_FileSaveAll();
 			status_t			_FileSaveAs(int32 selection, BMessage* message);
 			bool				_FilesNeedSave();
 			void				_FindGroupShow();
 			void				_FindGroupToggled();
+			void				_FindInFiles();
+			void				_FindIncremental();
+			void				_FindIncrementalClear();
 			int32				_FindMarkAll(const BString text);
 			void				_FindNext(const BString& strToFind, bool backwards);
+			bool				_FindRegexValid(const BString& text);
+			void				_FlushNodeMonitorEvents();
 
 			int32				_GetEditorIndex(entry_ref* ref);
 			int32				_GetEditorIndex(node_ref* nref);
@@ -89,7 +129,8 @@ private:
 			status_t			_Git(const BString& git_command);
 			void				_HandleExternalMoveModification(entry_ref* oldRef, entry_ref* newRef);
 			void				_HandleExternalRemoveModification(int32 index);
-			void				_HandleExternalStatModification(int32 index);
+			void				_HandleExternalStatModification(int32 index,
+									BMessage* rehash);
 			void				_HandleNodeMonitorMsg(BMessage* msg);
 			void				_InitCentralSplit();
 			void				_InitMenu();
@@ -111,12 +152,19 @@ private:
 			BString	const		_ProjectFileFullPath();
 			void				_ProjectFileOpen(const BString& filePath);
 			void				_ProjectFileRemoveItem(bool addToParseless);
+			void				_ProjectIndexInvalidate(const entry_ref* ref);
+			void				_ProjectIndexUpdateFile(const entry_ref* ref);
 			void				_ProjectItemChosen();
 			void				_ProjectOpen(BString const& projectName, bool activate);
 			void				_ProjectOutlineDepopulate(Project* project);
+			void				_ProjectOutlinePatch(Project* project,
+									const ProjectParser::scan_changes& changes);
 			void				_ProjectOutlinePopulate(Project* project);
 			Project*			_ProjectPointerFromName(BString const& projectName);
 			void				_ProjectRescan(BString const& projectName);
+			void				_ProjectRescanDone(BString const& projectName);
+			void				_ProjectRescanWait(BString const& projectName);
+			void				_ProjectUpdateDirectories();
 			status_t			_ProjectRemoveDir(const BString& dirPath);
 			int					_Replace(int what);
 			bool				_ReplaceAllow();
@@ -127,8 +175,10 @@ private:
 			void				_SendNotification(BString message, BString type);
 			void				_SetMakefileBuildMode();
 			void				_ShowLog(int32 index);
+			void				_ShowSearchResultLines(BMessage* message);
 			void				_UpdateFindMenuItems(const BString& text);
 			status_t			_UpdateLabel(int32 index, bool isModified);
+			void				_UpdateProblemsTab();
 			void				_UpdateProjectActivation(bool active);
 			void				_UpdateReplaceMenuItems(const BString& text);
 			void				_UpdateSavepointChange(int32 index, const BString& caller = "");
@@ -154,6 +204,7 @@ private:
 			BMenuItem*			fOverwiteItem;
 			BMenuItem*			fToggleWhiteSpacesItem;
 			BMenuItem*			fToggleLineEndingsItem;
+			BMenuItem*			fLargeFileModeItem;
 			BMenu*				fLineEndingsMenu;
 			BMenuItem*			fFindItem;
 			BMenuItem*			fReplaceItem;
@@ -223,7 +274,7 @@ private:
 
 			// Left panels
 			BTabView*	  		fProjectsTabView;
-			BOutlineListView*	fProjectsOutline;
+		ProjectOutlineView*	fProjectsOutline;
 			BScrollView*		fProjectsScroll;
 			// ClassesView*		fClassesView;
 			BPopUpMenu*			fProjectMenu;
@@ -242,14 +293,28 @@ private:
 			BStringItem*		fSelectedProjectItem;
 			BString				fSelectedProjectItemName;
 		BObjectList<Project>*	fProjectObjectList;
-			BStringItem*		fSourcesItem;
-			BStringItem*		fFilesItem;
 
 			// Editor group
 			TabManager*			fTabManager;
 		BObjectList<Editor>*	fEditorObjectList;
 			Editor*				fEditor;
 
+			// Editor lookup indexes to the editor list position, refs are
+			// stored as opened and resolved
+			struct editor_keys {
+				entry_ref	ref;
+				entry_ref	resolved;
+				node_ref	nref;
+				int32		index;
+			};
+			std::unordered_map<entry_ref, int32, entry_ref_hash>	fEditorsByRef;
+			std::unordered_map<node_ref, int32, node_ref_hash>	fEditorsByNode;
+			std::map<Editor*, editor_keys>	fEditorKeys;
+
+			// Files being rehashed after a stat change
+			std::set<entry_ref>	fRehashPending;
+			std::set<entry_ref>	fRehashAgain;
+
 			BGroupLayout*		fFindGroup;
 			BGroupLayout*		fReplaceGroup;
 			BMenuField*			fFindMenuField;
@@ -259,6 +324,7 @@ private:
 			BCheckBox*			fFindCaseSensitiveCheck;
 			BCheckBox*			fFindWholeWordCheck;
 			BCheckBox*			fFindWrapCheck;
+			BCheckBox*			fFindRegexCheck;
 			BGroupLayout*		fRunConsoleProgramGroup;
 			BTextControl*		fRunConsoleProgramText;
 			BButton*			fRunConsoleProgramButton;
@@ -275,7 +341,37 @@ private:
 			ConsoleIOThread*	fConsoleIOThread;
 			ConsoleIOView*		fBuildLogView;
 			ConsoleIOView*		fConsoleIOView;
+			SearchResultsView*	fSearchResultsView;
+			ProblemsView*		fProblemsView;
+
+			// Find in files
+			FileSearcher*		fFileSearcher;
+			std::vector<int32>	fSearchResultFiles;
+			BString				fFindInFilesText;
+			entry_ref			fPendingGoToRef;
+			int32				fPendingGoToLine;
+			TrigramIndex*		fProjectIndex;
+			BString				fProjectIndexName;
+
+			// Project scans running, and those asked again meanwhile
+			std::map<BString, thread_id>	fProjectScans;
+			std::set<BString>	fProjectScansPending;
+			// Parsers of open projects, watching their directories
+			std::map<BString, std::unique_ptr<ProjectParser>>	fProjectParsers;
+			std::map<BString, std::set<node_ref>>	fProjectDirtyDirectories;
 
+			// Node monitor events merged per node
+			struct node_event {
+				bool		moved = false;
+				bool		removed = false;
+				bool		modified = false;
+				entry_ref	from;
+				entry_ref	to;
+			};
+			std::map<node_ref, node_event>	fNodeEvents;
+			bool				fNodeFlushScheduled;
+			int64				fNodeEventsReceived;
+			int64				fNodeEventsActed;
 };
 
 #endif //IDEAMWINDOW_H
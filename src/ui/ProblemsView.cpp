@@ -0,0 +1,264 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "ProblemsView.h"
+
+#include <Catalog.h>
+#include <Entry.h>
+#include <ScrollBar.h>
+#include <Window.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include "DiagnosticsParser.h"
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "ProblemsView"
+
+static const rgb_color kProblemsErrorColor = { 220, 40, 40, 255 };
+static const rgb_color kProblemsWarningColor = { 236, 126, 14, 255 };
+
+ProblemsView::ProblemsView(const char* name,
+	const BMessenger& target, uint32 invokeWhat)
+	:
+	BView(name, B_WILL_DRAW | B_FRAME_EVENTS | B_NAVIGABLE)
+	, fTarget(target)
+	, fInvokeWhat(invokeWhat)
+	, fErrors(0)
+	, fWarnings(0)
+	, fSelected(-1)
+	, fRowHeight(16)
+	, fBaseline(12)
+{
+	BFont font;
+	font.SetFamilyAndStyle("Noto Sans Mono", "Bold");
+	SetFont(&font);
+}
+
+void
+ProblemsView::AttachedToWindow()
+{
+	BView::AttachedToWindow();
+
+	SetViewUIColor(B_LIST_BACKGROUND_COLOR);
+
+	font_height height;
+	GetFontHeight(&height);
+	fBaseline = ceilf(height.ascent + height.leading / 2) + 1;
+	fRowHeight = ceilf(height.ascent + height.descent + height.leading) + 2;
+
+	_UpdateScrollBar();
+}
+
+void
+ProblemsView::Draw(BRect updateRect)
+{
+	if (fProblems.empty())
+		return;
+
+	int32 first = std::max(0, int32(updateRect.top / fRowHeight));
+	int32 last = std::min(int32(fProblems.size()) - 1,
+		int32(updateRect.bottom / fRowHeight));
+
+	const float width = Bounds().Width();
+	const float textLeft = 4 + StringWidth("warning  ");
+	BString text;
+
+	for (int32 row = first; row <= last; row++) {
+		const problem& item = fProblems[row];
+		BRect rowRect(0, row * fRowHeight, width, (row + 1) * fRowHeight - 1);
+
+		if (row == fSelected) {
+			SetHighUIColor(B_LIST_SELECTED_BACKGROUND_COLOR);
+			FillRect(rowRect);
+			SetHighUIColor(B_LIST_SELECTED_ITEM_TEXT_COLOR);
+		} else if (item.severity == kDiagnosticError)
+			SetHighColor(kProblemsErrorColor);
+		else if (item.severity == kDiagnosticWarning)
+			SetHighColor(kProblemsWarningColor);
+		else
+			SetHighUIColor(B_LIST_ITEM_TEXT_COLOR);
+
+		const char* label = B_TRANSLATE("failed");
+		if (item.severity == kDiagnosticError)
+			label = B_TRANSLATE("error");
+		else if (item.severity == kDiagnosticWarning)
+			label = B_TRANSLATE("warning");
+		DrawString(label, BPoint(4, rowRect.top + fBaseline));
+
+		if (row != fSelected)
+			SetHighUIColor(B_LIST_ITEM_TEXT_COLOR);
+
+		text.SetTo("");
+		if (item.path >= 0) {
+			const BString& path = fPaths[item.path];
+			text << path.String() + path.FindLast('/') + 1 << " :" << item.line;
+			if (item.column > 0)
+				text << ":" << item.column;
+			text << "    ";
+		}
+		text << item.text;
+
+		DrawString(text.String(), BPoint(textLeft, rowRect.top + fBaseline));
+	}
+}
+
+void
+ProblemsView::FrameResized(float width, float height)
+{
+	BView::FrameResized(width, height);
+	_UpdateScrollBar();
+}
+
+void
+ProblemsView::KeyDown(const char* bytes, int32 numBytes)
+{
+	const int32 pageRows = std::max(1, int32(Bounds().Height() / fRowHeight));
+
+	switch (bytes[0]) {
+		case B_UP_ARROW:
+			_Select(std::max(0, fSelected - 1));
+			break;
+		case B_DOWN_ARROW:
+			_Select(std::min(int32(fProblems.size()) - 1, fSelected + 1));
+			break;
+		case B_PAGE_UP:
+			_Select(std::max(0, fSelected - pageRows));
+			break;
+		case B_PAGE_DOWN:
+			_Select(std::min(int32(fProblems.size()) - 1, fSelected + pageRows));
+			break;
+		case B_ENTER:
+			_Invoke(fSelected);
+			break;
+		default:
+			BView::KeyDown(bytes, numBytes);
+	}
+}
+
+void
+ProblemsView::MouseDown(BPoint where)
+{
+	MakeFocus(true);
+
+	int32 row = int32(where.y / fRowHeight);
+	if (row < 0 || row >= int32(fProblems.size()))
+		return;
+
+	_Select(row);
+	_Invoke(row);
+}
+
+void
+ProblemsView::Clear()
+{
+	fPaths.clear();
+	fPathIndex.clear();
+	fProblems.clear();
+	fErrors = 0;
+	fWarnings = 0;
+	fSelected = -1;
+
+	ScrollTo(0, 0);
+	_UpdateScrollBar();
+	Invalidate();
+}
+
+/*
+ * One scrollbar update and invalidation a batch
+ */
+void
+ProblemsView::AddDiagnostics(const BMessage* message)
+{
+	const int32 first = fProblems.size();
+	problem item;
+	BString path;
+
+	for (int32 index = 0;
+			message->FindInt32("severity", index, &item.severity) == B_OK;
+			index++) {
+		item.line = message->GetInt32("line", index, 0);
+		item.column = message->GetInt32("column", index, 0);
+		message->FindString("text", index, &item.text);
+		message->FindString("path", index, &path);
+
+		item.path = -1;
+		if (path.IsEmpty() == false) {
+			auto found = fPathIndex.find(path);
+			if (found == fPathIndex.end()) {
+				fPaths.push_back(path);
+				found = fPathIndex.insert(
+					std::make_pair(path, int32(fPaths.size() - 1))).first;
+			}
+			item.path = found->second;
+		}
+
+		fProblems.push_back(item);
+	}
+
+	fErrors = message->GetInt32("errors", fErrors);
+	fWarnings = message->GetInt32("warnings", fWarnings);
+
+	_UpdateScrollBar();
+	Invalidate(BRect(0, first * fRowHeight, Bounds().Width(),
+		fProblems.size() * fRowHeight));
+}
+
+void
+ProblemsView::_Invoke(int32 row)
+{
+	if (row < 0 || row >= int32(fProblems.size())
+		|| fProblems[row].path < 0)
+		return;
+
+	entry_ref ref;
+	if (get_ref_for_path(fPaths[fProblems[row].path], &ref) != B_OK)
+		return;
+
+	BMessage message(fInvokeWhat);
+	message.AddRef("ref", &ref);
+	message.AddInt32("line", fProblems[row].line);
+	fTarget.SendMessage(&message);
+}
+
+void
+ProblemsView::_Select(int32 row)
+{
+	if (row < 0 || row == fSelected)
+		return;
+
+	int32 previous = fSelected;
+	fSelected = row;
+
+	const float width = Bounds().Width();
+	if (previous >= 0)
+		Invalidate(BRect(0, previous * fRowHeight, width,
+			(previous + 1) * fRowHeight));
+	Invalidate(BRect(0, row * fRowHeight, width, (row + 1) * fRowHeight));
+
+	// Keep selection visible
+	BRect bounds = Bounds();
+	float top = row * fRowHeight;
+	if (top < bounds.top)
+		ScrollTo(0, top);
+	else if (top + fRowHeight > bounds.bottom)
+		ScrollTo(0, top + fRowHeight - bounds.Height());
+}
+
+void
+ProblemsView::_UpdateScrollBar()
+{
+	BScrollBar* scrollBar = ScrollBar(B_VERTICAL);
+	if (scrollBar == nullptr)
+		return;
+
+	float height = Bounds().Height();
+	float dataHeight = fProblems.size() * fRowHeight;
+
+	scrollBar->SetRange(0, std::max(0.0f, dataHeight - height));
+	scrollBar->SetProportion(dataHeight > 0 ? std::min(1.0f, height / dataHeight) : 1.0f);
+	scrollBar->SetSteps(fRowHeight, std::max(fRowHeight, height - fRowHeight));
+}
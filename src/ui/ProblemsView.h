@@ -0,0 +1,69 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef PROBLEMS_VIEW_H
+#define PROBLEMS_VIEW_H
+
+#include <Message.h>
+#include <Messenger.h>
+#include <String.h>
+#include <View.h>
+
+#include <map>
+#include <vector>
+
+/*
+ * Errors, warnings and failed jam actions of the last build, as found by
+ * DiagnosticsParser.
+ * Rows are plain structs and only the visible ones are drawn, like
+ * SearchResultsView. Invoking a row with a location sends the invoke
+ * message with "ref" and "line".
+ */
+class ProblemsView : public BView {
+public:
+								ProblemsView(const char* name,
+									const BMessenger& target, uint32 invokeWhat);
+
+	virtual	void				AttachedToWindow();
+	virtual	void				Draw(BRect updateRect);
+	virtual	void				FrameResized(float width, float height);
+	virtual	void				KeyDown(const char* bytes, int32 numBytes);
+	virtual	void				MouseDown(BPoint where);
+
+			void				Clear();
+			// A DIAGNOSTICSPARSER_FOUND batch
+			void				AddDiagnostics(const BMessage* message);
+
+			// All found, rows may be fewer
+			int32				CountErrors() const { return fErrors; }
+			int32				CountWarnings() const { return fWarnings; }
+
+private:
+	struct problem {
+		int32	severity;
+		int32	path;		// index in fPaths, -1 if none
+		int32	line;
+		int32	column;
+		BString	text;
+	};
+
+			void				_Invoke(int32 row);
+			void				_Select(int32 row);
+			void				_UpdateScrollBar();
+
+			BMessenger			fTarget;
+			uint32				fInvokeWhat;
+
+			std::vector<BString>	fPaths;
+			std::map<BString, int32>	fPathIndex;
+			std::vector<problem>	fProblems;
+			int32				fErrors;
+			int32				fWarnings;
+
+			int32				fSelected;
+			float				fRowHeight;
+			float				fBaseline;
+};
+
+#endif // PROBLEMS_VIEW_H
@@ -0,0 +1,238 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+#include "SearchResultsView.h"
+
+#include <ScrollBar.h>
+#include <Window.h>
+
+#include <algorithm>
+#include <cmath>
+
+SearchResultsView::SearchResultsView(const char* name,
+	const BMessenger& target, uint32 invokeWhat)
+	:
+	BView(name, B_WILL_DRAW | B_FRAME_EVENTS | B_NAVIGABLE)
+	, fTarget(target)
+	, fInvokeWhat(invokeWhat)
+	, fFirstPending(0)
+	, fSelected(-1)
+	, fRowHeight(16)
+	, fBaseline(12)
+{
+	BFont font;
+	font.SetFamilyAndStyle("Noto Sans Mono", "Bold");
+	SetFont(&font);
+}
+
+void
+SearchResultsView::AttachedToWindow()
+{
+	BView::AttachedToWindow();
+
+	SetViewUIColor(B_LIST_BACKGROUND_COLOR);
+
+	font_height height;
+	GetFontHeight(&height);
+	fBaseline = ceilf(height.ascent + height.leading / 2) + 1;
+	fRowHeight = ceilf(height.ascent + height.descent + height.leading) + 2;
+
+	_UpdateScrollBar();
+}
+
+void
+SearchResultsView::Draw(BRect updateRect)
+{
+	if (fResults.empty())
+		return;
+
+	int32 first = std::max(0, int32(updateRect.top / fRowHeight));
+	int32 last = std::min(int32(fResults.size()) - 1,
+		int32(updateRect.bottom / fRowHeight));
+
+	const float width = Bounds().Width();
+	BString text;
+
+	for (int32 row = first; row <= last; row++) {
+		const result& item = fResults[row];
+		BRect rowRect(0, row * fRowHeight, width, (row + 1) * fRowHeight - 1);
+
+		if (row == fSelected) {
+			SetHighUIColor(B_LIST_SELECTED_BACKGROUND_COLOR);
+			FillRect(rowRect);
+			SetHighUIColor(B_LIST_SELECTED_ITEM_TEXT_COLOR);
+		} else
+			SetHighUIColor(B_LIST_ITEM_TEXT_COLOR);
+
+		text.SetTo("");
+		text << fFiles[item.file].name << " :" << item.line;
+		if (item.text >= 0)
+			text << "    " << fTexts[item.text];
+
+		DrawString(text.String(), BPoint(4, rowRect.top + fBaseline));
+	}
+}
+
+void
+SearchResultsView::FrameResized(float width, float height)
+{
+	BView::FrameResized(width, height);
+	_UpdateScrollBar();
+}
+
+void
+SearchResultsView::KeyDown(const char* bytes, int32 numBytes)
+{
+	const int32 pageRows = std::max(1, int32(Bounds().Height() / fRowHeight));
+
+	switch (bytes[0]) {
+		case B_UP_ARROW:
+			_Select(std::max(0, fSelected - 1));
+			break;
+		case B_DOWN_ARROW:
+			_Select(std::min(int32(fResults.size()) - 1, fSelected + 1));
+			break;
+		case B_PAGE_UP:
+			_Select(std::max(0, fSelected - pageRows));
+			break;
+		case B_PAGE_DOWN:
+			_Select(std::min(int32(fResults.size()) - 1, fSelected + pageRows));
+			break;
+		case B_ENTER:
+			_Invoke(fSelected);
+			break;
+		default:
+			BView::KeyDown(bytes, numBytes);
+	}
+}
+
+void
+SearchResultsView::MouseDown(BPoint where)
+{
+	MakeFocus(true);
+
+	int32 row = int32(where.y / fRowHeight);
+	if (row < 0 || row >= int32(fResults.size()))
+		return;
+
+	_Select(row);
+	_Invoke(row);
+}
+
+/*
+ * O(1) apart from freeing the rows
+ */
+void
+SearchResultsView::Clear()
+{
+	fFiles.clear();
+	fResults.clear();
+	fTexts.clear();
+	fFirstPending = 0;
+	fSelected = -1;
+
+	ScrollTo(0, 0);
+	_UpdateScrollBar();
+	Invalidate();
+}
+
+int32
+SearchResultsView::AddFile(const entry_ref& ref)
+{
+	fFiles.push_back(ref);
+	return fFiles.size() - 1;
+}
+
+/*
+ * Bulk add for mark all: one call, one scrollbar update, one invalidation
+ */
+void
+SearchResultsView::AddLines(int32 file, const int32* lines, int32 count)
+{
+	int32 first = fResults.size();
+
+	fResults.reserve(fResults.size() + count);
+	for (int32 i = 0; i < count; i++)
+		fResults.push_back({file, lines[i], -1});
+
+	fFirstPending = fResults.size();
+
+	_UpdateScrollBar();
+	Invalidate(BRect(0, first * fRowHeight, Bounds().Width(),
+		fResults.size() * fRowHeight));
+}
+
+void
+SearchResultsView::AddMatch(int32 file, int32 line, const BString& text)
+{
+	fTexts.push_back(text);
+	fResults.push_back({file, line, int32(fTexts.size() - 1)});
+}
+
+/*
+ * Once a result batch
+ */
+void
+SearchResultsView::Update()
+{
+	if (fFirstPending == int32(fResults.size()))
+		return;
+
+	_UpdateScrollBar();
+	Invalidate(BRect(0, fFirstPending * fRowHeight, Bounds().Width(),
+		fResults.size() * fRowHeight));
+	fFirstPending = fResults.size();
+}
+
+void
+SearchResultsView::_Invoke(int32 row)
+{
+	if (row < 0 || row >= int32(fResults.size()))
+		return;
+
+	BMessage message(fInvokeWhat);
+	message.AddRef("ref", &fFiles[fResults[row].file]);
+	message.AddInt32("line", fResults[row].line);
+	fTarget.SendMessage(&message);
+}
+
+void
+SearchResultsView::_Select(int32 row)
+{
+	if (row < 0 || row == fSelected)
+		return;
+
+	int32 previous = fSelected;
+	fSelected = row;
+
+	const float width = Bounds().Width();
+	if (previous >= 0)
+		Invalidate(BRect(0, previous * fRowHeight, width,
+			(previous + 1) * fRowHeight));
+	Invalidate(BRect(0, row * fRowHeight, width, (row + 1) * fRowHeight));
+
+	// Keep selection visible
+	BRect bounds = Bounds();
+	float top = row * fRowHeight;
+	if (top < bounds.top)
+		ScrollTo(0, top);
+	else if (top + fRowHeight > bounds.bottom)
+		ScrollTo(0, top + fRowHeight - bounds.Height());
+}
+
+void
+SearchResultsView::_UpdateScrollBar()
+{
+	BScrollBar* scrollBar = ScrollBar(B_VERTICAL);
+	if (scrollBar == nullptr)
+		return;
+
+	float height = Bounds().Height();
+	float dataHeight = fResults.size() * fRowHeight;
+
+	scrollBar->SetRange(0, std::max(0.0f, dataHeight - height));
+	scrollBar->SetProportion(dataHeight > 0 ? std::min(1.0f, height / dataHeight) : 1.0f);
+	scrollBar->SetSteps(fRowHeight, std::max(fRowHeight, height - fRowHeight));
+}
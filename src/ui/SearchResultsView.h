@@ -0,0 +1,67 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+#ifndef SEARCH_RESULTS_VIEW_H
+#define SEARCH_RESULTS_VIEW_H
+
+#include <Entry.h>
+#include <Messenger.h>
+#include <String.h>
+#include <View.h>
+
+#include <vector>
+
+/*
+ * Virtualized results list: rows are plain structs and only the visible
+ * ones are drawn, so hundreds of thousands of results stay cheap.
+ * Invoking a row sends the invoke message with "ref" and "line".
+ */
+class SearchResultsView : public BView {
+public:
+								SearchResultsView(const char* name,
+									const BMessenger& target, uint32 invokeWhat);
+
+	virtual	void				AttachedToWindow();
+	virtual	void				Draw(BRect updateRect);
+	virtual	void				FrameResized(float width, float height);
+	virtual	void				KeyDown(const char* bytes, int32 numBytes);
+	virtual	void				MouseDown(BPoint where);
+
+			void				Clear();
+			int32				AddFile(const entry_ref& ref);
+			void				AddLines(int32 file, const int32* lines, int32 count);
+			// Shown on next Update()
+			void				AddMatch(int32 file, int32 line, const BString& text);
+			// Scroll bar and drawing after AddMatch() calls
+			void				Update();
+
+			int32				CountResults() const { return fResults.size(); }
+			int32				CountFiles() const { return fFiles.size(); }
+
+private:
+	struct result {
+		int32	file;
+		int32	line;
+		int32	text;		// index in fTexts, -1 if none
+	};
+
+			void				_Invoke(int32 row);
+			void				_Select(int32 row);
+			void				_UpdateScrollBar();
+
+			BMessenger			fTarget;
+			uint32				fInvokeWhat;
+
+			std::vector<entry_ref>	fFiles;
+			std::vector<result>	fResults;
+			std::vector<BString>	fTexts;
+
+			// Rows added since last update
+			int32				fFirstPending;
+			int32				fSelected;
+			float				fRowHeight;
+			float				fBaseline;
+};
+
+#endif // SEARCH_RESULTS_VIEW_H
@@ -72,7 +72,8 @@ enum {
 	MSG_TAB_WIDTH_CHANGED					= 'tawi',
 
 	MSG_WRAP_CONSOLE_ENABLED				= 'wcen',
-	MSG_CONSOLE_BANNER_ENABLED				= 'cben'
+	MSG_CONSOLE_BANNER_ENABLED				= 'cben',
+	MSG_CONSOLE_SCROLLBACK_CHANGED			= 'cscr'
 };
 
 SettingsWindow::SettingsWindow()
@@ -319,6 +320,12 @@ SettingsWindow::MessageReceived(BMessage *msg)
 				_ManageModifications(fConsoleBannerEnabled, modified);
 			break;
 		}
+		case MSG_CONSOLE_SCROLLBACK_CHANGED: {
+			bool modified = fConsoleScrollbackSpinner->Value() !=
+								fWindowSettingsFile->FindInt32("console_scrollback");
+				_ManageModifications(fConsoleScrollbackSpinner, modified);
+			break;
+		}
 		default: {
 			BWindow::MessageReceived(msg);
 			break;
@@ -726,6 +733,15 @@ SettingsWindow::_LoadFromFile(BControl* control, bool loadAll /*= false*/)
 		} else
 			fOrphansList->AddItem(fConsoleBannerEnabled);
 	}
+	if (control == fConsoleScrollbackSpinner || loadAll == true) {
+		status = fWindowSettingsFile->FindInt32("console_scrollback", &intVal);
+		fControlsCount += loadAll == true;
+		if (status == B_OK) {
+			fConsoleScrollbackSpinner->SetValue(intVal);
+			fControlsDone += loadAll == true;
+		} else
+			fOrphansList->AddItem(fConsoleScrollbackSpinner);
+	}
 
 	_UpdateText();
 	// Note: gets rewritten on reload defaults
@@ -803,10 +819,18 @@ SettingsWindow::_PageBuildView()
 	fConsoleBannerEnabled = new BCheckBox("ConsoleBannerEnabled",
 		B_TRANSLATE("Console banner"), new BMessage(MSG_CONSOLE_BANNER_ENABLED));
 
+	// Lines kept in memory, older ones go to disk
+	fConsoleScrollbackSpinner = new BSpinner("ConsoleScrollback",
+		B_TRANSLATE("Console scrollback lines:  "),
+		new BMessage(MSG_CONSOLE_SCROLLBACK_CHANGED));
+	fConsoleScrollbackSpinner->SetRange(1000, 10000000);
+	fConsoleScrollbackSpinner->SetAlignment(B_ALIGN_RIGHT);
+
 	BView* view = BGroupLayoutBuilder(B_VERTICAL, 0)
 		.Add(BLayoutBuilder::Grid<>(fBuildBox)
 		.Add(fWrapConsoleEnabled, 0, 1)
 		.Add(fConsoleBannerEnabled, 1, 1)
+		.Add(fConsoleScrollbackSpinner, 0, 2, 2)
 		.Add(new BSeparatorView(B_HORIZONTAL, B_PLAIN_BORDER), 0, 3, 4)
 		.AddGlue(0, 4)
 		.SetInsets(10, 20, 10, 10))
@@ -1177,6 +1201,8 @@ SettingsWindow::_StoreToFile(BControl* control)
 		status = fWindowSettingsFile->SetInt32("wrap_console", fWrapConsoleEnabled->Value());
 	else if (control == fConsoleBannerEnabled)
 		status = fWindowSettingsFile->SetInt32("console_banner", fConsoleBannerEnabled->Value());
+	else if (control == fConsoleScrollbackSpinner)
+		status = fWindowSettingsFile->SetInt32("console_scrollback", fConsoleScrollbackSpinner->Value());
 
 	return status;
 }
@@ -1227,6 +1253,7 @@ SettingsWindow::_StoreToFileDefaults()
 	// Build Page
 	fWindowSettingsFile->SetInt32("wrap_console", kSKWrapConsole);
 	fWindowSettingsFile->SetInt32("console_banner", kSKConsoleBanner);
+	fWindowSettingsFile->SetInt32("console_scrollback", kSKConsoleScrollback);
 	
 	return B_OK;
 }
@@ -123,6 +123,7 @@ typedef std::map<BStringItem*, BString>::const_iterator ViewPageIterator;
 			BBox*				fBuildBox;
 			BCheckBox*			fWrapConsoleEnabled;
 			BCheckBox*			fConsoleBannerEnabled;
+			BSpinner*			fConsoleScrollbackSpinner;
 
 			// Buttons
 			BButton*			fApplyButton;
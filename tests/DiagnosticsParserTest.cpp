@@ -0,0 +1,213 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+/*
+ * Build output fed whole, a byte at a time and between other output,
+ * diagnostics checked as a looper gets them. Exits with the count of
+ * failures.
+ */
+
+#include <Looper.h>
+#include <Message.h>
+#include <Messenger.h>
+#include <String.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "DiagnosticsParser.h"
+
+static constexpr auto kSync = 'Sync';
+
+static const char* kDirectory = "/boot/home/project";
+
+static const char* kOutput =
+	"C++ objects/main.o\n"
+	"src/main.cpp: In function 'int main()':\n"
+	"src/main.cpp:12:5: error: 'foo' was not declared in this scope\n"
+	"src/util.h:3: warning: unused variable 'x'\r\n"
+	"/usr/include/a.h:7:1: fatal error: b.h: No such file or directory\n"
+	"\n"
+	"...failed C++ objects/main.o ...\n"
+	"error[E0425]: cannot find value `y` in this scope\n"
+	" --> src/lib.rs:2:5\n"
+	"warning: unused import\n"
+	"  --> src/a:b.rs:1:5\n"
+	"error: aborting due to previous error\n"
+	"don't know how to make foo.cpp\n"
+	"Jamfile: line 4: syntax error at EOF\n"
+	"...skipped app for lack of main.o...\n"
+	"...failed updating 1 target(s)...\n"
+	"src/end.c:9: error: no newline";
+
+struct expected_diagnostic {
+	int32		severity;
+	const char*	path;
+	int32		line;
+	int32		column;
+	const char*	text;
+};
+
+static const expected_diagnostic kExpected[] = {
+	{ kDiagnosticError, "/boot/home/project/src/main.cpp", 12, 5,
+		"'foo' was not declared in this scope" },
+	{ kDiagnosticWarning, "/boot/home/project/src/util.h", 3, 0,
+		"unused variable 'x'" },
+	{ kDiagnosticError, "/usr/include/a.h", 7, 1,
+		"b.h: No such file or directory" },
+	{ kDiagnosticFailed, "", 0, 0, "C++ objects/main.o" },
+	{ kDiagnosticError, "/boot/home/project/src/lib.rs", 2, 5,
+		"cannot find value `y` in this scope" },
+	{ kDiagnosticWarning, "/boot/home/project/src/a:b.rs", 1, 5,
+		"unused import" },
+	{ kDiagnosticError, "", 0, 0, "don't know how to make foo.cpp" },
+	{ kDiagnosticError, "/boot/home/project/Jamfile", 4, 0,
+		"syntax error at EOF" },
+	{ kDiagnosticError, "/boot/home/project/src/end.c", 9, 0, "no newline" }
+};
+
+static constexpr int32 kExpectedErrors = 6;
+static constexpr int32 kExpectedWarnings = 2;
+
+class Collector : public BLooper {
+public:
+	Collector()
+		:
+		BLooper("DiagnosticsParserTest")
+	{
+	}
+
+	virtual void MessageReceived(BMessage* message)
+	{
+		switch (message->what) {
+			case DIAGNOSTICSPARSER_FOUND:
+				batches.push_back(*message);
+				break;
+			case kSync:
+				message->SendReply(B_REPLY);
+				break;
+			default:
+				BLooper::MessageReceived(message);
+				break;
+		}
+	}
+
+	std::vector<BMessage>	batches;
+};
+
+static int
+check(const char* name, Collector* collector, const DiagnosticsParser& parser)
+{
+	// Batches before the reply are all in
+	BMessage reply;
+	BMessenger(collector).SendMessage(kSync, &reply);
+
+	const size_t expectedCount = sizeof(kExpected) / sizeof(kExpected[0]);
+	int failures = 0;
+	size_t count = 0;
+
+	collector->Lock();
+	for (const BMessage& batch : collector->batches) {
+		int32 severity;
+		for (int32 index = 0;
+				batch.FindInt32("severity", index, &severity) == B_OK;
+				index++, count++) {
+			if (count >= expectedCount)
+				continue;
+
+			const expected_diagnostic& item = kExpected[count];
+			BString path, text;
+			batch.FindString("path", index, &path);
+			batch.FindString("text", index, &text);
+			const int32 line = batch.GetInt32("line", index, -1);
+			const int32 column = batch.GetInt32("column", index, -1);
+
+			if (severity != item.severity || path != item.path
+				|| line != item.line || column != item.column
+				|| text != item.text) {
+				printf("FAIL %s %zu: %" B_PRId32 " %s:%" B_PRId32 ":%" B_PRId32
+					" %s\n", name, count, severity, path.String(), line, column,
+					text.String());
+				failures++;
+			}
+		}
+	}
+
+	if (count != expectedCount) {
+		printf("FAIL %s: %zu diagnostics, expected %zu\n", name, count,
+			expectedCount);
+		failures++;
+	}
+
+	const BMessage* last = collector->batches.empty() == true
+		? nullptr : &collector->batches.back();
+	if (last == nullptr || last->GetBool("done", false) == false
+		|| last->GetInt32("errors", -1) != kExpectedErrors
+		|| last->GetInt32("warnings", -1) != kExpectedWarnings
+		|| parser.CountErrors() != kExpectedErrors
+		|| parser.CountWarnings() != kExpectedWarnings) {
+		printf("FAIL %s: %" B_PRId32 " errors, %" B_PRId32 " warnings, expected"
+			" %" B_PRId32 " and %" B_PRId32 "\n", name, parser.CountErrors(),
+			parser.CountWarnings(), kExpectedErrors, kExpectedWarnings);
+		failures++;
+	}
+
+	collector->batches.clear();
+	collector->Unlock();
+
+	return failures;
+}
+
+int
+main()
+{
+	Collector* collector = new Collector();
+	collector->Run();
+
+	int failures = 0;
+	{
+		DiagnosticsParser parser(BMessenger(collector), kDirectory);
+		parser.Feed(2, kOutput, strlen(kOutput));
+		parser.Finish();
+		failures += check("whole", collector, parser);
+	}
+	{
+		// Every line split across calls
+		DiagnosticsParser parser(BMessenger(collector), kDirectory);
+		for (const char* text = kOutput; *text != '\0'; text++)
+			parser.Feed(2, text, 1);
+		parser.Finish();
+		failures += check("bytes", collector, parser);
+	}
+	{
+		DiagnosticsParser parser(BMessenger(collector), kDirectory);
+
+		// Too long a line, its end not taken for a line of its own
+		BString filler;
+		filler.Append('x', 10000);
+		for (int32 piece = 0; piece < 7; piece++)
+			parser.Feed(2, filler.String(), filler.Length());
+		const char* tail = "src/tail.c:1: error: tail\n";
+		parser.Feed(2, tail, strlen(tail));
+
+		// A partial stdout line does not join stderr ones
+		const char* diagnostic = strstr(kOutput, "src/main.cpp:12");
+		parser.Feed(2, kOutput, diagnostic - kOutput);
+		const char* partial = "Compiling foo...";
+		parser.Feed(1, partial, strlen(partial));
+		parser.Feed(2, diagnostic, strlen(diagnostic));
+		parser.Feed(1, "\n", 1);
+		parser.Finish();
+		failures += check("streams", collector, parser);
+	}
+
+	collector->Lock();
+	collector->Quit();
+
+	printf("DiagnosticsParser: %d failed\n", failures);
+
+	return failures;
+}
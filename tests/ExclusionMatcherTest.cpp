@@ -0,0 +1,148 @@
+/*
+ * Copyright 2018 A. Mosca <amoscaster@gmail.com>
+ * All rights reserved. Distributed under the terms of the MIT license.
+ */
+
+/*
+ * Ignore rules against relative paths, on a project made in a temporary
+ * directory. Exits with the count of failures.
+ */
+
+#include <Directory.h>
+#include <File.h>
+#include <Message.h>
+#include <String.h>
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "ExclusionMatcher.h"
+
+static const char* kTestRoot = "/tmp/ExclusionMatcherTest";
+
+static const char* kGitIgnore =
+	"# comment\n"
+	"*.log\n"
+	"build/\n"
+	"/top.txt\n"
+	"docs/*.html\n"
+	"foo/**/bar\n"
+	"src/**/gen\n"
+	"**/deep\n"
+	"!keep.log\n"
+	"lib[0-9].a\n"
+	"x?z\n";
+
+static const char* kHgIgnore =
+	"syntax: glob\n"
+	"*.pyc\n"
+	"out/*.bin\n"
+	"syntax: regexp\n"
+	"\\.orig$\n";
+
+struct test_case {
+	const char*	path;
+	bool		directory;
+	int32		expected;
+};
+
+static const test_case kCases[] = {
+	{ "a.log", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "x/a.log", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "x/keep.log", false, ExclusionMatcher::MATCH_INCLUDED },
+	{ "build", true, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "build", false, ExclusionMatcher::MATCH_INCLUDED },
+	{ "top.txt", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "x/top.txt", false, ExclusionMatcher::MATCH_INCLUDED },
+	{ "docs/a.html", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "docs/x/a.html", false, ExclusionMatcher::MATCH_INCLUDED },
+	{ "lib3.a", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "libx.a", false, ExclusionMatcher::MATCH_INCLUDED },
+	{ "xyz", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "x/z", false, ExclusionMatcher::MATCH_INCLUDED },
+	// "**/": no directory, some, never part of a name
+	{ "foo/bar", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "foo/a/b/bar", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "foo/abar", false, ExclusionMatcher::MATCH_INCLUDED },
+	{ "foo/bars", false, ExclusionMatcher::MATCH_INCLUDED },
+	{ "src/gen", true, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "src/a/b/gen", true, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "src/oxygen", true, ExclusionMatcher::MATCH_INCLUDED },
+	{ "src/a/xgen", true, ExclusionMatcher::MATCH_INCLUDED },
+	{ "deep", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "a/deep", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "a/undeep", false, ExclusionMatcher::MATCH_INCLUDED },
+	// hg globs with a '/' are not rooted, yet whole components
+	{ "a.pyc", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "out/x.bin", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "a/out/x.bin", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "about/x.bin", false, ExclusionMatcher::MATCH_INCLUDED },
+	{ "out/x.bing", false, ExclusionMatcher::MATCH_INCLUDED },
+	{ "a.c.orig", false, ExclusionMatcher::MATCH_EXCLUDED },
+	// Defaults and settings
+	{ "a.o", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "app", true, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "objects.x86_64", true, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "target", true, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "node_modules", true, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "a.tmp", false, ExclusionMatcher::MATCH_EXCLUDED },
+	{ "src/skip.cpp", false, ExclusionMatcher::MATCH_PARSELESS },
+	{ "src/main.cpp", false, ExclusionMatcher::MATCH_INCLUDED },
+};
+
+static status_t
+write_file(const BString& path, const char* text)
+{
+	BFile file(path.String(), B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status != B_OK)
+		return status;
+
+	const ssize_t length = strlen(text);
+	return file.Write(text, length) == length ? B_OK : B_IO_ERROR;
+}
+
+int
+main()
+{
+	BString root(kTestRoot);
+	create_directory(root.String(), 0755);
+	if (write_file(BString(root) << "/.gitignore", kGitIgnore) != B_OK
+		|| write_file(BString(root) << "/.hgignore", kHgIgnore) != B_OK) {
+		fprintf(stderr, "cannot write ignore files in %s\n", kTestRoot);
+		return 1;
+	}
+
+	BMessage settings;
+	settings.AddString("parseless_dirs", "node_modules");
+	settings.AddString("parseless_extensions", "*.tmp");
+	settings.AddString("parseless_item", BString(root) << "/src/skip.cpp");
+
+	ExclusionMatcher matcher;
+	matcher.Load(root, settings, "cargo");
+
+	int failures = 0;
+	for (const test_case& item : kCases) {
+		BString path(root);
+		path << "/" << item.path;
+		const char* name = strrchr(path.String(), '/') + 1;
+
+		const int32 result = matcher.Match(path, name, item.directory);
+		if (result != item.expected) {
+			printf("FAIL %s%s: %" B_PRId32 ", expected %" B_PRId32 "\n",
+				item.path, item.directory == true ? "/" : "", result,
+				item.expected);
+			failures++;
+		}
+	}
+
+	unlink((BString(root) << "/.gitignore").String());
+	unlink((BString(root) << "/.hgignore").String());
+	rmdir(root.String());
+
+	printf("ExclusionMatcher: %d of %d failed\n", failures,
+		(int)(sizeof(kCases) / sizeof(kCases[0])));
+
+	return failures;
+}